@@ -8,6 +8,8 @@
 
 static char names[MAX_ENTRIES * NAME_LEN];
 static uint8_t is_dir[MAX_ENTRIES];
+static uint32_t sizes[MAX_ENTRIES];
+static uint8_t dent_buf[1024];
 
 static void append_line(char* out, int out_size, int* len, const char* line) {
     if (*len >= out_size - 1) {
@@ -57,22 +59,43 @@ static void build_page_text(const char* path, int count, int page, int per_page,
         if ((int)strlen(name_buf) > 24) {
             name_buf[24] = '\0';
         }
-        snprintf(line, sizeof(line), "[%c] %s", is_dir[i] ? 'D' : 'F', name_buf);
+        if (is_dir[i]) {
+            snprintf(line, sizeof(line), "[D] %s", name_buf);
+        } else {
+            snprintf(line, sizeof(line), "[F] %s  %d", name_buf, (int)sizes[i]);
+        }
         append_line(out, out_size, &len, line);
     }
 }
 
+// getdents로 이름/크기를 한 번에 받아옴 (항목마다 따로 조회하지 않음)
 static int refresh_list(const char* path, int* out_count) {
-    sys_dir_list_t req;
+    sys_getdents_t req;
     memset(&req, 0, sizeof(req));
     req.path = path;
-    req.names = names;
-    req.is_dir = is_dir;
-    req.max_entries = MAX_ENTRIES;
-    req.name_len = NAME_LEN;
-    int count = sys_dir_list(&req);
-    if (count < 0) {
-        return -1;
+    req.buf = dent_buf;
+    req.buf_len = sizeof(dent_buf);
+
+    int count = 0;
+    while (count < MAX_ENTRIES) {
+        int bytes = sys_getdents(&req);
+        if (bytes < 0) {
+            return -1;
+        }
+        if (bytes == 0) {
+            break;
+        }
+        int off = 0;
+        while (off < bytes && count < MAX_ENTRIES) {
+            const sys_dirent_t* d = (const sys_dirent_t*)(dent_buf + off);
+            char* dest = names + (count * NAME_LEN);
+            strncpy(dest, d->name, NAME_LEN - 1);
+            dest[NAME_LEN - 1] = '\0';
+            is_dir[count] = (d->attr & DIRENT_ATTR_DIR) ? 1 : 0;
+            sizes[count] = d->size;
+            count++;
+            off += d->reclen;
+        }
     }
     *out_count = count;
     return 0;
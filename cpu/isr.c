@@ -7,6 +7,7 @@
 #include "timer.h"
 #include "ports.h"
 #include "../mm/paging.h"
+#include "../mm/vma.h"
 #include "../kernel/proc/proc.h"
 #include "../kernel/bin.h"
 
@@ -301,7 +302,7 @@ static void isr_panic(registers_t *r) {
         uint32_t* pd = (uint32_t*)RECURSIVE_PD_BASE;
         uint32_t pde = pd[dir_idx];
         kprintf("PDE[%u] = %08x\n", dir_idx, pde);
-        if (pde & PAGE_PRESENT) {
+        if ((pde & PAGE_PRESENT) && !(pde & PDE_PS)) {
             uint32_t* pt = (uint32_t*)(RECURSIVE_PT_BASE + dir_idx * PAGE_SIZE);
             uint32_t pte = pt[table_idx];
             kprintf("PTE[%u] = %08x\n", table_idx, pte);
@@ -332,6 +333,12 @@ void isr_dispatch(registers_t *r) {
         syscall_handler(r);
         return;
     }
+    if (r->int_no == 14) {
+        uint32_t cr2;
+        asm volatile("mov %%cr2, %0" : "=r"(cr2));
+        if (paging_handle_page_fault(cr2, r->err_code)) return;
+        if (vma_handle_fault(cr2, r->err_code, (r->eflags & 0x200u) != 0)) return;
+    }
     if (dispatch_registered_handler(r)) return;
     if (handle_user_exception(r)) return;
     isr_panic(r);
@@ -3,6 +3,7 @@
 #include "screen.h"
 #include "../mm/paging.h"
 #include "../mm/mem.h"
+#include "../mm/dma.h"
 #include "../libc/string.h"
 
 #define AHCI_MAX_CTRLS 4
@@ -170,11 +171,7 @@ static inline void ahci_wr32(const ahci_ctrl_t* c, uint32_t off, uint32_t v) {
 }
 
 static void* ahci_dma_alloc(size_t size, uint32_t* out_phys) {
-    size_t alloc = (size + 0xFFFu) & ~0xFFFu;
-    void* p = kmalloc(alloc, 1, out_phys);
-    if (!p) return NULL;
-    memset(p, 0, alloc);
-    return p;
+    return dma_alloc_coherent(size, DMA_CACHED, out_phys);
 }
 
 static inline hba_port_t* ahci_port_ptr(ahci_ctrl_t* c, uint8_t port_no);
@@ -274,9 +271,9 @@ static bool ahci_build_prdt(void* buf, uint32_t bytes, hba_prdt_t* prdt, uint16_
             return false;
         }
 
-        uint32_t phys;
-        if (vmm_virt_to_phys((uint32_t)virt, &phys) != 0)
-            phys = (uint32_t)virt;
+        uint32_t phys = dma_virt_to_phys((const void*)virt);
+        if (!phys)
+            phys = virt;
 
         uint32_t page_off = phys & 0xFFFu;
         uint32_t chunk = 0x1000u - page_off;
@@ -537,7 +534,7 @@ static void ahci_port_init(ahci_ctrl_t* c, uint8_t port_no) {
             } else {
                 kprintf("[AHCI] port %u IDENTIFY failed\n", port_no);
             }
-            kfree(id);
+            dma_free_coherent(id);
         }
     } else {
         kprintf("[AHCI] port %u non-ATA device (%s)\n",
@@ -7,6 +7,7 @@
 #include "../fs/disk.h"
 #include "../drivers/screen.h"
 #include "ramdisk.h"
+#include "blkcache.h"
 #include "usb/usb.h"
 #include <stdbool.h>
 #include <stdint.h>
@@ -78,6 +79,8 @@ static void ata_build_drive_map(void) {
 }
 
 void ata_refresh_drive_map(void) {
+    // 매핑이 바뀌면 캐시의 drive 번호가 다른 장치를 가리키게 됨
+    blkcache_drop_all();
     ata_build_drive_map();
 }
 
@@ -212,7 +215,7 @@ static bool ata_pata_identify(uint8_t drive, uint16_t* id_data) {
     return true;
 }
 
-bool ata_read(uint8_t drive, uint32_t lba, uint16_t count, uint8_t* buffer) {
+bool ata_read_uncached(uint8_t drive, uint32_t lba, uint16_t count, uint8_t* buffer) {
     if (count == 0) count = 256;        // 256=0 의미
     if (ramdisk_present(drive)) {
         return ramdisk_read(drive, lba, count, buffer);
@@ -257,7 +260,7 @@ bool ata_read(uint8_t drive, uint32_t lba, uint16_t count, uint8_t* buffer) {
     return true;
 }
 
-bool ata_write(uint8_t drive, uint32_t lba, uint16_t count, const uint8_t* buffer) {
+bool ata_write_uncached(uint8_t drive, uint32_t lba, uint16_t count, const uint8_t* buffer) {
     if (count == 0) count = 256;
     if (ramdisk_present(drive)) {
         return ramdisk_write(drive, lba, count, buffer);
@@ -301,6 +304,13 @@ bool ata_write(uint8_t drive, uint32_t lba, uint16_t count, const uint8_t* buffe
     return true;
 }
 
+bool ata_read(uint8_t drive, uint32_t lba, uint16_t count, uint8_t* buffer) {
+    return blkcache_read(drive, lba, count, buffer);
+}
+bool ata_write(uint8_t drive, uint32_t lba, uint16_t count, const uint8_t* buffer) {
+    return blkcache_write(drive, lba, count, buffer);
+}
+
 bool ata_read_sector(uint32_t drive, uint32_t lba, uint8_t* buffer) {
     return ata_read((uint8_t)drive, lba, 1, buffer);
 }
@@ -309,6 +319,10 @@ bool ata_write_sector(uint32_t drive, uint32_t lba, const uint8_t* buffer) {
 }
 
 bool ata_flush_cache(uint8_t drive) {
+    // 캐시에 남은 dirty 섹터부터 장치로
+    if (!blkcache_writeback(drive)) {
+        return false;
+    }
     if (ramdisk_present(drive)) {
         return true;
     }
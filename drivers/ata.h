@@ -6,6 +6,9 @@
 bool ata_present(uint8_t drive);
 bool ata_read(uint8_t drive, uint32_t lba, uint16_t count, uint8_t* buffer);
 bool ata_write(uint8_t drive, uint32_t lba, uint16_t count, const uint8_t* buffer);
+// 섹터 캐시를 거치지 않는 장치 직접 I/O (blkcache 내부용)
+bool ata_read_uncached(uint8_t drive, uint32_t lba, uint16_t count, uint8_t* buffer);
+bool ata_write_uncached(uint8_t drive, uint32_t lba, uint16_t count, const uint8_t* buffer);
 bool ata_read_sector(uint32_t drive, uint32_t lba, uint8_t* buffer);
 bool ata_write_sector(uint32_t drive, uint32_t lba, const uint8_t* buffer);
 void ata_init_all(void);
@@ -0,0 +1,400 @@
+#include "blkcache.h"
+#include "ata.h"
+#include "ramdisk.h"
+#include "screen.h"
+#include "usb/usb.h"
+#include "../cpu/timer.h"
+#include "../fs/disk.h"
+#include "../kernel/proc/timer_task.h"
+#include "../libc/string.h"
+
+#define EFLAGS_IF 0x200u
+
+typedef struct {
+    bool used;
+    bool dirty;
+    bool busy;                  // flusher가 스냅샷을 장치에 쓰는 중. 교체 대상에서 제외
+    uint8_t drive;
+    uint32_t lba;
+    uint32_t last_use;
+    uint32_t dirty_tick;        // 처음 dirty가 된 시각
+    uint32_t flush_pass;        // 마지막으로 기록을 시도한 flush 회차
+    uint8_t data[BLKCACHE_SECTOR_SIZE];
+} blkcache_entry_t;
+
+static blkcache_entry_t entries[BLKCACHE_ENTRIES];
+static uint8_t run_buf[BLKCACHE_RUN_MAX * BLKCACHE_SECTOR_SIZE];
+static uint32_t cache_clock = 0;
+static uint32_t dirty_count = 0;
+static uint32_t age_ticks = 0;
+static uint32_t flush_pass = 0;
+static uint32_t stat_hits = 0;
+static uint32_t stat_misses = 0;
+static uint32_t stat_writebacks = 0;
+static uint32_t stat_flushes = 0;
+// run_buf와 write-back 순서를 지키는 잠금. 장치 I/O 동안에도 인터럽트는 켜 둠
+static volatile bool flush_locked = false;
+
+static inline uint32_t irq_save(void) {
+    uint32_t flags = 0;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+// wait=false면 이미 잡혀 있을 때 바로 포기. 인터럽트가 꺼진 호출자는 기다릴 수 없음
+static bool blkcache_flush_lock(bool wait) {
+    for (;;) {
+        uint32_t flags = irq_save();
+        if (!flush_locked) {
+            flush_locked = true;
+            irq_restore(flags);
+            return true;
+        }
+        irq_restore(flags);
+        if (!wait || !(flags & EFLAGS_IF)) {
+            return false;
+        }
+        __asm__ volatile("pause" ::: "memory");
+    }
+}
+
+static void blkcache_flush_unlock(void) {
+    flush_locked = false;
+}
+
+// 램디스크는 이미 메모리, USB는 빼면 바로 사라지므로 write-through
+static bool blkcache_cacheable(uint8_t drive) {
+    return drive < USB_DRIVE_BASE && !ramdisk_present(drive);
+}
+
+static blkcache_entry_t* blkcache_find(uint8_t drive, uint32_t lba) {
+    for (uint32_t i = 0; i < BLKCACHE_ENTRIES; i++) {
+        blkcache_entry_t* e = &entries[i];
+        if (e->used && e->drive == drive && e->lba == lba) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+// 빈 칸 또는 가장 오래 안 쓴 clean 엔트리. dirty나 기록 중인 것만 남았으면 NULL
+static blkcache_entry_t* blkcache_alloc(uint8_t drive, uint32_t lba) {
+    blkcache_entry_t* victim = NULL;
+    for (uint32_t i = 0; i < BLKCACHE_ENTRIES; i++) {
+        blkcache_entry_t* e = &entries[i];
+        if (!e->used) {
+            victim = e;
+            break;
+        }
+        if (!e->dirty && !e->busy && (!victim || e->last_use < victim->last_use)) {
+            victim = e;
+        }
+    }
+    if (victim) {
+        victim->used = true;
+        victim->dirty = false;
+        victim->busy = false;
+        victim->drive = drive;
+        victim->lba = lba;
+    }
+    return victim;
+}
+
+static bool blkcache_flushable(const blkcache_entry_t* e, int drive, uint32_t min_age,
+                               uint32_t pass, uint32_t now) {
+    return e->used && e->dirty && !e->busy && e->flush_pass != pass &&
+           (drive < 0 || e->drive == drive) && now - e->dirty_tick >= min_age;
+}
+
+// (drive, lba)가 가장 작은 dirty 엔트리부터 연속 구간을 잡아 run_buf에 복사.
+// 복사한 엔트리는 busy로 표시하고 dirty를 내림 (기록 중 다시 쓰이면 dirty가 다시 켜짐)
+static uint32_t blkcache_snapshot_run(int drive, uint32_t min_age, uint32_t pass,
+                                      uint32_t now, blkcache_entry_t** run) {
+    blkcache_entry_t* first = NULL;
+    for (uint32_t i = 0; i < BLKCACHE_ENTRIES; i++) {
+        blkcache_entry_t* e = &entries[i];
+        if (!blkcache_flushable(e, drive, min_age, pass, now)) {
+            continue;
+        }
+        if (!first || e->drive < first->drive ||
+            (e->drive == first->drive && e->lba < first->lba)) {
+            first = e;
+        }
+    }
+    if (!first) {
+        return 0;
+    }
+
+    uint32_t n = 0;
+    blkcache_entry_t* e = first;
+    while (e && n < BLKCACHE_RUN_MAX) {
+        memcpy(run_buf + n * BLKCACHE_SECTOR_SIZE, e->data, BLKCACHE_SECTOR_SIZE);
+        e->busy = true;
+        e->dirty = false;
+        e->flush_pass = pass;
+        dirty_count--;
+        run[n++] = e;
+        e = blkcache_find(first->drive, first->lba + n);
+        if (e && !blkcache_flushable(e, drive, 0, pass, now)) {
+            e = NULL;
+        }
+    }
+    return n;
+}
+
+// dirty 엔트리를 (drive, lba) 순으로 연속 구간씩 기록. 엔트리 조작만 인터럽트를 끄고,
+// 장치 쓰기는 인터럽트를 켠 채로 스냅샷에서 함
+static bool blkcache_flush(int drive, uint32_t min_age, bool wait) {
+    if (!blkcache_flush_lock(wait)) {
+        return !wait;
+    }
+
+    blkcache_entry_t* run[BLKCACHE_RUN_MAX];
+    bool ok = true;
+    uint32_t flags = irq_save();
+    uint32_t pass = ++flush_pass;
+    irq_restore(flags);
+
+    for (;;) {
+        uint32_t now = tick;
+        flags = irq_save();
+        uint32_t n = blkcache_snapshot_run(drive, min_age, pass, now, run);
+        irq_restore(flags);
+        if (n == 0) {
+            break;
+        }
+
+        uint8_t dev = run[0]->drive;
+        uint32_t lba = run[0]->lba;
+        bool written = ata_write_uncached(dev, lba, (uint16_t)n, run_buf);
+        if (!written) {
+            kprintf("[blkcache] write-back failed: drive %u lba %u (%u sectors)\n",
+                    dev, lba, n);
+            ok = false;
+        }
+
+        flags = irq_save();
+        for (uint32_t k = 0; k < n; k++) {
+            blkcache_entry_t* e = run[k];
+            // drop_all이 그 사이 비웠거나 다른 섹터로 재사용됐으면 건드리지 않음
+            if (!e->busy || e->drive != dev || e->lba != lba + k) {
+                continue;
+            }
+            e->busy = false;
+            if (!written && !e->dirty) {
+                e->dirty = true;
+                e->dirty_tick = now;    // 다음 주기에 바로 재시도하지 않도록
+                dirty_count++;
+            }
+        }
+        if (written) {
+            stat_writebacks += n;
+            stat_flushes++;
+        }
+        irq_restore(flags);
+    }
+
+    blkcache_flush_unlock();
+    return ok;
+}
+
+// 주기적으로 sysmgr에서 호출. 다른 flush가 진행 중이면 다음 주기로 미룸
+static void blkcache_flush_task(void* ctx) {
+    (void)ctx;
+    if (dirty_count > 0) {
+        blkcache_flush(-1, age_ticks, false);
+    }
+}
+
+void blkcache_init(void) {
+    memset(entries, 0, sizeof(entries));
+    dirty_count = 0;
+    uint32_t hz = timer_frequency();
+    if (hz == 0) {
+        hz = 100;
+    }
+    age_ticks = BLKCACHE_DIRTY_AGE_MS * hz / 1000u;
+    if (timer_task_schedule_ms(BLKCACHE_FLUSH_MS, BLKCACHE_FLUSH_MS,
+                               blkcache_flush_task, NULL) < 0) {
+        kprint("[blkcache] failed to schedule flusher\n");
+    }
+}
+
+bool blkcache_read(uint8_t drive, uint32_t lba, uint16_t count, uint8_t* buffer) {
+    if (!blkcache_cacheable(drive)) {
+        return ata_read_uncached(drive, lba, count, buffer);
+    }
+    uint32_t n = count ? count : 256u;
+
+    if (n == 1) {
+        uint32_t flags = irq_save();
+        blkcache_entry_t* e = blkcache_find(drive, lba);
+        if (e) {
+            memcpy(buffer, e->data, BLKCACHE_SECTOR_SIZE);
+            e->last_use = ++cache_clock;
+            stat_hits++;
+            irq_restore(flags);
+            return true;
+        }
+        stat_misses++;
+        irq_restore(flags);
+
+        bool ok = ata_read_uncached(drive, lba, 1, buffer);
+        if (ok) {
+            flags = irq_save();
+            // 읽는 동안 다른 쪽이 같은 섹터를 써 넣었으면 그 내용이 최신
+            e = blkcache_find(drive, lba);
+            if (e) {
+                memcpy(buffer, e->data, BLKCACHE_SECTOR_SIZE);
+            } else {
+                e = blkcache_alloc(drive, lba);
+                if (e) {
+                    memcpy(e->data, buffer, BLKCACHE_SECTOR_SIZE);
+                }
+            }
+            if (e) {
+                e->last_use = ++cache_clock;
+            }
+            irq_restore(flags);
+        }
+        return ok;
+    }
+
+    // 여러 섹터는 장치에서 읽고, 캐시에 있는 최신 내용으로 덮어씀
+    bool ok = ata_read_uncached(drive, lba, count, buffer);
+    if (ok) {
+        uint32_t flags = irq_save();
+        for (uint32_t i = 0; i < BLKCACHE_ENTRIES; i++) {
+            const blkcache_entry_t* e = &entries[i];
+            if (e->used && e->drive == drive && e->lba - lba < n) {
+                memcpy(buffer + (e->lba - lba) * BLKCACHE_SECTOR_SIZE, e->data,
+                       BLKCACHE_SECTOR_SIZE);
+            }
+        }
+        irq_restore(flags);
+    }
+    return ok;
+}
+
+// FAT/비트맵/디렉터리 같은 메타데이터 섹터: dirty로 두고 나중에 기록
+static bool blkcache_store(uint8_t drive, uint32_t lba, const uint8_t* buffer, bool* over_high) {
+    uint32_t flags = irq_save();
+    blkcache_entry_t* e = blkcache_find(drive, lba);
+    if (!e) {
+        e = blkcache_alloc(drive, lba);
+    }
+    if (!e) {
+        irq_restore(flags);
+        return false;
+    }
+    memcpy(e->data, buffer, BLKCACHE_SECTOR_SIZE);
+    e->last_use = ++cache_clock;
+    if (!e->dirty) {
+        e->dirty = true;
+        e->dirty_tick = tick;
+        dirty_count++;
+    }
+    *over_high = dirty_count >= BLKCACHE_DIRTY_HIGH;
+    irq_restore(flags);
+    return true;
+}
+
+bool blkcache_write(uint8_t drive, uint32_t lba, uint16_t count, const uint8_t* buffer) {
+    if (!blkcache_cacheable(drive)) {
+        return ata_write_uncached(drive, lba, count, buffer);
+    }
+    uint32_t n = count ? count : 256u;
+
+    if (n == 1) {
+        bool over_high = false;
+        if (!blkcache_store(drive, lba, buffer, &over_high)) {
+            blkcache_flush(-1, 0, true);
+            if (!blkcache_store(drive, lba, buffer, &over_high)) {
+                return ata_write_uncached(drive, lba, 1, buffer);
+            }
+        }
+        // 다른 flush가 진행 중이면 그쪽이 줄여 주므로 기다리지 않음
+        return over_high ? blkcache_flush(-1, 0, false) : true;
+    }
+
+    // 큰 쓰기(파일 데이터)는 바로 장치로. 겹치는 캐시 엔트리는 새 내용으로 맞춤
+    bool ok = ata_write_uncached(drive, lba, count, buffer);
+    if (ok) {
+        uint32_t flags = irq_save();
+        for (uint32_t i = 0; i < BLKCACHE_ENTRIES; i++) {
+            blkcache_entry_t* e = &entries[i];
+            if (!e->used || e->drive != drive || e->lba - lba >= n) {
+                continue;
+            }
+            memcpy(e->data, buffer + (e->lba - lba) * BLKCACHE_SECTOR_SIZE,
+                   BLKCACHE_SECTOR_SIZE);
+            if (e->busy) {
+                // 기록 중인 옛 스냅샷이 나중에 덮어쓸 수 있으므로 새 내용을 한 번 더 기록
+                if (!e->dirty) {
+                    e->dirty = true;
+                    e->dirty_tick = tick;
+                    dirty_count++;
+                }
+            } else if (e->dirty) {
+                e->dirty = false;
+                dirty_count--;
+            }
+        }
+        irq_restore(flags);
+    }
+    return ok;
+}
+
+bool blkcache_writeback(int drive) {
+    return blkcache_flush(drive, 0, true);
+}
+
+bool blkcache_sync_drive(uint8_t drive) {
+    return ata_flush_cache(drive);
+}
+
+bool blkcache_sync_all(void) {
+    bool ok = blkcache_writeback(-1);
+    for (int d = 0; d < MAX_DISKS; d++) {
+        if (disks[d].present && !ata_flush_cache((uint8_t)d)) {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// 드라이브 번호 매핑이 바뀌기 전에 호출: 기록 후 전부 비움
+void blkcache_drop_all(void) {
+    if (!blkcache_flush(-1, 0, true)) {
+        kprint("[blkcache] dropping unwritten sectors\n");
+    }
+    uint32_t flags = irq_save();
+    memset(entries, 0, sizeof(entries));
+    dirty_count = 0;
+    irq_restore(flags);
+}
+
+void blkcache_get_stats(blkcache_stats_t* out) {
+    if (!out) {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+    uint32_t flags = irq_save();
+    for (uint32_t i = 0; i < BLKCACHE_ENTRIES; i++) {
+        if (entries[i].used) {
+            out->cached++;
+        }
+    }
+    out->dirty = dirty_count;
+    out->hits = stat_hits;
+    out->misses = stat_misses;
+    out->writebacks = stat_writebacks;
+    out->flushes = stat_flushes;
+    irq_restore(flags);
+}
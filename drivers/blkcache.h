@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BLKCACHE_ENTRIES      128
+#define BLKCACHE_SECTOR_SIZE  512
+#define BLKCACHE_DIRTY_HIGH   (BLKCACHE_ENTRIES * 3 / 4)  // 넘으면 바로 write-back
+#define BLKCACHE_DIRTY_AGE_MS 3000                        // 이보다 오래된 dirty는 flusher가 기록
+#define BLKCACHE_FLUSH_MS     500                         // flusher 주기
+#define BLKCACHE_RUN_MAX      32                          // 한 번에 이어서 쓰는 최대 섹터 수
+
+typedef struct {
+    uint32_t cached;
+    uint32_t dirty;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t writebacks;   // 기록한 섹터 수
+    uint32_t flushes;      // 기록 요청(연속 구간) 수
+} blkcache_stats_t;
+
+// ata_read/ata_write가 부르는 캐시 경로. 램디스크/USB는 그대로 통과.
+bool blkcache_read(uint8_t drive, uint32_t lba, uint16_t count, uint8_t* buffer);
+bool blkcache_write(uint8_t drive, uint32_t lba, uint16_t count, const uint8_t* buffer);
+
+void blkcache_init(void);
+bool blkcache_writeback(int drive);     // drive < 0 이면 전체, 장치 캐시 flush는 안 함
+bool blkcache_sync_drive(uint8_t drive);
+bool blkcache_sync_all(void);
+void blkcache_drop_all(void);
+void blkcache_get_stats(blkcache_stats_t* out);
@@ -4,6 +4,7 @@
 #include "../drivers/screen.h"
 #include "../libc/string.h"
 #include "../mm/mem.h"
+#include "../mm/dma.h"
 #include "../mm/paging.h"
 #include <stddef.h>
 #include <stdint.h>
@@ -615,19 +616,11 @@ static bool hda_alloc_dma(void) {
     if (g_hda->bdl)
         return true;
 
-    hda_bdl_entry_t* bdl = (hda_bdl_entry_t*)kmalloc_aligned(sizeof(hda_bdl_entry_t) * HDA_BDL_ENTRIES, 1024);
-    if (!bdl) {
-        kprint("[HDA] kmalloc_aligned failed for BDL\n");
-        return false;
-    }
-    memset(bdl, 0, sizeof(hda_bdl_entry_t) * HDA_BDL_ENTRIES);
-
     uint32_t bdl_phys = 0;
-    if (vmm_virt_to_phys((uint32_t)bdl, &bdl_phys) != 0) {
-        bdl_phys = (uint32_t)bdl;
-    }
-    if (bdl_phys & 0x3FFu) {
-        kprintf("[HDA] BDL not 1KB aligned (phys=%08X)\n", bdl_phys);
+    hda_bdl_entry_t* bdl = (hda_bdl_entry_t*)dma_alloc_coherent(
+        sizeof(hda_bdl_entry_t) * HDA_BDL_ENTRIES, DMA_CACHED, &bdl_phys);
+    if (!bdl) {
+        kprint("[HDA] DMA alloc failed for BDL\n");
         return false;
     }
 
@@ -636,14 +629,13 @@ static bool hda_alloc_dma(void) {
 
     for (uint32_t i = 0; i < HDA_BDL_ENTRIES; i++) {
         uint32_t phys = 0;
-        void* buf = kmalloc(HDA_BUFFER_BYTES, 1, &phys);
+        void* buf = dma_alloc_coherent(HDA_BUFFER_BYTES, DMA_CACHED, &phys);
         if (!buf) {
-            kprintf("[HDA] kmalloc failed for buffer %d\n", (int)i);
+            kprintf("[HDA] DMA alloc failed for buffer %d\n", (int)i);
             return false;
         }
         g_hda->buffers[i] = buf;
         g_hda->buffers_phys[i] = phys;
-        memset(buf, 0, HDA_BUFFER_BYTES);
 
         g_hda->bdl[i].addr = (uint64_t)phys;
         g_hda->bdl[i].len = HDA_BUFFER_BYTES;
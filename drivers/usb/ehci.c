@@ -5,6 +5,7 @@
 #include "../screen.h"
 #include "../../mm/mem.h"
 #include "../../mm/paging.h"
+#include "../../mm/dma.h"
 #include "../../cpu/timer.h"
 #include "../../libc/string.h"
 #include "../../kernel/proc/workqueue.h"
@@ -272,24 +273,25 @@ static const usb_hc_ops_t ehci_usbhc_ops = {
 #define EHCI_PTR_QH    (1u << 1) // type=QH
 
 static inline uint32_t phys_addr(void* p) {
-    uint32_t phys;
-    if (vmm_virt_to_phys((uint32_t)p, &phys) == 0)
-        return phys;
-    kprintf("[EHCI] v2p failed for %08x\n", (uint32_t)p);
-    return 0;
+    uint32_t phys = dma_virt_to_phys(p);
+    if (!phys)
+        kprintf("[EHCI] v2p failed for %08x\n", (uint32_t)p);
+    return phys;
 }
 
+static dma_pool_t* ehci_qh_pool;
+static dma_pool_t* ehci_qtd_pool;
+
+// QH/qTD는 32바이트 정렬 풀에서 (4KB 경계를 넘지 않음), 나머지는 페이지 단위
 static void* ehci_dma_alloc(size_t size) {
-    // EHCI descriptors must not cross a 4KB boundary; use page-aligned allocations to be safe.
-    void* p = kmalloc(size, 1, NULL);
-    if (!p)
-        return NULL;
-    if ((((uintptr_t)p) & 0xFFFu) + size > 0x1000u) {
-        kfree(p);
-        return NULL;
-    }
-    memset(p, 0, size);
-    return p;
+    if (!ehci_qh_pool) ehci_qh_pool = dma_pool_create("ehci_qh", sizeof(ehci_qh_t), 32, DMA_CACHED);
+    if (!ehci_qtd_pool) ehci_qtd_pool = dma_pool_create("ehci_qtd", sizeof(ehci_qtd_t), 32, DMA_CACHED);
+
+    if (size == sizeof(ehci_qh_t))
+        return dma_pool_alloc(ehci_qh_pool, NULL);
+    if (size == sizeof(ehci_qtd_t))
+        return dma_pool_alloc(ehci_qtd_pool, NULL);
+    return dma_alloc_coherent(size, DMA_CACHED, NULL);
 }
 
 static inline uint32_t cap_rd(ehci_ctrl_t* hc, uint32_t off) {
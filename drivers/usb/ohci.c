@@ -4,6 +4,7 @@
 #include "../screen.h"
 #include "../../mm/mem.h"
 #include "../../mm/paging.h"
+#include "../../mm/dma.h"
 #include "../../cpu/timer.h"
 #include "../../libc/string.h"
 #include "../../kernel/proc/workqueue.h"
@@ -137,10 +138,21 @@ struct ohci_async_in {
 };
 
 static inline uint32_t phys_addr(void* p) {
-    uint32_t phys;
-    if (vmm_virt_to_phys((uint32_t)p, &phys) == 0)
-        return phys;
-    return (uint32_t)p;
+    uint32_t phys = dma_virt_to_phys(p);
+    return phys ? phys : (uint32_t)p;
+}
+
+static dma_pool_t* ohci_ed_pool;
+static dma_pool_t* ohci_td_pool;
+
+static ohci_ed_t* ohci_alloc_ed(void) {
+    if (!ohci_ed_pool) ohci_ed_pool = dma_pool_create("ohci_ed", sizeof(ohci_ed_t), 16, DMA_CACHED);
+    return (ohci_ed_t*)dma_pool_alloc(ohci_ed_pool, NULL);
+}
+
+static ohci_td_t* ohci_alloc_td(void) {
+    if (!ohci_td_pool) ohci_td_pool = dma_pool_create("ohci_td", sizeof(ohci_td_t), 16, DMA_CACHED);
+    return (ohci_td_t*)dma_pool_alloc(ohci_td_pool, NULL);
 }
 
 static inline uint32_t rd_reg(ohci_ctrl_t* hc, uint32_t off) {
@@ -437,13 +449,10 @@ static bool ohci_usbhc_async_in_init(usb_hc_t* hc, usb_async_in_t* x,
     a->buf_phys = phys_addr(buf);
     a->len = len;
 
-    a->ed = (ohci_ed_t*)kmalloc_aligned(sizeof(ohci_ed_t), 16);
-    a->td = (ohci_td_t*)kmalloc_aligned(sizeof(ohci_td_t), 16);
-    a->tail = (ohci_td_t*)kmalloc_aligned(sizeof(ohci_td_t), 16);
+    a->ed = ohci_alloc_ed();
+    a->td = ohci_alloc_td();
+    a->tail = ohci_alloc_td();
     if (!a->ed || !a->td || !a->tail) return false;
-    memset(a->ed, 0, sizeof(*a->ed));
-    memset(a->td, 0, sizeof(*a->td));
-    memset(a->tail, 0, sizeof(*a->tail));
 
     init_td(a->tail, TD_DP_OUT, TD_T_DATA0, NULL, 0, false);
 
@@ -723,21 +732,20 @@ void ohci_pci_attach(uint32_t mmio_base, uint8_t irq_line) {
     usbhc_wrappers[idx].ops = &ohci_usbhc_ops;
     usbhc_wrappers[idx].impl = hc;
 
-    hc->hcca = (ohci_hcca_t*)kmalloc_aligned(sizeof(ohci_hcca_t), 256);
-    memset(hc->hcca, 0, sizeof(*hc->hcca));
-
-    hc->ctrl_ed = (ohci_ed_t*)kmalloc_aligned(sizeof(ohci_ed_t), 16);
-    hc->ctrl_td_setup  = (ohci_td_t*)kmalloc_aligned(sizeof(ohci_td_t), 16);
-    hc->ctrl_td_data   = (ohci_td_t*)kmalloc_aligned(sizeof(ohci_td_t), 16);
-    hc->ctrl_td_status = (ohci_td_t*)kmalloc_aligned(sizeof(ohci_td_t), 16);
-    hc->ctrl_td_tail   = (ohci_td_t*)kmalloc_aligned(sizeof(ohci_td_t), 16);
-
-    hc->bulk_in_ed   = (ohci_ed_t*)kmalloc_aligned(sizeof(ohci_ed_t), 16);
-    hc->bulk_out_ed  = (ohci_ed_t*)kmalloc_aligned(sizeof(ohci_ed_t), 16);
-    hc->bulk_in_td   = (ohci_td_t*)kmalloc_aligned(sizeof(ohci_td_t), 16);
-    hc->bulk_in_tail = (ohci_td_t*)kmalloc_aligned(sizeof(ohci_td_t), 16);
-    hc->bulk_out_td  = (ohci_td_t*)kmalloc_aligned(sizeof(ohci_td_t), 16);
-    hc->bulk_out_tail= (ohci_td_t*)kmalloc_aligned(sizeof(ohci_td_t), 16);
+    hc->hcca = (ohci_hcca_t*)dma_alloc_coherent(sizeof(ohci_hcca_t), DMA_CACHED, NULL);
+
+    hc->ctrl_ed = ohci_alloc_ed();
+    hc->ctrl_td_setup  = ohci_alloc_td();
+    hc->ctrl_td_data   = ohci_alloc_td();
+    hc->ctrl_td_status = ohci_alloc_td();
+    hc->ctrl_td_tail   = ohci_alloc_td();
+
+    hc->bulk_in_ed   = ohci_alloc_ed();
+    hc->bulk_out_ed  = ohci_alloc_ed();
+    hc->bulk_in_td   = ohci_alloc_td();
+    hc->bulk_in_tail = ohci_alloc_td();
+    hc->bulk_out_td  = ohci_alloc_td();
+    hc->bulk_out_tail= ohci_alloc_td();
 
     ohci_legacy_handoff(hc);
     if (!ohci_reset_controller(hc)) return;
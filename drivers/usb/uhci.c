@@ -4,6 +4,7 @@
 #include "../mouse.h"
 #include "../../mm/mem.h"
 #include "../../mm/paging.h"
+#include "../../mm/dma.h"
 #include "../../cpu/timer.h"
 #include "../../libc/string.h"
 #include "../hal.h"
@@ -134,9 +135,8 @@ static uhci_ctrl_t controllers[UHCI_MAX_CONTROLLERS];
 #define PID_SETUP 0x2Du
 
 static inline uint32_t phys_addr(void* p) {
-    uint32_t phys;
-    if (vmm_virt_to_phys((uint32_t)p, &phys) == 0) return phys;
-    return (uint32_t)p;
+    uint32_t phys = dma_virt_to_phys(p);
+    return phys ? phys : (uint32_t)p;
 }
 
 static inline uint16_t rd16(uint16_t io, uint16_t off) {
@@ -330,41 +330,65 @@ typedef struct {
 #define USB_REQ_SET_ADDRESS 5
 #define USB_REQ_SET_CONFIGURATION 9
 
+// 컨트롤 전송마다 QH/TD를 새로 잡으므로 전용 DMA 풀에서 할당
+// 데이터 단계 TD 수 상한 (HID 리포트 디스크립터 1KB를 8바이트 패킷으로 읽는 경우)
+#define UHCI_CTRL_MAX_DATA_TDS 128
+
+static dma_pool_t* uhci_qh_pool;
+static dma_pool_t* uhci_td_pool;
+
+static void uhci_pools_init(void) {
+    if (!uhci_qh_pool) uhci_qh_pool = dma_pool_create("uhci_qh", sizeof(uhci_qh_t), 16, DMA_CACHED);
+    if (!uhci_td_pool) uhci_td_pool = dma_pool_create("uhci_td", sizeof(uhci_td_t), 16, DMA_CACHED);
+}
+
 static bool uhci_control_transfer(uhci_ctrl_t* hc, bool low_speed,
                                   uint8_t addr, uint8_t ep0_mps,
                                   usb_setup_pkt_t* setup, void* data, uint16_t len) {
     if (ep0_mps == 0) ep0_mps = 8;
 
-    uhci_qh_t* qh = (uhci_qh_t*)kmalloc_aligned(sizeof(uhci_qh_t), 16);
-    uhci_td_t* td_setup = (uhci_td_t*)kmalloc_aligned(sizeof(uhci_td_t), 16);
-    uhci_td_t* td_status = (uhci_td_t*)kmalloc_aligned(sizeof(uhci_td_t), 16);
-    if (!qh || !td_setup || !td_status) return false;
+    uhci_pools_init();
 
-    memset(qh, 0, sizeof(*qh));
-    memset(td_setup, 0, sizeof(*td_setup));
-    memset(td_status, 0, sizeof(*td_status));
+    uhci_qh_t* qh = (uhci_qh_t*)dma_pool_alloc(uhci_qh_pool, NULL);
+    uhci_td_t* td_setup = (uhci_td_t*)dma_pool_alloc(uhci_td_pool, NULL);
+    uhci_td_t* td_status = (uhci_td_t*)dma_pool_alloc(uhci_td_pool, NULL);
+    if (!qh || !td_setup || !td_status) {
+        dma_pool_free(uhci_qh_pool, qh);
+        dma_pool_free(uhci_td_pool, td_setup);
+        dma_pool_free(uhci_td_pool, td_status);
+        return false;
+    }
 
     bool has_data = (len > 0 && data != NULL);
     bool data_in = has_data && (setup->bmRequestType & 0x80);
 
-    // Data TDs (one packet per TD)
-    uhci_td_t* data_tds = NULL;
+    // Data TDs (one packet per TD), 다른 TD와 같은 풀에서 하나씩 할당
+    uhci_td_t* data_tds[UHCI_CTRL_MAX_DATA_TDS];
     uint16_t data_td_count = 0;
     if (has_data) {
-        data_td_count = (uint16_t)((len + ep0_mps - 1) / ep0_mps);
-        data_tds = (uhci_td_t*)kmalloc_aligned((size_t)data_td_count * sizeof(uhci_td_t), 16);
-        if (!data_tds) {
-            kfree(qh);
-            kfree(td_setup);
-            kfree(td_status);
+        uint32_t want = ((uint32_t)len + ep0_mps - 1) / ep0_mps;
+        bool alloc_ok = want <= UHCI_CTRL_MAX_DATA_TDS;
+        while (alloc_ok && data_td_count < want) {
+            uhci_td_t* td = (uhci_td_t*)dma_pool_alloc(uhci_td_pool, NULL);
+            if (!td) {
+                alloc_ok = false;
+                break;
+            }
+            data_tds[data_td_count++] = td;
+        }
+        if (!alloc_ok) {
+            for (uint16_t i = 0; i < data_td_count; i++)
+                dma_pool_free(uhci_td_pool, data_tds[i]);
+            dma_pool_free(uhci_qh_pool, qh);
+            dma_pool_free(uhci_td_pool, td_setup);
+            dma_pool_free(uhci_td_pool, td_status);
             return false;
         }
-        memset(data_tds, 0, (size_t)data_td_count * sizeof(uhci_td_t));
     }
 
     // Setup TD (DATA0)
     td_init(td_setup,
-            has_data ? (phys_addr(&data_tds[0]) | UHCI_PTR_DF) : (phys_addr(td_status) | UHCI_PTR_DF),
+            has_data ? (phys_addr(data_tds[0]) | UHCI_PTR_DF) : (phys_addr(td_status) | UHCI_PTR_DF),
             low_speed,
             PID_SETUP, addr, 0, 0, setup, 8, false);
 
@@ -378,9 +402,9 @@ static bool uhci_control_transfer(uhci_ctrl_t* hc, bool low_speed,
             if (chunk > ep0_mps) chunk = ep0_mps;
             remaining = (uint16_t)(remaining - chunk);
 
-            uint32_t next = (i + 1 < data_td_count) ? phys_addr(&data_tds[i + 1]) : phys_addr(td_status);
+            uint32_t next = (i + 1 < data_td_count) ? phys_addr(data_tds[i + 1]) : phys_addr(td_status);
             next |= UHCI_PTR_DF;
-            td_init(&data_tds[i], next, low_speed, pid, addr, 0, toggle, p, chunk, false);
+            td_init(data_tds[i], next, low_speed, pid, addr, 0, toggle, p, chunk, false);
             toggle ^= 1u;
             p += chunk;
         }
@@ -404,10 +428,11 @@ static bool uhci_control_transfer(uhci_ctrl_t* hc, bool low_speed,
     // Remove from schedule (restore).
     hc->sched_qh->head = old_head;
 
-    if (data_tds) kfree(data_tds);
-    kfree(qh);
-    kfree(td_setup);
-    kfree(td_status);
+    for (uint16_t i = 0; i < data_td_count; i++)
+        dma_pool_free(uhci_td_pool, data_tds[i]);
+    dma_pool_free(uhci_qh_pool, qh);
+    dma_pool_free(uhci_td_pool, td_setup);
+    dma_pool_free(uhci_td_pool, td_status);
 
     return ok;
 }
@@ -1126,11 +1151,10 @@ static bool uhci_hid_init(uhci_ctrl_t* hc, bool low_speed, uint8_t addr,
     dev->toggle = 0;
     dev->poll_len = mps;
 
-    dev->qh = (uhci_qh_t*)kmalloc_aligned(sizeof(uhci_qh_t), 16);
-    dev->td = (uhci_td_t*)kmalloc_aligned(sizeof(uhci_td_t), 16);
+    uhci_pools_init();
+    dev->qh = (uhci_qh_t*)dma_pool_alloc(uhci_qh_pool, NULL);
+    dev->td = (uhci_td_t*)dma_pool_alloc(uhci_td_pool, NULL);
     if (!dev->qh || !dev->td) return false;
-    memset(dev->qh, 0, sizeof(*dev->qh));
-    memset(dev->td, 0, sizeof(*dev->td));
 
     dev->report_proto = false;
     memset(&dev->report, 0, sizeof(dev->report));
@@ -1309,12 +1333,11 @@ void uhci_pci_attach(uint8_t bus, uint8_t dev, uint8_t func,
     hc->irq_line = irq_line;
     hc->next_addr = 1;
 
-    hc->frame_list = (uint32_t*)kmalloc_aligned(1024 * sizeof(uint32_t), 4096);
-    hc->sched_qh = (uhci_qh_t*)kmalloc_aligned(sizeof(uhci_qh_t), 16);
+    uhci_pools_init();
+    hc->frame_list = (uint32_t*)dma_alloc_coherent(1024 * sizeof(uint32_t), DMA_CACHED, NULL);
+    hc->sched_qh = (uhci_qh_t*)dma_pool_alloc(uhci_qh_pool, NULL);
     hc->tail_qh = hc->sched_qh;
     if (!hc->frame_list || !hc->sched_qh) return;
-    memset(hc->frame_list, 0, 1024 * sizeof(uint32_t));
-    memset(hc->sched_qh, 0, sizeof(*hc->sched_qh));
 
     hc->sched_qh->head = UHCI_PTR_TERM;
     hc->sched_qh->elem = UHCI_PTR_TERM;
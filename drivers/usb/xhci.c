@@ -6,6 +6,7 @@
 #include "../screen.h"
 #include "../../mm/mem.h"
 #include "../../mm/paging.h"
+#include "../../mm/dma.h"
 #include "../../cpu/timer.h"
 #include "../../libc/string.h"
 #include "../../kernel/proc/workqueue.h"
@@ -160,9 +161,8 @@ static void xhci_queue_rescan(void) {
 }
 
 static inline uint32_t phys_addr32(void* p) {
-    uint32_t phys;
-    if (vmm_virt_to_phys((uint32_t)p, &phys) == 0) return phys;
-    return (uint32_t)p;
+    uint32_t phys = dma_virt_to_phys(p);
+    return phys ? phys : (uint32_t)p;
 }
 
 static inline void mmio_wr32(volatile uint32_t* base, uint32_t off, uint32_t v) {
@@ -332,11 +332,7 @@ static void ring_init(xhci_ring_t* r, uint32_t trb_count) {
     memset(r, 0, sizeof(*r));
     r->trb_count = trb_count;
     // xHCI rings are DMA'd by the controller and must be physically contiguous.
-    // Our heap maps pages on-demand and may not give contiguous physical pages, so keep
-    // rings page-aligned to ensure a 4K ring stays within a single physical page.
-    r->trbs = (xhci_trb_t*)kmalloc_aligned(sizeof(xhci_trb_t) * trb_count, 0x1000);
-    memset(r->trbs, 0, sizeof(xhci_trb_t) * trb_count);
-    r->trbs_phys = phys_addr32(r->trbs);
+    r->trbs = (xhci_trb_t*)dma_alloc_coherent(sizeof(xhci_trb_t) * trb_count, DMA_CACHED, &r->trbs_phys);
     r->enqueue = 0;
     r->cycle = 1;
 
@@ -353,9 +349,7 @@ static void event_ring_init(xhci_ring_t* r, uint32_t trb_count) {
     memset(r, 0, sizeof(*r));
     r->trb_count = trb_count;
     // Same DMA contiguity requirement as transfer rings.
-    r->trbs = (xhci_trb_t*)kmalloc_aligned(sizeof(xhci_trb_t) * trb_count, 0x1000);
-    memset(r->trbs, 0, sizeof(xhci_trb_t) * trb_count);
-    r->trbs_phys = phys_addr32(r->trbs);
+    r->trbs = (xhci_trb_t*)dma_alloc_coherent(sizeof(xhci_trb_t) * trb_count, DMA_CACHED, &r->trbs_phys);
     r->enqueue = 0; // dequeue index
     r->cycle = 1;
 }
@@ -756,13 +750,13 @@ static void xhci_release_slot(xhci_ctrl_t* x, uint8_t slot_id) {
 
     for (int i = 0; i < XHCI_MAX_DCI; i++) {
         if (d->ep_rings[i].trbs) {
-            kfree(d->ep_rings[i].trbs);
+            dma_free_coherent(d->ep_rings[i].trbs);
         }
         memset(&d->ep_rings[i], 0, sizeof(d->ep_rings[i]));
     }
 
-    if (d->dc) kfree(d->dc);
-    if (d->ic) kfree(d->ic);
+    if (d->dc) dma_free_coherent(d->dc);
+    if (d->ic) dma_free_coherent(d->ic);
 
     memset(d, 0, sizeof(*d));
 }
@@ -1136,13 +1130,9 @@ static bool xhci_usbhc_enum_open(usb_hc_t* hc, uint8_t root_port, usb_speed_t sp
     d->context_entries = 1;
 
     // Device/Input contexts are DMA'd; keep them within a single physical page.
-    d->dc = kmalloc_aligned((uint32_t)d->ctx_size * 32u, 0x1000);
-    d->ic = kmalloc_aligned((uint32_t)d->ctx_size * 33u, 0x1000);
+    d->dc = dma_alloc_coherent((uint32_t)d->ctx_size * 32u, DMA_CACHED, &d->dc_phys);
+    d->ic = dma_alloc_coherent((uint32_t)d->ctx_size * 33u, DMA_CACHED, &d->ic_phys);
     if (!d->dc || !d->ic) return false;
-    memset(d->dc, 0, (uint32_t)d->ctx_size * 32u);
-    memset(d->ic, 0, (uint32_t)d->ctx_size * 33u);
-    d->dc_phys = phys_addr32(d->dc);
-    d->ic_phys = phys_addr32(d->ic);
 
     // Update DCBAA slot pointer.
     x->dcbaa[slot_id * 2] = d->dc_phys;
@@ -1405,9 +1395,7 @@ static bool xhci_init(xhci_ctrl_t* x) {
 
     // DCBAA (max_slots+1 entries, each 64-bit -> 2 dwords)
     // DMA'd by the controller; keep within a single physical page.
-    x->dcbaa = (uint32_t*)kmalloc_aligned((uint32_t)(x->max_slots + 1u) * 8u, 0x1000);
-    memset(x->dcbaa, 0, (uint32_t)(x->max_slots + 1u) * 8u);
-    x->dcbaa_phys = phys_addr32(x->dcbaa);
+    x->dcbaa = (uint32_t*)dma_alloc_coherent((uint32_t)(x->max_slots + 1u) * 8u, DMA_CACHED, &x->dcbaa_phys);
     mmio_wr64(x->op, XHCI_DCBAAP, (uint64_t)x->dcbaa_phys);
 
     // Command ring
@@ -1417,9 +1405,7 @@ static bool xhci_init(xhci_ctrl_t* x) {
     // Event ring + ERST (1 segment)
     event_ring_init(&x->evt_ring, 256);
 
-    x->erst = (xhci_erst_t*)kmalloc_aligned(sizeof(xhci_erst_t), 0x1000);
-    memset(x->erst, 0, sizeof(*x->erst));
-    x->erst_phys = phys_addr32(x->erst);
+    x->erst = (xhci_erst_t*)dma_alloc_coherent(sizeof(xhci_erst_t), DMA_CACHED, &x->erst_phys);
     x->erst[0].seg_addr_lo = x->evt_ring.trbs_phys;
     x->erst[0].seg_addr_hi = 0;
     x->erst[0].seg_size = x->evt_ring.trb_count;
@@ -0,0 +1,188 @@
+#include "dcache.h"
+#include "../libc/string.h"
+
+#define EFLAGS_IF 0x200u
+
+typedef struct {
+    bool used;
+    bool nocase;
+    uint8_t type;
+    int drive;
+    uint32_t parent;
+    uint32_t node;
+    uint32_t hash;
+    uint32_t last_use;
+    char name[DCACHE_NAME_MAX];
+} dcache_entry_t;
+
+static dcache_entry_t dcache[DCACHE_BUCKETS][DCACHE_WAYS];
+static uint32_t dcache_clock = 0;
+static uint32_t dcache_hits = 0;
+static uint32_t dcache_misses = 0;
+static uint32_t dcache_invalidations = 0;
+
+static inline uint32_t irq_save(void) {
+    uint32_t flags = 0;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+static uint32_t dcache_hash(int drive, uint32_t parent, const char* name, bool nocase) {
+    uint32_t h = 2166136261u;
+    h = (h ^ (uint32_t)drive) * 16777619u;
+    h = (h ^ parent) * 16777619u;
+    while (*name) {
+        char c = nocase ? tolower(*name) : *name;
+        h ^= (uint8_t)c;
+        h *= 16777619u;
+        name++;
+    }
+    return h;
+}
+
+static dcache_entry_t* dcache_find(uint32_t hash, int drive, uint32_t parent,
+                                   const char* name, bool nocase) {
+    dcache_entry_t* set = dcache[hash % DCACHE_BUCKETS];
+    for (int i = 0; i < DCACHE_WAYS; i++) {
+        dcache_entry_t* e = &set[i];
+        if (!e->used || e->hash != hash || e->drive != drive ||
+            e->parent != parent || e->nocase != nocase) {
+            continue;
+        }
+        if ((nocase ? strcasecmp(e->name, name) : strcmp(e->name, name)) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+bool dcache_lookup(int drive, uint32_t parent, const char* name, bool nocase,
+                   uint8_t* out_type, uint32_t* out_node) {
+    if (!name || strlen(name) >= DCACHE_NAME_MAX) {
+        return false;
+    }
+    uint32_t hash = dcache_hash(drive, parent, name, nocase);
+    uint32_t flags = irq_save();
+    dcache_entry_t* e = dcache_find(hash, drive, parent, name, nocase);
+    if (!e) {
+        dcache_misses++;
+        irq_restore(flags);
+        return false;
+    }
+    e->last_use = ++dcache_clock;
+    dcache_hits++;
+    if (out_type) *out_type = e->type;
+    if (out_node) *out_node = e->node;
+    irq_restore(flags);
+    return true;
+}
+
+void dcache_insert(int drive, uint32_t parent, const char* name, bool nocase,
+                   uint8_t type, uint32_t node) {
+    if (!name || !name[0] || strlen(name) >= DCACHE_NAME_MAX) {
+        return;
+    }
+    uint32_t hash = dcache_hash(drive, parent, name, nocase);
+    uint32_t flags = irq_save();
+    dcache_entry_t* e = dcache_find(hash, drive, parent, name, nocase);
+    if (!e) {
+        // 빈 칸이 없으면 같은 버킷에서 가장 오래 안 쓴 엔트리를 교체
+        dcache_entry_t* set = dcache[hash % DCACHE_BUCKETS];
+        e = &set[0];
+        for (int i = 0; i < DCACHE_WAYS; i++) {
+            if (!set[i].used) {
+                e = &set[i];
+                break;
+            }
+            if (set[i].last_use < e->last_use) {
+                e = &set[i];
+            }
+        }
+        e->used = true;
+        e->nocase = nocase;
+        e->drive = drive;
+        e->parent = parent;
+        e->hash = hash;
+        strcpy(e->name, name);
+    }
+    e->type = type;
+    e->node = node;
+    e->last_use = ++dcache_clock;
+    irq_restore(flags);
+}
+
+// 생성/삭제/이름 변경된 (드라이브, 부모, 이름) 엔트리 하나만 버림
+void dcache_invalidate_entry(int drive, uint32_t parent, const char* name, bool nocase) {
+    if (!name || !name[0] || strlen(name) >= DCACHE_NAME_MAX) {
+        return;
+    }
+    uint32_t hash = dcache_hash(drive, parent, name, nocase);
+    uint32_t flags = irq_save();
+    dcache_entry_t* e = dcache_find(hash, drive, parent, name, nocase);
+    if (e) {
+        e->used = false;
+        dcache_invalidations++;
+    }
+    irq_restore(flags);
+}
+
+// 지운 디렉터리의 노드 번호가 재사용돼도 옛 자식 엔트리가 살아나지 않도록 함
+void dcache_invalidate_children(int drive, uint32_t parent) {
+    uint32_t flags = irq_save();
+    for (int b = 0; b < DCACHE_BUCKETS; b++) {
+        for (int i = 0; i < DCACHE_WAYS; i++) {
+            dcache_entry_t* e = &dcache[b][i];
+            if (e->used && e->drive == drive && e->parent == parent) {
+                e->used = false;
+            }
+        }
+    }
+    dcache_invalidations++;
+    irq_restore(flags);
+}
+
+// 마운트/포맷처럼 볼륨 전체가 바뀌면 해당 볼륨 엔트리를 모두 버림
+void dcache_invalidate_drive(int drive) {
+    uint32_t flags = irq_save();
+    for (int b = 0; b < DCACHE_BUCKETS; b++) {
+        for (int i = 0; i < DCACHE_WAYS; i++) {
+            if (dcache[b][i].used && dcache[b][i].drive == drive) {
+                dcache[b][i].used = false;
+            }
+        }
+    }
+    dcache_invalidations++;
+    irq_restore(flags);
+}
+
+void dcache_invalidate_all(void) {
+    uint32_t flags = irq_save();
+    memset(dcache, 0, sizeof(dcache));
+    dcache_invalidations++;
+    irq_restore(flags);
+}
+
+void dcache_get_stats(dcache_stats_t* out) {
+    if (!out) {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+    uint32_t flags = irq_save();
+    for (int b = 0; b < DCACHE_BUCKETS; b++) {
+        for (int i = 0; i < DCACHE_WAYS; i++) {
+            if (dcache[b][i].used) {
+                out->entries++;
+            }
+        }
+    }
+    out->hits = dcache_hits;
+    out->misses = dcache_misses;
+    out->invalidations = dcache_invalidations;
+    irq_restore(flags);
+}
@@ -0,0 +1,34 @@
+#ifndef DCACHE_H
+#define DCACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DCACHE_BUCKETS  128
+#define DCACHE_WAYS     4
+#define DCACHE_NAME_MAX 32      // 이보다 긴 이름은 캐시하지 않음
+
+// 엔트리 종류 (NEGATIVE = 해당 이름이 없음)
+#define DCACHE_NEGATIVE 0
+#define DCACHE_DIR      1
+#define DCACHE_FILE     2
+
+typedef struct {
+    uint32_t entries;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t invalidations;
+} dcache_stats_t;
+
+// (드라이브, 부모 노드, 이름) -> 노드. FAT는 nocase=true로 대소문자 무시.
+bool dcache_lookup(int drive, uint32_t parent, const char* name, bool nocase,
+                   uint8_t* out_type, uint32_t* out_node);
+void dcache_insert(int drive, uint32_t parent, const char* name, bool nocase,
+                   uint8_t type, uint32_t node);
+void dcache_invalidate_entry(int drive, uint32_t parent, const char* name, bool nocase);
+void dcache_invalidate_children(int drive, uint32_t parent);
+void dcache_invalidate_drive(int drive);
+void dcache_invalidate_all(void);
+void dcache_get_stats(dcache_stats_t* out);
+
+#endif
@@ -0,0 +1,52 @@
+#include "dirent.h"
+#include "../libc/string.h"
+
+void dirent_writer_init(dirent_writer_t* w, uint8_t* buf, uint32_t len, uint32_t cookie) {
+    w->buf = buf;
+    w->len = len;
+    w->used = 0;
+    w->cookie = cookie;
+    w->full = false;
+}
+
+// 레코드 하나를 추가. 공간이 모자라면 full을 세우고 false (cookie는 그대로)
+bool dirent_put(dirent_writer_t* w, const fs_dirent_t* info, const char* name) {
+    if (w->full) {
+        return false;
+    }
+    uint32_t namelen = (uint32_t)strlen(name);
+    if (namelen > DIRENT_NAME_MAX) {
+        namelen = DIRENT_NAME_MAX;
+    }
+    uint32_t reclen = (uint32_t)sizeof(fs_dirent_t) + namelen + 1u;
+    reclen = (reclen + 3u) & ~3u;
+    if (w->used + reclen > w->len) {
+        w->full = true;
+        return false;
+    }
+
+    fs_dirent_t* d = (fs_dirent_t*)(w->buf + w->used);
+    memcpy(d, info, sizeof(*d));
+    d->reclen = (uint16_t)reclen;
+    d->namelen = (uint16_t)namelen;
+    memcpy(d->name, name, namelen);
+    memset(d->name + namelen, 0, reclen - sizeof(fs_dirent_t) - namelen);
+    w->used += reclen;
+    w->cookie = info->cookie;
+    return true;
+}
+
+// 숨기는 엔트리(., .., 볼륨 레이블)도 cookie는 전진시켜 다음 호출이 다시 보지 않게 함
+void dirent_skip(dirent_writer_t* w, uint32_t next_cookie) {
+    if (!w->full) {
+        w->cookie = next_cookie;
+    }
+}
+
+// 채운 바이트 수. 첫 레코드조차 못 담으면 -1, 끝까지 읽었으면 0
+int dirent_result(const dirent_writer_t* w) {
+    if (w->used == 0 && w->full) {
+        return -1;
+    }
+    return (int)w->used;
+}
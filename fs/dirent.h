@@ -0,0 +1,46 @@
+#ifndef DIRENT_H
+#define DIRENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 속성 비트는 FAT 디렉터리 엔트리와 같은 값을 씀 (XVFS는 DIR만)
+#define DIRENT_ATTR_READONLY 0x01
+#define DIRENT_ATTR_HIDDEN   0x02
+#define DIRENT_ATTR_SYSTEM   0x04
+#define DIRENT_ATTR_DIR      0x10
+#define DIRENT_ATTR_ARCHIVE  0x20
+
+#define DIRENT_NAME_MAX 255
+
+// getdents 레코드. name은 NUL 포함이고 reclen은 4바이트 정렬.
+// cookie는 이 레코드 다음부터 이어 읽을 위치.
+typedef struct __attribute__((packed)) {
+    uint16_t reclen;
+    uint16_t namelen;
+    uint32_t cookie;
+    uint32_t size;
+    uint32_t ino;           // FAT: 첫 클러스터, XVFS: 시작 블록
+    uint16_t wrt_time;      // FAT 형식 시각/날짜 (XVFS는 0)
+    uint16_t wrt_date;
+    uint16_t crt_time;
+    uint16_t crt_date;
+    uint8_t attr;
+    uint8_t reserved[3];
+    char name[];
+} fs_dirent_t;
+
+typedef struct {
+    uint8_t* buf;
+    uint32_t len;
+    uint32_t used;
+    uint32_t cookie;        // 마지막으로 다 담은 위치
+    bool full;
+} dirent_writer_t;
+
+void dirent_writer_init(dirent_writer_t* w, uint8_t* buf, uint32_t len, uint32_t cookie);
+bool dirent_put(dirent_writer_t* w, const fs_dirent_t* info, const char* name);
+void dirent_skip(dirent_writer_t* w, uint32_t next_cookie);
+int dirent_result(const dirent_writer_t* w);
+
+#endif
@@ -1,5 +1,7 @@
 #include "fat16.h"
 #include "fscmd.h"
+#include "dirent.h"
+#include "dcache.h"
 #include "../drivers/ata.h"
 #include "../drivers/screen.h"
 #include "../libc/string.h"
@@ -66,6 +68,7 @@ typedef struct {
 typedef struct {
     FAT16_DirEntry entry;
     FAT16_DirSlot slot;
+    uint32_t pos;               // 디렉터리 안의 엔트리 순번 (getdents cookie)
     bool has_long;
     char long_name[FAT16_LFN_MAX + 1];
     uint32_t lfn_count;
@@ -203,6 +206,34 @@ bool fat16_init(uint8_t drive, uint32_t base_lba) {
     return true;
 }
 
+void fat16_save_state(FAT16_VolumeState* out) {
+    if (!out) return;
+    out->bpb = fat16_bpb;
+    out->fat_start_lba = fat_start_lba;
+    out->root_dir_lba = root_dir_lba;
+    out->data_region_lba = data_region_lba;
+    out->root_dir_sectors = root_dir_sectors;
+    out->root_dir_cluster = root_dir_cluster16;
+    out->first_data_sector = fat16_first_data_sector;
+    out->current_dir_cluster = current_dir_cluster16;
+    out->alloc_hint = fat16_alloc_hint;
+    out->drive = fat16_drive;
+}
+
+void fat16_load_state(const FAT16_VolumeState* in) {
+    if (!in) return;
+    fat16_bpb = in->bpb;
+    fat_start_lba = in->fat_start_lba;
+    root_dir_lba = in->root_dir_lba;
+    data_region_lba = in->data_region_lba;
+    root_dir_sectors = in->root_dir_sectors;
+    root_dir_cluster16 = in->root_dir_cluster;
+    fat16_first_data_sector = in->first_data_sector;
+    current_dir_cluster16 = in->current_dir_cluster;
+    fat16_alloc_hint = in->alloc_hint;
+    fat16_drive = in->drive;
+}
+
 static void read_sector(uint32_t lba, uint8_t* buffer) {
     ata_read(fat16_drive, lba, 1, buffer);
 }
@@ -240,6 +271,22 @@ void split_path(const char* path, char* dir, char* fname) {
     }
 }
 
+// 경로 구성요소 하나를 조회하고 결과(종류, 첫 클러스터)를 dcache에 보관
+static uint8_t fat16_lookup_cached(const char* name, uint16_t dir_cluster, uint16_t* out_cluster) {
+    uint8_t type = DCACHE_NEGATIVE;
+    uint32_t node = 0;
+    if (!dcache_lookup(fat16_drive, dir_cluster, name, true, &type, &node)) {
+        FAT16_DirEntry entry;
+        if (fat16_find_entry(name, dir_cluster, &entry)) {
+            type = fat16_is_dir(&entry) ? DCACHE_DIR : DCACHE_FILE;
+            node = entry.FirstCluster;
+        }
+        dcache_insert(fat16_drive, dir_cluster, name, true, type, node);
+    }
+    *out_cluster = (uint16_t)node;
+    return type;
+}
+
 uint16_t fat16_resolve_dir(const char* path) {
     // 루트 처리
     if (strcmp(path, "/") == 0) return 0;
@@ -250,16 +297,17 @@ uint16_t fat16_resolve_dir(const char* path) {
 
     char* token = strtok(temp, "/");
     while (token) {
-        FAT16_DirEntry entry;
-        if (!fat16_find_entry(token, cluster, &entry)) {
+        uint16_t next = 0;
+        uint8_t type = fat16_lookup_cached(token, cluster, &next);
+        if (type == DCACHE_NEGATIVE) {
             return 0xFFFF; // 못 찾음
         }
-        if (!fat16_is_dir(&entry)) {
+        if (type != DCACHE_DIR) {
             // 마지막 토큰이 아니면 디렉토리여야 함
             if (strtok(NULL, "/")) return 0xFFFF;
             else break; // 마지막이면 파일일 수도 있음
         }
-        cluster = entry.FirstCluster;
+        cluster = next;
         token = strtok(NULL, "/");
     }
     return cluster;
@@ -791,7 +839,9 @@ static void fat16_dir_mark_deleted(const FAT16_DirSlot* slot) {
 
 typedef bool (*fat16_dir_iter_cb)(const FAT16_DirItem* item, void* ctx);
 
-static bool fat16_iterate_dir(uint16_t dir_cluster, fat16_dir_iter_cb cb, void* ctx) {
+// start 이전 엔트리는 섹터를 읽지 않고 건너뜀 (클러스터 체인만 따라감)
+static bool fat16_iterate_dir_from(uint16_t dir_cluster, uint32_t start,
+                                   fat16_dir_iter_cb cb, void* ctx) {
     uint8_t buf[SECTOR_SIZE];
     FAT16_LFNState lfn;
     fat16_lfn_reset(&lfn);
@@ -799,11 +849,16 @@ static bool fat16_iterate_dir(uint16_t dir_cluster, fat16_dir_iter_cb cb, void*
 
     if (dir_cluster == 0) {
         for (uint16_t s = 0; s < root_dir_sectors; s++) {
+            uint32_t sector_base = (uint32_t)s * entries_per_sector;
+            if (start >= sector_base + entries_per_sector)
+                continue;
             uint32_t lba = root_dir_lba + s;
             read_sector(lba, buf);
             FAT16_DirEntry* entry = (FAT16_DirEntry*)buf;
 
             for (size_t i = 0; i < entries_per_sector; i++) {
+                if (sector_base + i < start)
+                    continue;
                 uint8_t first = (uint8_t)entry[i].Name[0];
                 if (first == 0x00)
                     return true;
@@ -825,6 +880,7 @@ static bool fat16_iterate_dir(uint16_t dir_cluster, fat16_dir_iter_cb cb, void*
                 memset(&item, 0, sizeof(item));
                 item.entry = entry[i];
                 item.slot = slot;
+                item.pos = sector_base + (uint32_t)i;
 
                 uint8_t short_name[11];
                 memcpy(short_name, item.entry.Name, 8);
@@ -853,13 +909,25 @@ static bool fat16_iterate_dir(uint16_t dir_cluster, fat16_dir_iter_cb cb, void*
     }
 
     uint16_t cluster = dir_cluster;
+    uint32_t per_cluster = entries_per_sector * fat16_bpb.SecPerClus;
+    uint32_t cluster_base = 0;
     while (cluster >= 2 && cluster < 0xFFF8) {
+        if (start >= cluster_base + per_cluster) {
+            cluster_base += per_cluster;
+            cluster = fat16_next_cluster(cluster);
+            continue;
+        }
         uint32_t lba = cluster_to_lba(cluster);
         for (uint8_t s = 0; s < fat16_bpb.SecPerClus; s++) {
+            uint32_t sector_base = cluster_base + (uint32_t)s * entries_per_sector;
+            if (start >= sector_base + entries_per_sector)
+                continue;
             read_sector(lba + s, buf);
             FAT16_DirEntry* entry = (FAT16_DirEntry*)buf;
 
             for (size_t i = 0; i < entries_per_sector; i++) {
+                if (sector_base + i < start)
+                    continue;
                 uint8_t first = (uint8_t)entry[i].Name[0];
                 if (first == 0x00)
                     return true;
@@ -881,6 +949,7 @@ static bool fat16_iterate_dir(uint16_t dir_cluster, fat16_dir_iter_cb cb, void*
                 memset(&item, 0, sizeof(item));
                 item.entry = entry[i];
                 item.slot = slot;
+                item.pos = sector_base + (uint32_t)i;
 
                 uint8_t short_name[11];
                 memcpy(short_name, item.entry.Name, 8);
@@ -905,12 +974,17 @@ static bool fat16_iterate_dir(uint16_t dir_cluster, fat16_dir_iter_cb cb, void*
                     return false;
             }
         }
+        cluster_base += per_cluster;
         cluster = fat16_next_cluster(cluster);
     }
 
     return true;
 }
 
+static bool fat16_iterate_dir(uint16_t dir_cluster, fat16_dir_iter_cb cb, void* ctx) {
+    return fat16_iterate_dir_from(dir_cluster, 0, cb, ctx);
+}
+
 static bool fat16_find_free_slots(uint16_t dir_cluster, uint32_t needed, FAT16_DirSlot* slots) {
     uint8_t buf[SECTOR_SIZE];
     uint32_t run = 0;
@@ -1039,6 +1113,16 @@ static void fat16_build_short_name_str(const FAT16_DirEntry* e, char* out, size_
         snprintf(out, out_size, "%s", name);
 }
 
+// 디렉터리 엔트리가 생기거나 사라지면 긴 이름과 8.3 이름 양쪽의 dcache 엔트리를 버림
+static void fat16_dcache_forget(uint16_t dir_cluster, const char* name, const FAT16_DirEntry* e) {
+    dcache_invalidate_entry(fat16_drive, dir_cluster, name, true);
+    if (e) {
+        char short_str[13];
+        fat16_build_short_name_str(e, short_str, sizeof(short_str));
+        dcache_invalidate_entry(fat16_drive, dir_cluster, short_str, true);
+    }
+}
+
 static bool fat16_dir_item_matches(const FAT16_DirItem* item, const char* name) {
     if (!item || !name || !name[0])
         return false;
@@ -1411,6 +1495,44 @@ int fat16_list_dir_lfn(uint16_t cluster, char* names, bool* is_dir, int max_entr
     return ctx.count;
 }
 
+static bool fat16_getdents_cb(const FAT16_DirItem* item, void* vctx) {
+    dirent_writer_t* w = (dirent_writer_t*)vctx;
+    char short_name[16];
+    fat16_build_short_name_str(&item->entry, short_name, sizeof(short_name));
+    const char* name = (item->has_long && item->long_name[0]) ? item->long_name : short_name;
+
+    if ((item->entry.Attr & 0x08) || !name[0] ||
+        strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+        dirent_skip(w, item->pos + 1);
+        return true;
+    }
+
+    fs_dirent_t info;
+    memset(&info, 0, sizeof(info));
+    info.cookie = item->pos + 1;
+    info.size = item->entry.FileSize;
+    info.ino = item->entry.FirstCluster;
+    info.wrt_time = item->entry.WrtTime;
+    info.wrt_date = item->entry.WrtDate;
+    info.crt_time = item->entry.CrtTime;
+    info.crt_date = item->entry.CrtDate;
+    info.attr = item->entry.Attr & (DIRENT_ATTR_READONLY | DIRENT_ATTR_HIDDEN |
+                                    DIRENT_ATTR_SYSTEM | DIRENT_ATTR_DIR | DIRENT_ATTR_ARCHIVE);
+    return dirent_put(w, &info, name);
+}
+
+// *cookie 위치부터 레코드를 채우고 cookie를 갱신. 반환: 바이트 수 (0 = 끝)
+int fat16_getdents(uint16_t cluster, uint32_t* cookie, uint8_t* buf, uint32_t len) {
+    if (!cookie || !buf || cluster == 0xFFFF)
+        return -1;
+
+    dirent_writer_t w;
+    dirent_writer_init(&w, buf, len, *cookie);
+    fat16_iterate_dir_from(cluster, *cookie, fat16_getdents_cb, &w);
+    *cookie = w.cookie;
+    return dirent_result(&w);
+}
+
 int fat16_read_file(FAT16_DirEntry* entry, uint8_t* out_buf, uint32_t offset, uint32_t size) {
     if (!entry || entry->FirstCluster == 0) 
         return -1;
@@ -1640,6 +1762,7 @@ int fat16_create_file(const char* filename, int initial_size) {
         fat16_write_lfn_entries(slots, lfn_count, long_name, checksum);
     }
     fat16_dir_write_raw(&slots[lfn_count], &ne);
+    fat16_dcache_forget(dir_cluster, name, &ne);
 
     return 1;
 }
@@ -1745,6 +1868,105 @@ int fat16_write_file(const char* filename, const char* data, int size) {
     return size;
 }
 
+// 클러스터 안의 [from, to) 구간을 씀. 파일 위치 cstart + pos가 offset 앞이면
+// (이전 파일 끝과 offset 사이의 구멍) 0으로 채움
+static void fat16_write_span(uint16_t cluster, uint32_t cstart, uint32_t from, uint32_t to,
+                             uint32_t offset, const uint8_t* data) {
+    uint32_t lba = cluster_to_lba(cluster);
+    uint8_t sector[SECTOR_SIZE];
+    uint32_t pos = from;
+    while (pos < to) {
+        uint32_t s = pos / SECTOR_SIZE;
+        uint32_t in = pos % SECTOR_SIZE;
+        uint32_t at = cstart + pos;
+        if (in == 0 && at >= offset && to - pos >= SECTOR_SIZE) {
+            uint32_t n = (to - pos) / SECTOR_SIZE;
+            ata_write(fat16_drive, lba + s, (uint16_t)n, data + (at - offset));
+            pos += n * SECTOR_SIZE;
+            continue;
+        }
+        uint32_t chunk = SECTOR_SIZE - in;
+        if (chunk > to - pos)
+            chunk = to - pos;
+        uint32_t gap = 0;
+        if (at < offset)
+            gap = (offset - at < chunk) ? offset - at : chunk;
+        read_sector(lba + s, sector);
+        memset(sector + in, 0, gap);
+        if (chunk > gap)
+            memcpy(sector + in + gap, data + (at + gap - offset), chunk - gap);
+        write_sector(lba + s, sector);
+        pos += chunk;
+    }
+}
+
+// offset부터 size바이트만 씀. 건드리는 클러스터만 읽고 쓰고, 파일 끝을 넘으면
+// 체인을 늘리고 크기를 갱신함. 없는 파일은 새로 만듦
+bool fat16_write_at(const char* filename, uint32_t offset, const uint8_t* data, uint32_t size) {
+    uint32_t end = offset + size;
+    if (!filename || (!data && size > 0) || end < offset)
+        return false;
+
+    char dir[256], fname[256];
+    split_path(filename, dir, fname);
+    uint16_t dir_cluster = fat16_resolve_dir(dir);
+    if (dir_cluster == 0xFFFF || fname[0] == '\0')
+        return false;
+
+    FAT16_DirEntry entry;
+    FAT16_DirSlot slot;
+    if (!fat16_find_entry_slot(dir_cluster, fname, &entry, &slot, NULL, NULL)) {
+        if (!fat16_create_file(filename, 0) ||
+            !fat16_find_entry_slot(dir_cluster, fname, &entry, &slot, NULL, NULL))
+            return false;
+    }
+    if (entry.Attr & 0x10)
+        return false;
+    if (size == 0)
+        return true;
+
+    uint32_t cluster_bytes = bytes_per_cluster();
+    uint32_t from = offset < entry.FileSize ? offset : entry.FileSize;
+    uint32_t first = from / cluster_bytes;
+    uint32_t last = (end - 1) / cluster_bytes;
+    uint16_t cl = entry.FirstCluster;
+    uint16_t prev = 0;
+    bool entry_dirty = false;
+
+    for (uint32_t idx = 0; idx <= last; idx++) {
+        if (cl < 2 || cl >= 0xFFF8) {
+            uint16_t fresh = _alloc_cluster();
+            if (fresh < 2) {
+                kprint("FAT16: No free cluster.\n");
+                return false;
+            }
+            if (prev) {
+                fat16_set_fat_entry(prev, fresh);
+            } else {
+                entry.FirstCluster = fresh;
+                entry_dirty = true;
+            }
+            cl = fresh;
+        }
+        if (idx >= first) {
+            uint32_t cstart = idx * cluster_bytes;
+            uint32_t a = from > cstart ? from - cstart : 0;
+            uint32_t b = end - cstart < cluster_bytes ? end - cstart : cluster_bytes;
+            fat16_write_span(cl, cstart, a, b, offset, data);
+        }
+        prev = cl;
+        cl = fat16_next_cluster(cl);
+    }
+
+    if (end > entry.FileSize) {
+        entry.FileSize = end;
+        entry_dirty = true;
+    }
+    if (entry_dirty)
+        fat16_dir_write_raw(&slot, &entry);
+    return true;
+}
+
 bool fat16_rm(const char* path) {
     char dir[256], fname[256];
     split_path(path, dir, fname);
@@ -1791,6 +2013,7 @@ bool fat16_rm(const char* path) {
     for (uint32_t i = 0; i < lfn_count; i++)
         fat16_dir_mark_deleted(&lfn_slots[i]);
     fat16_dir_mark_deleted(&slot);
+    fat16_dcache_forget(cluster, fname, &entry);
 
     return true;
 }
@@ -2000,6 +2223,7 @@ bool fat16_mkdir(const char* dirname) {
         fat16_write_lfn_entries(slots, lfn_count, long_name, checksum);
     }
     fat16_dir_write_raw(&slots[lfn_count], &new_dir);
+    fat16_dcache_forget(parent, name, &new_dir);
 
     // 5️⃣ 새 디렉토리 클러스터 초기화 (. / ..)
     uint8_t sector[512];
@@ -2101,6 +2325,8 @@ bool fat16_rmdir(const char* path) {
     for (uint32_t i = 0; i < lfn_count; i++)
         fat16_dir_mark_deleted(&lfn_slots[i]);
     fat16_dir_mark_deleted(&slot);
+    fat16_dcache_forget(parent, name, &entry);
+    dcache_invalidate_children(fat16_drive, entry.FirstCluster);
 
     kprint("Directory removed.\n");
     return true;
@@ -2200,6 +2426,8 @@ bool fat16_rename(const char* oldname, const char* newname) {
         return false;
     }
 
+    fat16_dcache_forget(parent, old_base, &entry);
+
     // 새 이름 8.3 포맷 적용
     _format_83(newname, (char*)entry.Name, (char*)entry.Ext);
 
@@ -2207,6 +2435,7 @@ bool fat16_rename(const char* oldname, const char* newname) {
         _root_write_entry_at(lba, off, &entry);
     else
         _write_entry_at(lba, off, &entry);
+    fat16_dcache_forget(parent, newname, &entry);
     return true;
 }
 
@@ -59,8 +59,24 @@ typedef struct __attribute__((packed)) {
 
 extern FAT16_BPB_t fat16_bpb;
 
+// 마운트 테이블이 볼륨마다 보관하는 드라이버 상태
+typedef struct {
+    FAT16_BPB_t bpb;
+    uint32_t fat_start_lba;
+    uint32_t root_dir_lba;
+    uint32_t data_region_lba;
+    uint32_t root_dir_sectors;
+    uint32_t root_dir_cluster;
+    uint32_t first_data_sector;
+    uint16_t current_dir_cluster;
+    uint16_t alloc_hint;
+    int drive;
+} FAT16_VolumeState;
+
 /* 초기화 및 기타 함수 */
 bool fat16_init(uint8_t drive, uint32_t base_lba);
+void fat16_save_state(FAT16_VolumeState* out);
+void fat16_load_state(const FAT16_VolumeState* in);
 uint16_t fat16_next_cluster(uint16_t cluster);
 uint16_t fat16_get_fat_entry(uint16_t cluster);
 void fat16_set_fat_entry(uint16_t cluster, uint16_t value);
@@ -74,11 +90,13 @@ void fat16_ls(const char* path);
 void fat16_cat(const char* filename);
 int fat16_create_file(const char* filename, int initial_size);
 int fat16_write_file(const char* filename, const char* data, int size);
+bool fat16_write_at(const char* filename, uint32_t offset, const uint8_t* data, uint32_t size);
 bool fat16_rm(const char* filename);
 int fat16_read_file(FAT16_DirEntry* entry, uint8_t* out_buf, uint32_t offset, uint32_t size);
 bool fat16_exists(const char* filename);
 int fat16_read_dir(uint16_t cluster, FAT16_DirEntry* out_entries, int max_entries);
 int fat16_list_dir_lfn(uint16_t cluster, char* names, bool* is_dir, int max_entries, size_t name_len);
+int fat16_getdents(uint16_t cluster, uint32_t* cookie, uint8_t* buf, uint32_t len);
 bool compare_filename(const char* name, const char* entry_name, const char* entry_ext);
 uint32_t cluster_to_lba(uint16_t cluster);
 bool fat16_cd(const char* dirname);
@@ -1,5 +1,7 @@
 #include "fat32.h"
 #include "fscmd.h"
+#include "dirent.h"
+#include "dcache.h"
 #include "../drivers/ata.h"
 #include "../drivers/screen.h"
 #include "../kernel/cmd.h"
@@ -56,6 +58,7 @@ typedef struct {
 typedef struct {
     FAT32_DirEntry entry;
     FAT32_DirSlot slot;
+    uint32_t pos;               // 디렉터리 안의 엔트리 순번 (getdents cookie)
     bool has_long;
     char long_name[FAT32_LFN_MAX + 1];
     uint32_t lfn_count;
@@ -502,19 +505,34 @@ static void fat32_dir_mark_deleted(const FAT32_DirSlot* slot) {
 
 typedef bool (*fat32_dir_iter_cb)(const FAT32_DirItem* item, void* ctx);
 
-static bool fat32_iterate_dir(uint32_t dir_cluster, fat32_dir_iter_cb cb, void* ctx) {
+// start 이전 엔트리는 섹터를 읽지 않고 건너뜀 (클러스터 체인만 따라감)
+static bool fat32_iterate_dir_from(uint32_t dir_cluster, uint32_t start,
+                                   fat32_dir_iter_cb cb, void* ctx) {
     uint8_t buf[SECTOR_SIZE];
     uint32_t cluster = dir_cluster;
     FAT32_LFNState lfn;
     fat32_lfn_reset(&lfn);
+    uint32_t per_sector = SECTOR_SIZE / sizeof(FAT32_DirEntry);
+    uint32_t per_cluster = per_sector * bpb.SecPerClus;
+    uint32_t cluster_base = 0;
 
     while (cluster >= 2 && cluster < 0x0FFFFFF8) {
+        if (start >= cluster_base + per_cluster) {
+            cluster_base += per_cluster;
+            cluster = fat32_next_cluster(fat32_drive, cluster);
+            continue;
+        }
         for (uint8_t s = 0; s < bpb.SecPerClus; s++) {
+            uint32_t sector_base = cluster_base + (uint32_t)s * per_sector;
+            if (start >= sector_base + per_sector)
+                continue;
             uint32_t lba = cluster_to_lba(cluster) + s;
             read_sector(fat32_drive, lba, buf);
             FAT32_DirEntry* entry = (FAT32_DirEntry*)buf;
 
-            for (size_t i = 0; i < SECTOR_SIZE / sizeof(FAT32_DirEntry); i++) {
+            for (size_t i = 0; i < per_sector; i++) {
+                if (sector_base + i < start)
+                    continue;
                 uint8_t first = entry[i].Name[0];
                 if (first == 0x00)
                     return true;
@@ -536,6 +554,7 @@ static bool fat32_iterate_dir(uint32_t dir_cluster, fat32_dir_iter_cb cb, void*
                 memset(&item, 0, sizeof(item));
                 item.entry = entry[i];
                 item.slot = slot;
+                item.pos = sector_base + (uint32_t)i;
 
                 if (lfn.active && lfn.expected == 0 &&
                     fat32_lfn_checksum(item.entry.Name) == lfn.checksum) {
@@ -557,12 +576,17 @@ static bool fat32_iterate_dir(uint32_t dir_cluster, fat32_dir_iter_cb cb, void*
                     return false;
             }
         }
+        cluster_base += per_cluster;
         cluster = fat32_next_cluster(fat32_drive, cluster);
     }
 
     return true;
 }
 
+static bool fat32_iterate_dir(uint32_t dir_cluster, fat32_dir_iter_cb cb, void* ctx) {
+    return fat32_iterate_dir_from(dir_cluster, 0, cb, ctx);
+}
+
 static bool fat32_find_free_slots(uint32_t dir_cluster, uint32_t needed, FAT32_DirSlot* slots) {
     uint8_t buf[SECTOR_SIZE];
     uint32_t cluster = dir_cluster;
@@ -613,6 +637,16 @@ static void fat32_build_short_name_str(const FAT32_DirEntry* e, char* out, size_
         snprintf(out, out_size, "%s", name);
 }
 
+// 디렉터리 엔트리가 생기거나 사라지면 긴 이름과 8.3 이름 양쪽의 dcache 엔트리를 버림
+static void fat32_dcache_forget(uint32_t dir_cluster, const char* name, const FAT32_DirEntry* e) {
+    dcache_invalidate_entry(fat32_drive, dir_cluster, name, true);
+    if (e) {
+        char short_str[13];
+        fat32_build_short_name_str(e, short_str, sizeof(short_str));
+        dcache_invalidate_entry(fat32_drive, dir_cluster, short_str, true);
+    }
+}
+
 static bool fat32_dir_item_matches(const FAT32_DirItem* item, const char* name) {
     if (!item || !name || !name[0])
         return false;
@@ -776,6 +810,28 @@ bool fat32_init(uint8_t drive, uint32_t base_lba) {
     return true;
 }
 
+void fat32_save_state(FAT32_VolumeState* out) {
+    if (!out) return;
+    out->bpb = bpb;
+    out->fat_start_lba = fat_start_lba;
+    out->data_start_lba = data_start_lba;
+    out->root_dir_cluster = root_dir_cluster32;
+    out->current_dir_cluster = current_dir_cluster32;
+    out->alloc_hint = fat32_alloc_hint;
+    out->drive = fat32_drive;
+}
+
+void fat32_load_state(const FAT32_VolumeState* in) {
+    if (!in) return;
+    bpb = in->bpb;
+    fat_start_lba = in->fat_start_lba;
+    data_start_lba = in->data_start_lba;
+    root_dir_cluster32 = in->root_dir_cluster;
+    current_dir_cluster32 = in->current_dir_cluster;
+    fat32_alloc_hint = in->alloc_hint;
+    fat32_drive = in->drive;
+}
+
 void _get_fullname32(const FAT32_DirEntry* entry, char* out) {
     char name[9];
     char ext[4];
@@ -1012,6 +1068,44 @@ int fat32_list_dir_lfn(uint32_t cluster, char* names, bool* is_dir, int max_entr
     return ctx.count;
 }
 
+static bool fat32_getdents_cb(const FAT32_DirItem* item, void* vctx) {
+    dirent_writer_t* w = (dirent_writer_t*)vctx;
+    char short_name[16];
+    fat32_build_short_name_str(&item->entry, short_name, sizeof(short_name));
+    const char* name = (item->has_long && item->long_name[0]) ? item->long_name : short_name;
+
+    if ((item->entry.Attr & 0x08) || !name[0] ||
+        strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+        dirent_skip(w, item->pos + 1);
+        return true;
+    }
+
+    fs_dirent_t info;
+    memset(&info, 0, sizeof(info));
+    info.cookie = item->pos + 1;
+    info.size = item->entry.FileSize;
+    info.ino = ((uint32_t)item->entry.FstClusHI << 16) | item->entry.FstClusLO;
+    info.wrt_time = item->entry.WrtTime;
+    info.wrt_date = item->entry.WrtDate;
+    info.crt_time = item->entry.CrtTime;
+    info.crt_date = item->entry.CrtDate;
+    info.attr = item->entry.Attr & (DIRENT_ATTR_READONLY | DIRENT_ATTR_HIDDEN |
+                                    DIRENT_ATTR_SYSTEM | DIRENT_ATTR_DIR | DIRENT_ATTR_ARCHIVE);
+    return dirent_put(w, &info, name);
+}
+
+// *cookie 위치부터 레코드를 채우고 cookie를 갱신. 반환: 바이트 수 (0 = 끝)
+int fat32_getdents(uint32_t cluster, uint32_t* cookie, uint8_t* buf, uint32_t len) {
+    if (!cookie || !buf || cluster < 2 || cluster >= 0x0FFFFFF8)
+        return -1;
+
+    dirent_writer_t w;
+    dirent_writer_init(&w, buf, len, *cookie);
+    fat32_iterate_dir_from(cluster, *cookie, fat32_getdents_cb, &w);
+    *cookie = w.cookie;
+    return dirent_result(&w);
+}
+
 int fat32_read_dir(uint32_t cluster, FAT32_DirEntry* out, uint32_t max) {
     uint32_t count = 0;
     uint8_t buf[SECTOR_SIZE];
@@ -1299,6 +1393,7 @@ bool fat32_create_file(const char* fullpath) {
     entry.FstClusHI = (uint16_t)(newclus >> 16);
 
     fat32_dir_write_raw(&slots[lfn_count], &entry);
+    fat32_dcache_forget(dir_cluster, name, &entry);
 
     kprintf("FAT32: created %s in dir cluster %u\n", name, dir_cluster);
     return true;
@@ -1389,6 +1484,122 @@ bool fat32_write_file(const char* fullpath, const uint8_t* data, uint32_t size)
     return true;
 }
 
+// FAT 사본 전부에서 cluster의 다음 클러스터를 next로 바꿈
+static void fat32_set_next(uint32_t cluster, uint32_t next) {
+    uint8_t fatbuf[SECTOR_SIZE];
+    uint32_t fat_sector = (cluster * 4) / SECTOR_SIZE;
+    uint32_t fat_offset = (cluster * 4) % SECTOR_SIZE;
+    read_sector(fat32_drive, fat_start_lba + fat_sector, fatbuf);
+    uint32_t* ent = (uint32_t*)(fatbuf + fat_offset);
+    *ent = (*ent & 0xF0000000u) | (next & 0x0FFFFFFFu);
+    for (uint8_t f = 0; f < bpb.NumFATs; f++)
+        write_sector(fat32_drive, fat_start_lba + f * bpb.FATSz32 + fat_sector, fatbuf);
+}
+
+// 클러스터 안의 [from, to) 구간을 씀. 파일 위치 cstart + pos가 offset 앞이면
+// (이전 파일 끝과 offset 사이의 구멍) 0으로 채움
+static void fat32_write_span(uint32_t cluster, uint32_t cstart, uint32_t from, uint32_t to,
+                             uint32_t offset, const uint8_t* data) {
+    uint32_t lba = cluster_to_lba(cluster);
+    uint8_t sector[SECTOR_SIZE];
+    uint32_t pos = from;
+    while (pos < to) {
+        uint32_t s = pos / SECTOR_SIZE;
+        uint32_t in = pos % SECTOR_SIZE;
+        uint32_t at = cstart + pos;
+        if (in == 0 && at >= offset && to - pos >= SECTOR_SIZE) {
+            uint32_t n = (to - pos) / SECTOR_SIZE;
+            ata_write(fat32_drive, lba + s, (uint16_t)n, data + (at - offset));
+            pos += n * SECTOR_SIZE;
+            continue;
+        }
+        uint32_t chunk = SECTOR_SIZE - in;
+        if (chunk > to - pos)
+            chunk = to - pos;
+        uint32_t gap = 0;
+        if (at < offset)
+            gap = (offset - at < chunk) ? offset - at : chunk;
+        read_sector(fat32_drive, lba + s, sector);
+        memset(sector + in, 0, gap);
+        if (chunk > gap)
+            memcpy(sector + in + gap, data + (at + gap - offset), chunk - gap);
+        write_sector(fat32_drive, lba + s, sector);
+        pos += chunk;
+    }
+}
+
+// offset부터 size바이트만 씀. 건드리는 클러스터만 읽고 쓰고, 파일 끝을 넘으면
+// 체인을 늘리고 크기를 갱신함. 없는 파일은 새로 만듦
+bool fat32_write_at(const char* fullpath, uint32_t offset, const uint8_t* data, uint32_t size) {
+    uint32_t end = offset + size;
+    if (!fullpath || (!data && size > 0) || end < offset)
+        return false;
+
+    char dir[256];
+    char name[64];
+    fat32_split_path(fullpath, dir, sizeof(dir), name, sizeof(name));
+    if (name[0] == '\0')
+        return false;
+
+    uint32_t dir_cluster = fat32_resolve_dir(dir);
+    if (dir_cluster < 2 || dir_cluster >= 0x0FFFFFF8)
+        return false;
+
+    FAT32_DirEntry fe;
+    FAT32_DirSlot fe_slot;
+    if (!fat32_find_entry_slot(dir_cluster, name, &fe, &fe_slot, NULL, NULL)) {
+        if (!fat32_create_file(fullpath) ||
+            !fat32_find_entry_slot(dir_cluster, name, &fe, &fe_slot, NULL, NULL))
+            return false;
+    }
+    if (fe.Attr & 0x10)
+        return false;
+    if (size == 0)
+        return true;
+
+    uint32_t cluster_bytes = bpb.SecPerClus * SECTOR_SIZE;
+    uint32_t from = offset < fe.FileSize ? offset : fe.FileSize;
+    uint32_t first = from / cluster_bytes;
+    uint32_t last = (end - 1) / cluster_bytes;
+    uint32_t cluster = ((uint32_t)fe.FstClusHI << 16) | fe.FstClusLO;
+    uint32_t prev = 0;
+    bool entry_dirty = false;
+
+    for (uint32_t idx = 0; idx <= last; idx++) {
+        if (cluster < 2 || cluster >= 0x0FFFFFF8) {
+            uint32_t fresh = fat32_alloc_cluster(fat32_drive);
+            if (!fresh) {
+                kprint("FAT32: No more clusters available!\n");
+                return false;
+            }
+            if (prev) {
+                fat32_set_next(prev, fresh);
+            } else {
+                fe.FstClusLO = (uint16_t)(fresh & 0xFFFF);
+                fe.FstClusHI = (uint16_t)(fresh >> 16);
+                entry_dirty = true;
+            }
+            cluster = fresh;
+        }
+        if (idx >= first) {
+            uint32_t cstart = idx * cluster_bytes;
+            uint32_t a = from > cstart ? from - cstart : 0;
+            uint32_t b = end - cstart < cluster_bytes ? end - cstart : cluster_bytes;
+            fat32_write_span(cluster, cstart, a, b, offset, data);
+        }
+        prev = cluster;
+        cluster = fat32_next_cluster(fat32_drive, cluster);
+    }
+
+    if (end > fe.FileSize) {
+        fe.FileSize = end;
+        entry_dirty = true;
+    }
+    if (entry_dirty)
+        fat32_dir_write_raw(&fe_slot, &fe);
+    return true;
+}
+
 // ────────────────────────────────
 // FAT32 8.3 파일명 변환 (공백 패딩 포함)
 // ────────────────────────────────
@@ -1490,6 +1701,7 @@ bool fat32_rm(const char* fullpath) {
     for (uint32_t i = 0; i < lfn_count; i++)
         fat32_dir_mark_deleted(&lfn_slots[i]);
     fat32_dir_mark_deleted(&slot);
+    fat32_dcache_forget(dir_cluster, name, &entry);
 
     kprintf("FAT32: deleted '%s'\n", fullpath);
     return true;
@@ -1829,6 +2041,7 @@ bool fat32_mkdir(const char* dirname) {
     entry.FileSize = 0;
 
     fat32_dir_write_raw(&slots[lfn_count], &entry);
+    fat32_dcache_forget(cluster, name_only, &entry);
 
     // ─────────────────────────────
     // ④ 새 디렉터리 클러스터 초기화 (. / ..)
@@ -1950,6 +2163,8 @@ bool fat32_rmdir(const char* dirname) {
     for (uint32_t i = 0; i < lfn_count; i++)
         fat32_dir_mark_deleted(&lfn_slots[i]);
     fat32_dir_mark_deleted(&slot);
+    fat32_dcache_forget(cluster, name_only, &entry);
+    dcache_invalidate_children(fat32_drive, dirclus);
 
     kprintf("rmdir: directory '%s' deleted.\n", dirname);
     return true;
@@ -1971,11 +2186,19 @@ uint32_t fat32_find_dir_cluster(uint32_t start_cluster, const char* dirname) {
         return parent;
     }
 
+    uint8_t type = DCACHE_NEGATIVE;
+    uint32_t node = 0;
+    if (dcache_lookup(fat32_drive, start_cluster, dirname, true, &type, &node))
+        return (type == DCACHE_DIR) ? node : 0;
+
     fat32_dir_find_ctx_t ctx = {
         .name = dirname,
         .found = 0,
     };
     fat32_iterate_dir(start_cluster, fat32_find_dir_cb, &ctx);
+    // 디렉터리만 찾으므로 같은 이름의 파일도 NEGATIVE로 기록
+    dcache_insert(fat32_drive, start_cluster, dirname, true,
+                  ctx.found ? DCACHE_DIR : DCACHE_NEGATIVE, ctx.found);
     return ctx.found;
 }
 
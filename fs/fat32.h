@@ -43,6 +43,17 @@ typedef struct __attribute__((packed)) {
     uint8_t  FilSysType[8];
 } FAT32_BPB_t;
 
+// 마운트 테이블이 볼륨마다 보관하는 드라이버 상태
+typedef struct {
+    FAT32_BPB_t bpb;
+    uint32_t fat_start_lba;
+    uint32_t data_start_lba;
+    uint32_t root_dir_cluster;
+    uint32_t current_dir_cluster;
+    uint32_t alloc_hint;
+    uint8_t drive;
+} FAT32_VolumeState;
+
 typedef struct {
     uint8_t Name[11];
     uint8_t Attr;
@@ -60,9 +71,12 @@ typedef struct {
 
 bool probe_fat32_pbr(uint8_t drive, uint32_t base_lba);
 bool fat32_init(uint8_t drive, uint32_t lba_start);
+void fat32_save_state(FAT32_VolumeState* out);
+void fat32_load_state(const FAT32_VolumeState* in);
 void fat32_ls(const char* path);
 int fat32_read_dir(uint32_t cluster, FAT32_DirEntry* out, uint32_t max);
 int fat32_list_dir_lfn(uint32_t cluster, char* names, bool* is_dir, int max_entries, size_t name_len);
+int fat32_getdents(uint32_t cluster, uint32_t* cookie, uint8_t* buf, uint32_t len);
 int fat32_read_file(const char* filename, uint8_t* buffer, uint32_t offset, uint32_t size);
 bool fat32_find_file(const char* filename, FAT32_DirEntry* out_entry);
 void fat32_cat(const char* filename);
@@ -84,6 +98,7 @@ uint32_t fat32_free_clusters();
 
 bool fat32_create_file(const char* fullpath);
 bool fat32_write_file(const char* fullpath, const uint8_t* data, uint32_t size);
+bool fat32_write_at(const char* fullpath, uint32_t offset, const uint8_t* data, uint32_t size);
 bool fat32_format_at(uint8_t drive, uint32_t base_lba, uint32_t total_sectors, const char* label);
 bool fat32_format(uint8_t drive, const char* label);
 
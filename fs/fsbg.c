@@ -3,61 +3,38 @@
 #include "fat32.h"
 #include "xvfs.h"
 #include "disk.h"
+#include "pagecache.h"
+#include "mount.h"
+#include "fscmd.h"
 #include "../drivers/screen.h"
+#include "../cpu/timer.h"
 #include "../mm/mem.h"
 #include "../libc/string.h"
 
-//───────────────
-// Auto-mount flags
-//───────────────
-static bool fat16_ready = false;
-static bool fat32_ready = false;
-static bool xvfs_ready  = false;
-static int fat16_mounted_disk = -1;
-static int fat32_mounted_disk = -1;
-static int xvfs_mounted_disk  = -1;
-
 //───────────────
 // Auto-mount helper
 //───────────────
+// 마운트 테이블에 이미 올라간 볼륨이면 드라이버 상태만 전환 (부트 섹터 재읽기 없음)
 static void fsbg_auto_mount_if_needed(const char* fs_name) {
     extern DiskInfo disks[MAX_DISKS];
 
-    for (int i = 0; i < MAX_DISKS; i++) {
-        if (!disks[i].present || !disks[i].fs_type[0]) continue;
-
-        // FAT16
-        if (strcmp(fs_name, "FAT16") == 0 && !fat16_ready && strcmp(disks[i].fs_type, "FAT16") == 0) {
-            kprintf("[fsbg] auto-mounting FAT16 on disk %d (LBA=%u)\n", i, disks[i].base_lba);
-            if (fat16_init(i, disks[i].base_lba)) {
-                fat16_ready = true;
-                kprint("[fsbg] FAT16 mounted automatically\n");
-            } else {
-                kprint("[fsbg] FAT16 auto-mount failed\n");
-            }
-        }
+    if (current_drive >= 0 && strcmp(fs_to_string(current_fs), fs_name) == 0) {
+        mount_activate(current_drive);
+        return;
+    }
 
-        // FAT32
-        if (strcmp(fs_name, "FAT32") == 0 && !fat32_ready && strcmp(disks[i].fs_type, "FAT32") == 0) {
-            kprintf("[fsbg] auto-mounting FAT32 on disk %d (LBA=%u)\n", i, disks[i].base_lba);
-            if (fat32_init(i, disks[i].base_lba)) {
-                fat32_ready = true;
-                kprint("[fsbg] FAT32 mounted automatically\n");
-            } else {
-                kprint("[fsbg] FAT32 auto-mount failed\n");
-            }
+    for (int i = 0; i < MAX_DISKS; i++) {
+        if (!disks[i].present || strcmp(disks[i].fs_type, fs_name) != 0) continue;
+        if (mount_find_drive(i)) {
+            mount_activate(i);
+            return;
         }
-
-        // XVFS
-        if (strcmp(fs_name, "XVFS") == 0 && !xvfs_ready && strcmp(disks[i].fs_type, "XVFS") == 0) {
-            kprintf("[fsbg] auto-mounting XVFS on disk %d (LBA=%u)\n", i, disks[i].base_lba);
-            if (xvfs_init(i, disks[i].base_lba)) {
-                xvfs_ready = true;
-                kprint("[fsbg] XVFS mounted automatically\n");
-            } else {
-                kprint("[fsbg] XVFS auto-mount failed\n");
-            }
+        kprintf("[fsbg] auto-mounting %s on disk %d (LBA=%u)\n", fs_name, i, disks[i].base_lba);
+        if (mount_volume(i)) {
+            kprintf("[fsbg] %s mounted automatically\n", fs_name);
+            return;
         }
+        kprintf("[fsbg] %s auto-mount failed\n", fs_name);
     }
 }
 
@@ -65,45 +42,20 @@ static void fsbg_auto_mount_if_needed(const char* fs_name) {
 // Per-disk mount helper
 //───────────────
 static bool fsbg_mount_disk(const char* fs_name, int disk) {
-    extern DiskInfo disks[MAX_DISKS];
-
     if (!fs_name)
         return false;
     if (disk < 0)
         return true;
-    if (disk >= MAX_DISKS)
-        return false;
-    if (!disks[disk].present)
-        return false;
-
-    if (strcmp(fs_name, "FAT16") == 0) {
-        if (fat16_mounted_disk == disk)
-            return true;
-        if (!fat16_init(disk, disks[disk].base_lba))
-            return false;
-        fat16_mounted_disk = disk;
-        return true;
-    }
 
-    if (strcmp(fs_name, "FAT32") == 0) {
-        if (fat32_mounted_disk == disk)
-            return true;
-        if (!fat32_init(disk, disks[disk].base_lba))
-            return false;
-        fat32_mounted_disk = disk;
-        return true;
-    }
+    mount_t* m = mount_volume(disk);
+    return m && strcmp(fs_to_string(m->fs), fs_name) == 0;
+}
 
-    if (strcmp(fs_name, "XVFS") == 0) {
-        if (xvfs_mounted_disk == disk)
-            return true;
-        if (!xvfs_init(disk, disks[disk].base_lba))
-            return false;
-        xvfs_mounted_disk = disk;
-        return true;
+// 작업이 끝나면 셸의 현재 볼륨 상태를 드라이버에 되돌림
+static void fsbg_restore_current(void) {
+    if (current_drive >= 0) {
+        mount_activate(current_drive);
     }
-
-    return false;
 }
 
 // ─────────────────────────────
@@ -315,7 +267,72 @@ static int fsbg_list_dir_entries(const char* fs, int disk, const char* path, Fsb
     return -1;
 }
 
-static bool fsbg_copy_file_disk(FSDriver* src, FSDriver* dst,
+// ─────────────────────────────
+// 복사 작업 상태 (고정 크기 버퍼 + 처리량 집계)
+// ─────────────────────────────
+// 파일 크기와 상관없이 FSBG_COPY_BUFS개의 조각 버퍼만 씀. 원본에서 버퍼를 모두 채운 뒤
+// 대상 볼륨으로 한 번 넘어가 차례로 쓰므로, 볼륨 전환은 조각 FSBG_COPY_BUFS개마다 한 번
+#define FSBG_COPY_CHUNK (64u * 1024u)
+#define FSBG_COPY_BUFS  2
+
+typedef struct {
+    uint8_t* bufs[FSBG_COPY_BUFS];  // 파일 간에 재사용
+    uint32_t files;
+    uint32_t bytes;
+    uint32_t read_ticks;
+    uint32_t write_ticks;
+    uint32_t start_tick;
+} FsbgCopyJob;
+
+static void fsbg_job_begin(FsbgCopyJob* job) {
+    memset(job, 0, sizeof(*job));
+    job->start_tick = tick;
+}
+
+static bool fsbg_job_buffers(FsbgCopyJob* job) {
+    for (int i = 0; i < FSBG_COPY_BUFS; i++) {
+        if (!job->bufs[i]) {
+            job->bufs[i] = (uint8_t*)kmalloc(FSBG_COPY_CHUNK, 0, NULL);
+            if (!job->bufs[i])
+                return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t fsbg_ticks_to_ms(uint32_t ticks) {
+    uint32_t freq = timer_frequency();
+    if (freq == 0) {
+        return 0;
+    }
+    return (ticks / freq) * 1000u + ((ticks % freq) * 1000u) / freq;
+}
+
+static void fsbg_job_end(FsbgCopyJob* job, bool ok) {
+    if (ok && job->files > 0) {
+        uint32_t ms = fsbg_ticks_to_ms(tick - job->start_tick);
+        uint32_t kb = job->bytes / 1024u;
+        uint32_t rate = ms ? (kb / ms) * 1000u + ((kb % ms) * 1000u) / ms : kb;
+        kprintf("[fsbg] %u files, %u KB in %u ms (%u KB/s, read %u ms, write %u ms)\n",
+                job->files, kb, ms, rate,
+                fsbg_ticks_to_ms(job->read_ticks), fsbg_ticks_to_ms(job->write_ticks));
+    }
+    for (int i = 0; i < FSBG_COPY_BUFS; i++) {
+        if (job->bufs[i])
+            kfree(job->bufs[i]);
+    }
+    memset(job, 0, sizeof(*job));
+}
+
+// 실행 중인 이미지 파일은 덮어쓰거나 지우지 못하게 함
+static bool fsbg_text_busy(int disk, const char* path) {
+    if (!pagecache_write_denied_at(disk, path, false))
+        return false;
+    kprintf("[fsbg] %s: text file busy\n", path);
+    return true;
+}
+
+static bool fsbg_copy_file_disk(FsbgCopyJob* job, FSDriver* src, FSDriver* dst,
                                 const char* src_fs, const char* dst_fs,
                                 int src_disk, int dst_disk,
                                 const char* src_name, const char* dst_name) {
@@ -333,59 +350,75 @@ static bool fsbg_copy_file_disk(FSDriver* src, FSDriver* dst,
     }
 
     uint32_t size = src->get_size ? src->get_size(src_name) : 0;
-    if (size == 0) {
-        uint8_t dummy = 0;
-        if (!fsbg_mount_disk(dst_fs, dst_disk)) {
-            kprintf("[fsbg] mount failed for %s on disk %d\n", dst_fs, dst_disk);
-            return false;
-        }
-        if (dst->exists(dst_name))
-            dst->remove(dst_name);
-        if (!dst->create(dst_name, &dummy, 0)) {
-            kprintf("[fsbg] create/write failed on %s\n", dst_fs);
-            return false;
-        }
-        kprintf("[fsbg] copied %s (%s -> %s, 0 bytes)\n", src_name, src_fs, dst_fs);
-        return true;
-    }
-
-    uint8_t* buf = (uint8_t*)kmalloc(size, 0, NULL);
-    if (!buf) {
+    if (size > 0 && !fsbg_job_buffers(job)) {
         kprintf("[fsbg] memory alloc failed\n");
         return false;
     }
 
-    int read = src->read_file(src_name, buf, size);
-    if (read <= 0) {
-        kprintf("[fsbg] read failed from %s\n", src_fs);
-        kfree(buf);
+    if (fsbg_text_busy(dst_disk, dst_name))
         return false;
-    }
-    if ((uint32_t)read < size) {
-        size = (uint32_t)read;
-    }
 
+    // 대상은 빈 파일로 만든 뒤 조각마다 끝에 이어 씀
+    uint8_t dummy = 0;
     if (!fsbg_mount_disk(dst_fs, dst_disk)) {
         kprintf("[fsbg] mount failed for %s on disk %d\n", dst_fs, dst_disk);
-        kfree(buf);
         return false;
     }
-
+    uint32_t t0 = tick;
     if (dst->exists(dst_name))
         dst->remove(dst_name);
-
-    if (!dst->create(dst_name, buf, size)) {
+    bool created = dst->create(dst_name, &dummy, 0);
+    job->write_ticks += tick - t0;
+    if (!created) {
         kprintf("[fsbg] create/write failed on %s\n", dst_fs);
-        kfree(buf);
         return false;
     }
 
+    uint32_t done = 0;
+    while (done < size) {
+        if (!fsbg_mount_disk(src_fs, src_disk)) {
+            kprintf("[fsbg] mount failed for %s on disk %d\n", src_fs, src_disk);
+            return false;
+        }
+        uint32_t lens[FSBG_COPY_BUFS];
+        int filled = 0;
+        uint32_t pos = done;
+        t0 = tick;
+        while (filled < FSBG_COPY_BUFS && pos < size) {
+            uint32_t len = size - pos < FSBG_COPY_CHUNK ? size - pos : FSBG_COPY_CHUNK;
+            if (!src->read_at(src_name, pos, job->bufs[filled], len)) {
+                job->read_ticks += tick - t0;
+                kprintf("[fsbg] read failed from %s\n", src_fs);
+                return false;
+            }
+            lens[filled++] = len;
+            pos += len;
+        }
+        job->read_ticks += tick - t0;
+
+        if (!fsbg_mount_disk(dst_fs, dst_disk)) {
+            kprintf("[fsbg] mount failed for %s on disk %d\n", dst_fs, dst_disk);
+            return false;
+        }
+        t0 = tick;
+        for (int i = 0; i < filled; i++) {
+            if (!dst->write_at(dst_name, done, job->bufs[i], lens[i])) {
+                job->write_ticks += tick - t0;
+                kprintf("[fsbg] create/write failed on %s\n", dst_fs);
+                return false;
+            }
+            done += lens[i];
+        }
+        job->write_ticks += tick - t0;
+    }
+
     kprintf("[fsbg] copied %s (%s -> %s, %u bytes)\n", src_name, src_fs, dst_fs, size);
-    kfree(buf);
+    job->files++;
+    job->bytes += size;
     return true;
 }
 
-static bool fsbg_copy_dir_recursive(FSDriver* src, FSDriver* dst,
+static bool fsbg_copy_dir_recursive(FsbgCopyJob* job, FSDriver* src, FSDriver* dst,
                                     const char* src_fs, const char* dst_fs,
                                     int src_disk, int dst_disk,
                                     const char* src_dir, const char* dst_dir,
@@ -434,17 +467,18 @@ static bool fsbg_copy_dir_recursive(FSDriver* src, FSDriver* dst,
         }
 
         if (entries[i].is_dir) {
-            if (!fsbg_copy_dir_recursive(src, dst, src_fs, dst_fs, src_disk, dst_disk, src_child, dst_child, remove_src)) {
+            if (!fsbg_copy_dir_recursive(job, src, dst, src_fs, dst_fs, src_disk, dst_disk, src_child, dst_child, remove_src)) {
                 ok = false;
                 break;
             }
         } else {
-            if (!fsbg_copy_file_disk(src, dst, src_fs, dst_fs, src_disk, dst_disk, src_child, dst_child)) {
+            if (!fsbg_copy_file_disk(job, src, dst, src_fs, dst_fs, src_disk, dst_disk, src_child, dst_child)) {
                 ok = false;
                 break;
             }
             if (remove_src) {
-                if (!fsbg_mount_disk(src_fs, src_disk) || !src->remove(src_child)) {
+                if (fsbg_text_busy(src_disk, src_child) ||
+                    !fsbg_mount_disk(src_fs, src_disk) || !src->remove(src_child)) {
                 kprintf("[fsbg] failed to remove file: %s\n", src_child);
                 ok = false;
                 break;
@@ -513,6 +547,8 @@ FSDriver fs_fat16 = {
     .create = fat16_create_file_compat,   // ✅ 래퍼 사용
     .read_file = (uint32_t (*)(const char*, uint8_t*, uint32_t))fat16_read_file_by_name,
     .write_file = fat16_write_file_compat,
+    .read_at = fat16_read_file_partial,
+    .write_at = fat16_write_at,
     .remove = fat16_rm,
 };
 
@@ -523,6 +559,8 @@ FSDriver fs_fat32 = {
     .create = fat32_create_file_compat,   // ✅ 래퍼 사용
     .read_file = (uint32_t (*)(const char*, uint8_t*, uint32_t))fat32_read_file_by_name,
     .write_file = fat32_write_file,
+    .read_at = fat32_read_file_partial,
+    .write_at = fat32_write_at,
     .remove = fat32_rm,
 };
 
@@ -533,13 +571,15 @@ FSDriver fs_xvfs = {
     .create = xvfs_create_file, // 이미 시그니처 맞음
     .read_file = (uint32_t (*)(const char*, uint8_t*, uint32_t))xvfs_read_file_by_name,
     .write_file = xvfs_write_file,
+    .read_at = xvfs_read_file_partial,
+    .write_at = xvfs_write_at,
     .remove = xvfs_rm,
 };
 
 // ─────────────────────────────
-// 공통 복사 함수 (전체 파일 단위)
+// 공통 복사 함수 (조각 단위)
 // ─────────────────────────────
-bool fsbg_copy(FSDriver* src, FSDriver* dst, const char* src_name, const char* dst_name) {
+static bool fsbg_copy_impl(FSDriver* src, FSDriver* dst, const char* src_name, const char* dst_name) {
     if (!src || !dst || !src_name || !dst_name) {
         kprintf("[fsbg] invalid args\n");
         return false;
@@ -548,59 +588,25 @@ bool fsbg_copy(FSDriver* src, FSDriver* dst, const char* src_name, const char* d
     // ✅ 자동 마운트
     fsbg_auto_mount_if_needed(src->name);
     fsbg_auto_mount_if_needed(dst->name);
+    pagecache_invalidate_all();
 
-    if (!src->exists(src_name)) {
-        kprintf("[fsbg] source not found: %s (%s)\n", src_name, src->name);
-        return false;
-    }
-
-    uint32_t size = src->get_size ? src->get_size(src_name) : 0;
-    if (size == 0) {
-        uint8_t dummy = 0;
-        if (dst->exists(dst_name))
-            dst->remove(dst_name);
-        if (!dst->create(dst_name, &dummy, 0)) {
-            kprintf("[fsbg] create/write failed on %s\n", dst->name);
-            return false;
-        }
-        kprintf("[fsbg] copied %s (%s -> %s, 0 bytes)\n", src_name, src->name, dst->name);
-        return true;
-    }
-
-    uint8_t* buf = (uint8_t*)kmalloc(size, 0, NULL);
-    if (!buf) {
-        kprintf("[fsbg] memory alloc failed\n");
-        return false;
-    }
-
-    int read = src->read_file(src_name, buf, size);
-    if (read <= 0) {
-        kprintf("[fsbg] read failed from %s\n", src->name);
-        kfree(buf);
-        return false;
-    }
-    if ((uint32_t)read < size) {
-        size = (uint32_t)read;
-    }
-
-    if (dst->exists(dst_name))
-        dst->remove(dst_name);
-
-    if (!dst->create(dst_name, buf, size)) {
-        kprintf("[fsbg] create/write failed on %s\n", dst->name);
-        kfree(buf);
-        return false;
-    }
+    FsbgCopyJob job;
+    fsbg_job_begin(&job);
+    bool ok = fsbg_copy_file_disk(&job, src, dst, src->name, dst->name, -1, -1, src_name, dst_name);
+    fsbg_job_end(&job, ok);
+    return ok;
+}
 
-    kprintf("[fsbg] copied %s (%s -> %s, %u bytes)\n", src_name, src->name, dst->name, size);
-    kfree(buf);
-    return true;
+bool fsbg_copy(FSDriver* src, FSDriver* dst, const char* src_name, const char* dst_name) {
+    bool ok = fsbg_copy_impl(src, dst, src_name, dst_name);
+    fsbg_restore_current();
+    return ok;
 }
 
 // ─────────────────────────────
 // 이동 (복사 후 원본 삭제)
 // ─────────────────────────────
-bool fsbg_move(FSDriver* src, FSDriver* dst, const char* src_name, const char* dst_name) {
+static bool fsbg_move_impl(FSDriver* src, FSDriver* dst, const char* src_name, const char* dst_name) {
     if (!src || !dst || !src_name || !dst_name) {
         kprintf("[fsbg] invalid args\n");
         return false;
@@ -608,12 +614,17 @@ bool fsbg_move(FSDriver* src, FSDriver* dst, const char* src_name, const char* d
 
     fsbg_auto_mount_if_needed(src->name);
     fsbg_auto_mount_if_needed(dst->name);
+    pagecache_invalidate_all();
 
     if (fsbg_is_dir_by_fs(src->name, -1, src_name)) {
-        return fsbg_copy_dir_recursive(src, dst, src->name, dst->name, -1, -1, src_name, dst_name, true);
+        FsbgCopyJob job;
+        fsbg_job_begin(&job);
+        bool ok = fsbg_copy_dir_recursive(&job, src, dst, src->name, dst->name, -1, -1, src_name, dst_name, true);
+        fsbg_job_end(&job, ok);
+        return ok;
     }
 
-    if (!fsbg_copy(src, dst, src_name, dst_name))
+    if (fsbg_text_busy(-1, src_name) || !fsbg_copy_impl(src, dst, src_name, dst_name))
         return false;
 
     if (!src->remove(src_name)) {
@@ -624,10 +635,16 @@ bool fsbg_move(FSDriver* src, FSDriver* dst, const char* src_name, const char* d
     return true;
 }
 
+bool fsbg_move(FSDriver* src, FSDriver* dst, const char* src_name, const char* dst_name) {
+    bool ok = fsbg_move_impl(src, dst, src_name, dst_name);
+    fsbg_restore_current();
+    return ok;
+}
+
 // ─────────────────────────────
 // 디스크 간 복사 (디렉터리 지원)
 // ─────────────────────────────
-bool fsbg_copy_disk(const char* src_arg, const char* dst_arg) {
+static bool fsbg_copy_disk_impl(const char* src_arg, const char* dst_arg) {
     extern DiskInfo disks[MAX_DISKS];
 
     if (!src_arg || !dst_arg) {
@@ -672,6 +689,7 @@ bool fsbg_copy_disk(const char* src_arg, const char* dst_arg) {
 
     fsbg_strip_trailing_slash(src_fixed);
     fsbg_strip_trailing_slash(dst_fixed);
+    pagecache_invalidate_drive(dst_disk);
 
     fsbg_auto_mount_if_needed(src->name);
     fsbg_auto_mount_if_needed(dst->name);
@@ -693,7 +711,11 @@ bool fsbg_copy_disk(const char* src_arg, const char* dst_arg) {
         }
 
         kprintf("[cp -b] %s(%s) -> %s(%s)\n", src_fixed, src_fs, dst_dir, dst_fs);
-        return fsbg_copy_dir_recursive(src, dst, src_fs, dst_fs, src_disk, dst_disk, src_fixed, dst_dir, false);
+        FsbgCopyJob job;
+        fsbg_job_begin(&job);
+        bool ok = fsbg_copy_dir_recursive(&job, src, dst, src_fs, dst_fs, src_disk, dst_disk, src_fixed, dst_dir, false);
+        fsbg_job_end(&job, ok);
+        return ok;
     }
 
     if (!src->exists(src_fixed)) {
@@ -716,5 +738,15 @@ bool fsbg_copy_disk(const char* src_arg, const char* dst_arg) {
     kprintf("[cp -b] %s(%s) -> %s(%s)\n", src_fixed, src_fs, dst_full, dst_fs);
 
     // 복사 실행
-    return fsbg_copy_file_disk(src, dst, src_fs, dst_fs, src_disk, dst_disk, src_fixed, dst_full);
+    FsbgCopyJob job;
+    fsbg_job_begin(&job);
+    bool ok = fsbg_copy_file_disk(&job, src, dst, src_fs, dst_fs, src_disk, dst_disk, src_fixed, dst_full);
+    fsbg_job_end(&job, ok);
+    return ok;
+}
+
+bool fsbg_copy_disk(const char* src_arg, const char* dst_arg) {
+    bool ok = fsbg_copy_disk_impl(src_arg, dst_arg);
+    fsbg_restore_current();
+    return ok;
 }
@@ -14,6 +14,8 @@ typedef struct {
     bool (*create)(const char* path, const uint8_t* data, uint32_t size);
     uint32_t (*read_file)(const char* path, uint8_t* buf, uint32_t maxsize);
     bool (*write_file)(const char* path, const uint8_t* buf, uint32_t size);
+    bool (*read_at)(const char* path, uint32_t offset, uint8_t* buf, uint32_t size);
+    bool (*write_at)(const char* path, uint32_t offset, const uint8_t* buf, uint32_t size);
     bool (*remove)(const char* path);
 } FSDriver;
 
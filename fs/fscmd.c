@@ -3,6 +3,9 @@
 #include "fat32.h"
 #include "xvfs.h"
 #include "disk.h"
+#include "pagecache.h"
+#include "mount.h"
+#include "dcache.h"
 #include "../drivers/screen.h"
 #include "../drivers/ata.h"
 #include "../libc/string.h"
@@ -16,6 +19,49 @@ int current_drive = -1;
 extern DiskInfo disks[MAX_DISKS];   // disk_t 대신 DiskInfo
 char current_path[256] = "/";
 
+typedef struct {
+    int drive;
+    fs_type_t fs;
+} fscmd_volume_t;
+
+// 마운트 접두사(/d0, /usb0 ...)가 붙은 경로면 그 볼륨으로 잠시 전환하고
+// 접두사를 뗀 경로를 돌려줌. 드라이버 전역 상태는 mount 테이블에서 복원.
+static const char* fscmd_enter(const char* path, fscmd_volume_t* saved) {
+    saved->drive = current_drive;
+    saved->fs = current_fs;
+
+    int drive = -1;
+    const char* rest = mount_strip_prefix(path, &drive);
+    if (rest) {
+        mount_t* m = mount_find_drive(drive);
+        if (m && mount_activate(drive)) {
+            current_drive = drive;
+            current_fs = m->fs;
+            return rest;
+        }
+    }
+    if (current_drive >= 0) {
+        mount_activate(current_drive);
+    }
+    return path;
+}
+
+static void fscmd_leave(const fscmd_volume_t* saved) {
+    current_drive = saved->drive;
+    current_fs = saved->fs;
+    if (current_drive >= 0) {
+        mount_activate(current_drive);
+    }
+}
+
+static bool fscmd_same_volume(const char* a, const char* b) {
+    int drive_a = current_drive;
+    int drive_b = current_drive;
+    mount_strip_prefix(a, &drive_a);
+    mount_strip_prefix(b, &drive_b);
+    return drive_a == drive_b;
+}
+
 static bool write_progress_active = false;
 static uint32_t write_progress_total = 0;
 static uint32_t write_progress_last = 0;
@@ -95,7 +141,7 @@ void fscmd_reset_path(void) {
 // ─────────────────────────────
 // ls 명령어 (FAT16 / FAT32 공통)
 // ─────────────────────────────
-void fscmd_ls(const char* path) {
+static void fscmd_ls_on_volume(const char* path) {
     if (current_fs == FS_FAT16) {
         fat16_ls(path);
     } 
@@ -110,7 +156,14 @@ void fscmd_ls(const char* path) {
     }
 }
 
-int fscmd_list_dir(const char* path, char* names, uint8_t* is_dir, uint32_t max_entries, size_t name_len) {
+void fscmd_ls(const char* path) {
+    fscmd_volume_t vol;
+    path = fscmd_enter(path, &vol);
+    fscmd_ls_on_volume(path);
+    fscmd_leave(&vol);
+}
+
+static int fscmd_list_dir_on_volume(const char* path, char* names, uint8_t* is_dir, uint32_t max_entries, size_t name_len) {
     if (!names || !is_dir || max_entries == 0 || name_len == 0) {
         return -1;
     }
@@ -168,7 +221,41 @@ int fscmd_list_dir(const char* path, char* names, uint8_t* is_dir, uint32_t max_
     return -1;
 }
 
-void fscmd_cat(const char* path) {
+int fscmd_list_dir(const char* path, char* names, uint8_t* is_dir, uint32_t max_entries, size_t name_len) {
+    fscmd_volume_t vol;
+    path = fscmd_enter(path, &vol);
+    int result = fscmd_list_dir_on_volume(path, names, is_dir, max_entries, name_len);
+    fscmd_leave(&vol);
+    return result;
+}
+
+static int fscmd_getdents_on_volume(const char* path, uint32_t* cookie, uint8_t* buf, uint32_t len) {
+    if (current_fs == FS_FAT16) {
+        uint16_t cluster = (!path || path[0] == '\0') ? current_dir_cluster16 : fat16_resolve_dir(path);
+        return fat16_getdents(cluster, cookie, buf, len);
+    }
+    if (current_fs == FS_FAT32) {
+        uint32_t cluster = (!path || path[0] == '\0') ? current_dir_cluster32 : fat32_resolve_dir(path);
+        return fat32_getdents(cluster, cookie, buf, len);
+    }
+    if (current_fs == FS_XVFS) {
+        return xvfs_getdents(path, cookie, buf, len);
+    }
+    return -1;
+}
+
+int fscmd_getdents(const char* path, uint32_t* cookie, uint8_t* buf, uint32_t len) {
+    if (!cookie || !buf || len == 0) {
+        return -1;
+    }
+    fscmd_volume_t vol;
+    path = fscmd_enter(path, &vol);
+    int result = fscmd_getdents_on_volume(path, cookie, buf, len);
+    fscmd_leave(&vol);
+    return result;
+}
+
+static void fscmd_cat_on_volume(const char* path) {
     if (current_fs == FS_FAT16) {
         fat16_cat(path);
     } 
@@ -183,7 +270,34 @@ void fscmd_cat(const char* path) {
     }
 }
 
-bool fscmd_rm(const char* path) {
+void fscmd_cat(const char* path) {
+    fscmd_volume_t vol;
+    path = fscmd_enter(path, &vol);
+    fscmd_cat_on_volume(path);
+    fscmd_leave(&vol);
+}
+
+// 실행 중인 이미지 파일(또는 그 상위 디렉터리)은 바꾸지 못하게 함.
+// src가 있으면 path가 디렉터리일 때의 실제 대상 path/basename(src)도 확인
+static bool fscmd_text_busy(const char* path, const char* src, bool subtree) {
+    bool busy = pagecache_write_denied(path, subtree);
+    if (!busy && src) {
+        const char* base = strrchr(src, '/');
+        char joined[256];
+        snprintf(joined, sizeof(joined), "%s/%s", path, base ? base + 1 : src);
+        busy = pagecache_write_denied(joined, false);
+    }
+    if (busy) {
+        kprintf("%s: text file busy\n", path);
+    }
+    return busy;
+}
+
+static bool fscmd_rm_on_volume(const char* path) {
+    if (fscmd_text_busy(path, NULL, true)) {
+        return false;
+    }
+    pagecache_invalidate(path);
     if (current_fs == FS_FAT16) {
         return fat16_rm(path);
     } 
@@ -199,6 +313,14 @@ bool fscmd_rm(const char* path) {
     }
 }
 
+bool fscmd_rm(const char* path) {
+    fscmd_volume_t vol;
+    path = fscmd_enter(path, &vol);
+    bool result = fscmd_rm_on_volume(path);
+    fscmd_leave(&vol);
+    return result;
+}
+
 void fscmd_write_progress_begin(const char* label, uint32_t total) {
     write_progress_active = true;
     write_progress_total = total;
@@ -296,12 +418,17 @@ void fscmd_write_progress_finish(bool success) {
     write_progress_pad_len = 0;
 }
 
-bool fscmd_write_file(const char* filename, const char* data, uint32_t len) {
+static bool fscmd_write_file_on_volume(const char* filename, const char* data, uint32_t len) {
     const char* fs = disks[current_drive].fs_type;
 
     //kprintf("[DEBUG] fscmd_write_file(): drive=%d, fs=%s\n",
     //        current_drive, fs);
 
+    if (fscmd_text_busy(filename, NULL, false)) {
+        return false;
+    }
+    pagecache_invalidate(filename);
+
     if (strcmp(fs, "FAT16") == 0) {
         int written = fat16_write_file(filename, data, (int)len);
         return written >= 0;
@@ -315,7 +442,15 @@ bool fscmd_write_file(const char* filename, const char* data, uint32_t len) {
     return false;
 }
 
-bool fscmd_exists(const char* path) {
+bool fscmd_write_file(const char* filename, const char* data, uint32_t len) {
+    fscmd_volume_t vol;
+    filename = fscmd_enter(filename, &vol);
+    bool result = fscmd_write_file_on_volume(filename, data, len);
+    fscmd_leave(&vol);
+    return result;
+}
+
+static bool fscmd_exists_on_volume(const char* path) {
     if (current_fs == FS_FAT16)
         return fat16_exists(path);
     else if (current_fs == FS_FAT32)
@@ -328,7 +463,39 @@ bool fscmd_exists(const char* path) {
     }
 }
 
-int fscmd_read_file_by_name(const char* path, uint8_t* buf, uint32_t size) {
+bool fscmd_exists(const char* path) {
+    fscmd_volume_t vol;
+    path = fscmd_enter(path, &vol);
+    bool result = fscmd_exists_on_volume(path);
+    fscmd_leave(&vol);
+    return result;
+}
+
+static bool fscmd_write_at_on_volume(const char* filename, uint32_t offset, const char* data, uint32_t len) {
+    if (fscmd_text_busy(filename, NULL, false)) {
+        return false;
+    }
+    pagecache_invalidate(filename);
+    if (current_fs == FS_FAT16)
+        return fat16_write_at(filename, offset, (const uint8_t*)data, len);
+    else if (current_fs == FS_FAT32)
+        return fat32_write_at(filename, offset, (const uint8_t*)data, len);
+    else if (current_fs == FS_XVFS)
+        return xvfs_write_at(filename, offset, (const uint8_t*)data, len);
+    kprint("No filesystem mounted.\n");
+    return false;
+}
+
+// offset부터 len바이트만 덮어쓰거나 뒤에 이어 씀 (파일 전체를 다시 쓰지 않음)
+bool fscmd_write_at(const char* filename, uint32_t offset, const char* data, uint32_t len) {
+    fscmd_volume_t vol;
+    filename = fscmd_enter(filename, &vol);
+    bool result = fscmd_write_at_on_volume(filename, offset, data, len);
+    fscmd_leave(&vol);
+    return result;
+}
+
+static int fscmd_read_file_by_name_on_volume(const char* path, uint8_t* buf, uint32_t size) {
     if (current_fs == FS_FAT16)
         return fat16_read_file_by_name(path, buf, size);
     else if (current_fs == FS_FAT32)
@@ -341,10 +508,22 @@ int fscmd_read_file_by_name(const char* path, uint8_t* buf, uint32_t size) {
     }
 }
 
+int fscmd_read_file_by_name(const char* path, uint8_t* buf, uint32_t size) {
+    fscmd_volume_t vol;
+    path = fscmd_enter(path, &vol);
+    int result = fscmd_read_file_by_name_on_volume(path, buf, size);
+    fscmd_leave(&vol);
+    return result;
+}
+
 // ─────────────────────────────
 // 파일 복사 (공통 명령어)
 // ─────────────────────────────
-bool fscmd_cp(const char* src, const char* dst) {
+static bool fscmd_cp_on_volume(const char* src, const char* dst) {
+    if (fscmd_text_busy(dst, src, false)) {
+        return false;
+    }
+    pagecache_invalidate(dst);
     if (current_fs == FS_FAT16)
         return fat16_cp(src, dst);
     else if (current_fs == FS_FAT32)
@@ -357,10 +536,31 @@ bool fscmd_cp(const char* src, const char* dst) {
     }
 }
 
+bool fscmd_cp(const char* src, const char* dst) {
+    if (!fscmd_same_volume(src, dst)) {
+        kprint("Source and destination are on different volumes (use cp -b).\n");
+        return false;
+    }
+    const char* dst_rest = mount_strip_prefix(dst, NULL);
+    if (dst_rest) {
+        dst = dst_rest;
+    }
+    fscmd_volume_t vol;
+    src = fscmd_enter(src, &vol);
+    bool result = fscmd_cp_on_volume(src, dst);
+    fscmd_leave(&vol);
+    return result;
+}
+
 // ─────────────────────────────
 // 파일 이동 (공통 명령어)
 // ─────────────────────────────
-bool fscmd_mv(const char* src, const char* dst) {
+static bool fscmd_mv_on_volume(const char* src, const char* dst) {
+    if (fscmd_text_busy(src, NULL, true) || fscmd_text_busy(dst, src, false)) {
+        return false;
+    }
+    pagecache_invalidate(src);
+    pagecache_invalidate(dst);
     if (current_fs == FS_FAT16)
         return fat16_mv(src, dst);
     else if (current_fs == FS_FAT32)
@@ -373,10 +573,26 @@ bool fscmd_mv(const char* src, const char* dst) {
     }
 }
 
+bool fscmd_mv(const char* src, const char* dst) {
+    if (!fscmd_same_volume(src, dst)) {
+        kprint("Source and destination are on different volumes (use cp -b).\n");
+        return false;
+    }
+    const char* dst_rest = mount_strip_prefix(dst, NULL);
+    if (dst_rest) {
+        dst = dst_rest;
+    }
+    fscmd_volume_t vol;
+    src = fscmd_enter(src, &vol);
+    bool result = fscmd_mv_on_volume(src, dst);
+    fscmd_leave(&vol);
+    return result;
+}
+
 // ─────────────────────────────
 // 파일 크기 반환 (공통 명령어)
 // ─────────────────────────────
-uint32_t fscmd_get_file_size(const char* filename) {
+static uint32_t fscmd_get_file_size_on_volume(const char* filename) {
     if (current_fs == FS_FAT16)
         return fat16_get_file_size(filename);
     else if (current_fs == FS_FAT32)
@@ -389,10 +605,18 @@ uint32_t fscmd_get_file_size(const char* filename) {
     }
 }
 
+uint32_t fscmd_get_file_size(const char* filename) {
+    fscmd_volume_t vol;
+    filename = fscmd_enter(filename, &vol);
+    uint32_t result = fscmd_get_file_size_on_volume(filename);
+    fscmd_leave(&vol);
+    return result;
+}
+
 // ─────────────────────────────
 // 파일 일부분 읽기 (공통 명령어)
 // ─────────────────────────────
-bool fscmd_read_file_partial(const char* filename, uint32_t offset, uint8_t* buf, uint32_t size) {
+static bool fscmd_read_file_partial_on_volume(const char* filename, uint32_t offset, uint8_t* buf, uint32_t size) {
     if (current_fs == FS_FAT16)
         return fat16_read_file_partial(filename, offset, buf, size);
     else if (current_fs == FS_FAT32)
@@ -405,7 +629,15 @@ bool fscmd_read_file_partial(const char* filename, uint32_t offset, uint8_t* buf
     }
 }
 
-bool fscmd_mkdir(const char* dirname) {
+bool fscmd_read_file_partial(const char* filename, uint32_t offset, uint8_t* buf, uint32_t size) {
+    fscmd_volume_t vol;
+    filename = fscmd_enter(filename, &vol);
+    bool result = fscmd_read_file_partial_on_volume(filename, offset, buf, size);
+    fscmd_leave(&vol);
+    return result;
+}
+
+static bool fscmd_mkdir_on_volume(const char* dirname) {
     if (current_fs == FS_FAT16) {
         return fat16_mkdir(dirname);
     }
@@ -421,7 +653,15 @@ bool fscmd_mkdir(const char* dirname) {
     }
 }
 
-bool fscmd_cd(const char* path) {
+bool fscmd_mkdir(const char* dirname) {
+    fscmd_volume_t vol;
+    dirname = fscmd_enter(dirname, &vol);
+    bool result = fscmd_mkdir_on_volume(dirname);
+    fscmd_leave(&vol);
+    return result;
+}
+
+static bool fscmd_cd_on_volume(const char* path) {
     if (current_fs == FS_FAT16) {
         return fat16_cd(path);
     }
@@ -437,7 +677,33 @@ bool fscmd_cd(const char* path) {
     }
 }
 
-bool fscmd_rmdir(const char* dirname) {
+// cd /usb0 처럼 접두사로 다른 볼륨에 들어가면 현재 볼륨 자체를 전환
+bool fscmd_cd(const char* path) {
+    int drive = -1;
+    const char* rest = mount_strip_prefix(path, &drive);
+    if (rest) {
+        if (drive != current_drive) {
+            mount_t* m = mount_find_drive(drive);
+            if (!m || !mount_activate(drive)) {
+                return false;
+            }
+            current_drive = drive;
+            current_fs = m->fs;
+            fscmd_reset_path();
+        }
+        path = rest;
+    }
+    if (current_drive >= 0) {
+        mount_activate(current_drive);
+    }
+    return fscmd_cd_on_volume(path);
+}
+
+static bool fscmd_rmdir_on_volume(const char* dirname) {
+    if (fscmd_text_busy(dirname, NULL, true)) {
+        return false;
+    }
+    pagecache_invalidate(dirname);
     if (current_fs == FS_FAT16) {
         return fat16_rmdir(dirname);
     }
@@ -453,7 +719,15 @@ bool fscmd_rmdir(const char* dirname) {
     }
 }
 
-bool fscmd_find_file(const char* path, void* out_entry) {
+bool fscmd_rmdir(const char* dirname) {
+    fscmd_volume_t vol;
+    dirname = fscmd_enter(dirname, &vol);
+    bool result = fscmd_rmdir_on_volume(dirname);
+    fscmd_leave(&vol);
+    return result;
+}
+
+static bool fscmd_find_file_on_volume(const char* path, void* out_entry) {
     if (current_fs == FS_FAT16) {
         return fat16_find_file(path, (FAT16_DirEntry*)out_entry);
     }
@@ -469,11 +743,22 @@ bool fscmd_find_file(const char* path, void* out_entry) {
     }
 }
 
+bool fscmd_find_file(const char* path, void* out_entry) {
+    fscmd_volume_t vol;
+    path = fscmd_enter(path, &vol);
+    bool result = fscmd_find_file_on_volume(path, out_entry);
+    fscmd_leave(&vol);
+    return result;
+}
+
 bool fscmd_read_file_range(void* entry, uint32_t offset, uint8_t* out_buf, uint32_t size) {
     if (!entry || !out_buf || size == 0) {
         kprint("fscmd_read_file_range: invalid arguments\n");
         return false;
     }
+    if (current_drive >= 0) {
+        mount_activate(current_drive);
+    }
 
     if (current_fs == FS_FAT16) {
         return fat16_read_file_range((FAT16_DirEntry*)entry, offset, out_buf, size);
@@ -534,6 +819,12 @@ bool fscmd_format(uint8_t drive, const char* fs) {
             part_sectors = total - base_lba;
     }
 
+    pagecache_invalidate_drive(drive);
+    dcache_invalidate_drive(drive);
+    // 포맷 루틴이 드라이버 전역 상태를 덮어쓰므로 마운트된 볼륨 상태를 먼저 보관
+    mount_park_all();
+    mount_unmount(drive);
+
     // 파일시스템 문자열을 소문자로 정규화
     char type[16];
     strncpy(type, fs, sizeof(type) - 1);
@@ -622,7 +913,7 @@ update_mbr_type:
     return true;
 }
 
-int fscmd_read_file(const char* filename, uint8_t* buffer, uint32_t offset, uint32_t size) {
+static int fscmd_read_file_on_volume(const char* filename, uint8_t* buffer, uint32_t offset, uint32_t size) {
     if (current_fs == FS_FAT16) {
         FAT16_DirEntry entry;
         if (!fat16_find_file(filename, &entry))
@@ -649,3 +940,11 @@ int fscmd_read_file(const char* filename, uint8_t* buffer, uint32_t offset, uint
         return -1;
     }
 }
+
+int fscmd_read_file(const char* filename, uint8_t* buffer, uint32_t offset, uint32_t size) {
+    fscmd_volume_t vol;
+    filename = fscmd_enter(filename, &vol);
+    int result = fscmd_read_file_on_volume(filename, buffer, offset, size);
+    fscmd_leave(&vol);
+    return result;
+}
@@ -23,6 +23,7 @@ const char* fs_to_string(fs_type_t type);
 void fscmd_reset_path(void);
 void fscmd_ls(const char* path);
 int fscmd_list_dir(const char* path, char* names, uint8_t* is_dir, uint32_t max_entries, size_t name_len);
+int fscmd_getdents(const char* path, uint32_t* cookie, uint8_t* buf, uint32_t len);
 void fscmd_cat(const char* path);
 bool fscmd_rm(const char* path);
 bool fscmd_exists(const char* path);
@@ -37,6 +38,7 @@ bool fscmd_cd(const char* path);
 bool fscmd_rmdir(const char* dirname);
 bool fscmd_find_file(const char* path, void* out_entry);
 bool fscmd_write_file(const char* filename, const char* data, uint32_t len);
+bool fscmd_write_at(const char* filename, uint32_t offset, const char* data, uint32_t len);
 void fscmd_write_progress_begin(const char* label, uint32_t total);
 void fscmd_write_progress_update(uint32_t written);
 void fscmd_write_progress_finish(bool success);
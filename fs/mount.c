@@ -0,0 +1,207 @@
+#include "mount.h"
+#include "../drivers/ata.h"
+#include "../drivers/blkcache.h"
+#include "../drivers/screen.h"
+#include "pagecache.h"
+#include "dcache.h"
+#include "../libc/string.h"
+
+static mount_t mounts[MOUNT_MAX];
+// 드라이버별로 지금 전역 상태에 올라가 있는 드라이브 (-1 = 없음)
+static int active_drive[FS_XVFS + 1] = { -1, -1, -1, -1 };
+
+static fs_type_t mount_fs_from_disk(int drive) {
+    const char* type = disks[drive].fs_type;
+    if (strcmp(type, "FAT16") == 0) return FS_FAT16;
+    if (strcmp(type, "FAT32") == 0) return FS_FAT32;
+    if (strcmp(type, "XVFS") == 0) return FS_XVFS;
+    return FS_NONE;
+}
+
+static void mount_make_prefix(int drive, char* out) {
+    ata_backend_t backend = ATA_BACKEND_NONE;
+    int index = 0;
+    if (ata_drive_backend((uint8_t)drive, &backend, &index) && backend == ATA_BACKEND_USB) {
+        snprintf(out, MOUNT_PREFIX_MAX, "/usb%d", index);
+    } else {
+        snprintf(out, MOUNT_PREFIX_MAX, "/d%d", drive);
+    }
+}
+
+static void mount_save(mount_t* m) {
+    if (m->fs == FS_FAT16) fat16_save_state(&m->state.fat16);
+    else if (m->fs == FS_FAT32) fat32_save_state(&m->state.fat32);
+    else if (m->fs == FS_XVFS) xvfs_save_state(&m->state.xvfs);
+}
+
+static void mount_load(const mount_t* m) {
+    if (m->fs == FS_FAT16) fat16_load_state(&m->state.fat16);
+    else if (m->fs == FS_FAT32) fat32_load_state(&m->state.fat32);
+    else if (m->fs == FS_XVFS) xvfs_load_state(&m->state.xvfs);
+}
+
+// 드라이버에 올라가 있는 볼륨의 상태(cwd, alloc hint 등)를 테이블로 되돌림
+static void mount_park(fs_type_t fs) {
+    int drive = active_drive[fs];
+    if (drive < 0) {
+        return;
+    }
+    mount_t* m = mount_find_drive(drive);
+    if (m && m->fs == fs) {
+        mount_save(m);
+    }
+    active_drive[fs] = -1;
+}
+
+void mount_park_all(void) {
+    mount_park(FS_FAT16);
+    mount_park(FS_FAT32);
+    mount_park(FS_XVFS);
+}
+
+mount_t* mount_find_drive(int drive) {
+    for (int i = 0; i < MOUNT_MAX; i++) {
+        if (mounts[i].used && mounts[i].drive == drive) {
+            return &mounts[i];
+        }
+    }
+    return NULL;
+}
+
+bool mount_activate(int drive) {
+    mount_t* m = mount_find_drive(drive);
+    if (!m) {
+        return false;
+    }
+    if (active_drive[m->fs] == drive) {
+        return true;
+    }
+    mount_park(m->fs);
+    mount_load(m);
+    active_drive[m->fs] = drive;
+    return true;
+}
+
+mount_t* mount_volume(int drive) {
+    if (drive < 0 || drive >= MAX_DISKS || !disks[drive].present) {
+        return NULL;
+    }
+
+    mount_t* m = mount_find_drive(drive);
+    if (m) {
+        mount_activate(drive);
+        return m;
+    }
+
+    fs_type_t fs = mount_fs_from_disk(drive);
+    if (fs == FS_NONE) {
+        return NULL;
+    }
+
+    for (int i = 0; i < MOUNT_MAX; i++) {
+        if (!mounts[i].used) {
+            m = &mounts[i];
+            break;
+        }
+    }
+    if (!m) {
+        kprint("[mount] mount table full\n");
+        return NULL;
+    }
+
+    mount_park(fs);
+    uint32_t base = disks[drive].base_lba;
+    bool ok = false;
+    if (fs == FS_FAT16) ok = fat16_init((uint8_t)drive, base);
+    else if (fs == FS_FAT32) ok = fat32_init((uint8_t)drive, base);
+    else if (fs == FS_XVFS) ok = xvfs_init((uint8_t)drive, base);
+    if (!ok) {
+        return NULL;
+    }
+
+    memset(m, 0, sizeof(*m));
+    m->used = true;
+    m->drive = drive;
+    m->fs = fs;
+    mount_make_prefix(drive, m->prefix);
+    mount_save(m);
+    active_drive[fs] = drive;
+    return m;
+}
+
+void mount_unmount(int drive) {
+    mount_t* m = mount_find_drive(drive);
+    if (!m) {
+        return;
+    }
+    // 떼기 전에 캐시에 남은 섹터를 기록 (이미 빠진 장치는 건너뜀)
+    if (disks[drive].present && !blkcache_sync_drive((uint8_t)drive)) {
+        kprintf("[mount] %s: sync failed\n", m->prefix);
+    }
+    if (active_drive[m->fs] == drive) {
+        active_drive[m->fs] = -1;
+    }
+    memset(m, 0, sizeof(*m));
+    pagecache_invalidate_drive(drive);
+    dcache_invalidate_drive(drive);
+}
+
+void mount_unmount_all(void) {
+    if (!blkcache_sync_all()) {
+        kprint("[mount] sync failed\n");
+    }
+    memset(mounts, 0, sizeof(mounts));
+    for (int i = 0; i <= FS_XVFS; i++) {
+        active_drive[i] = -1;
+    }
+    pagecache_invalidate_all();
+    dcache_invalidate_all();
+}
+
+// 디스크 재검색 후 사라졌거나 파일시스템이 바뀐 볼륨을 정리
+void mount_drop_stale(void) {
+    for (int i = 0; i < MOUNT_MAX; i++) {
+        if (!mounts[i].used) {
+            continue;
+        }
+        int drive = mounts[i].drive;
+        if (!disks[drive].present || mount_fs_from_disk(drive) != mounts[i].fs) {
+            mount_unmount(drive);
+        }
+    }
+}
+
+// "/usb0/a/b" -> "/a/b" (drive는 out_drive), 마운트 접두사가 아니면 NULL
+const char* mount_strip_prefix(const char* path, int* out_drive) {
+    if (!path || path[0] != '/') {
+        return NULL;
+    }
+    for (int i = 0; i < MOUNT_MAX; i++) {
+        if (!mounts[i].used) {
+            continue;
+        }
+        size_t len = strlen(mounts[i].prefix);
+        if (strncmp(path, mounts[i].prefix, len) != 0) {
+            continue;
+        }
+        if (path[len] != '\0' && path[len] != '/') {
+            continue;
+        }
+        if (out_drive) {
+            *out_drive = mounts[i].drive;
+        }
+        return path[len] ? path + len : "/";
+    }
+    return NULL;
+}
+
+void mount_list(void) {
+    for (int i = 0; i < MOUNT_MAX; i++) {
+        if (!mounts[i].used) {
+            continue;
+        }
+        kprintf("  %s -> %d# (%s)%s\n", mounts[i].prefix, mounts[i].drive,
+                fs_to_string(mounts[i].fs),
+                mounts[i].drive == current_drive ? " *" : "");
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef MOUNT_H
+#define MOUNT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fscmd.h"
+#include "fat16.h"
+#include "fat32.h"
+#include "xvfs.h"
+#include "disk.h"
+
+#define MOUNT_MAX        MAX_DISKS
+#define MOUNT_PREFIX_MAX 16
+
+// 동시에 마운트된 볼륨 하나. 드라이버 전역 상태를 볼륨별로 보관했다가
+// 전환할 때 복원하므로 부트 섹터를 다시 읽지 않음.
+typedef struct {
+    bool used;
+    int drive;
+    fs_type_t fs;
+    char prefix[MOUNT_PREFIX_MAX];   // 예: /d0, /usb0
+    union {
+        FAT16_VolumeState fat16;
+        FAT32_VolumeState fat32;
+        XVFS_VolumeState xvfs;
+    } state;
+} mount_t;
+
+mount_t* mount_volume(int drive);
+mount_t* mount_find_drive(int drive);
+bool mount_activate(int drive);
+void mount_park_all(void);
+void mount_unmount(int drive);
+void mount_unmount_all(void);
+void mount_drop_stale(void);
+const char* mount_strip_prefix(const char* path, int* out_drive);
+void mount_list(void);
+
+#endif
@@ -0,0 +1,517 @@
+#include "pagecache.h"
+#include "fscmd.h"
+#include "mount.h"
+#include "../kernel/cmd.h"
+#include "../drivers/screen.h"
+#include "../libc/string.h"
+#include "../mm/mem.h"
+#include "../mm/pmm.h"
+
+#define EFLAGS_IF 0x200u
+#define PAGECACHE_HASH_BITS 7u
+#define PAGECACHE_BUCKETS   (1u << PAGECACHE_HASH_BITS)
+
+struct pagecache_page {
+    bool used;
+    bool stale;                 // 무효화됐지만 아직 매핑이 남아있는 페이지
+    int drive;
+    uint32_t hash;
+    uint32_t index;
+    uint32_t valid;             // 페이지 안의 실제 파일 데이터 크기
+    uint32_t refs;
+    uint32_t last_use;
+    uint32_t phys;
+    uint8_t* data;
+    pagecache_page_t* hash_next;    // 같은 버킷의 다음 페이지
+    char path[PAGECACHE_PATH_MAX];
+};
+
+typedef struct {
+    uint32_t refs;
+    int drive;
+    bool nocase;
+    char path[PAGECACHE_PATH_MAX];
+} pagecache_deny_t;
+
+static pagecache_page_t cache_pages[PAGECACHE_MAX_PAGES];
+static pagecache_deny_t deny_table[PAGECACHE_DENY_MAX];
+static pagecache_page_t* cache_buckets[PAGECACHE_BUCKETS];
+static uint32_t cache_clock = 0;
+static uint32_t cache_hits = 0;
+static uint32_t cache_misses = 0;
+static uint32_t cache_evictions = 0;
+
+static inline uint32_t irq_save(void) {
+    uint32_t flags = 0;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+static uint32_t pagecache_hash(const char* s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// 마운트 접두사를 풀고 cwd 기준 절대경로로 만든 뒤, FAT 계열은 대소문자를
+// 무시하므로 소문자로 통일
+static bool pagecache_make_key(const char* path, char* out, int* out_drive) {
+    if (!path || !path[0]) {
+        return false;
+    }
+    int drive = current_drive;
+    fs_type_t fs = current_fs;
+    const char* rest = mount_strip_prefix(path, &drive);
+    if (rest) {
+        mount_t* m = mount_find_drive(drive);
+        if (m) {
+            fs = m->fs;
+        }
+    }
+    if (drive < 0 || fs == FS_NONE) {
+        return false;
+    }
+    normalize_path(out, rest ? "/" : current_path, rest ? rest : path);
+    if (fs != FS_XVFS) {
+        strlower(out);
+    }
+    *out_drive = drive;
+    return true;
+}
+
+// cwd나 현재 드라이브가 바뀌어도 같은 파일을 가리키도록 마운트 접두사를 붙인
+// 절대경로로 바꿈 (나중에 다시 읽을 경로를 저장해 둘 때 사용)
+bool pagecache_abs_path(const char* path, char* out, uint32_t size) {
+    char key[PAGECACHE_PATH_MAX];
+    int drive = 0;
+    if (!out || size == 0 || !pagecache_make_key(path, key, &drive)) {
+        return false;
+    }
+    mount_t* m = mount_find_drive(drive);
+    if (!m) {
+        return false;
+    }
+    if ((uint32_t)(strlen(m->prefix) + strlen(key)) >= size) {
+        return false;
+    }
+    snprintf(out, (int)size, "%s%s", m->prefix, key);
+    return true;
+}
+
+static inline uint32_t pagecache_bucket(uint32_t hash, uint32_t index) {
+    return ((hash ^ index) * 2654435761u) >> (32u - PAGECACHE_HASH_BITS);
+}
+
+static void pagecache_unlink(pagecache_page_t* page) {
+    pagecache_page_t** link = &cache_buckets[pagecache_bucket(page->hash, page->index)];
+    while (*link) {
+        if (*link == page) {
+            *link = page->hash_next;
+            break;
+        }
+        link = &(*link)->hash_next;
+    }
+    page->hash_next = NULL;
+}
+
+static void pagecache_free_slot(pagecache_page_t* page) {
+    if (page->used) {
+        pagecache_unlink(page);
+    }
+    if (page->data) {
+        kfree(page->data);
+    }
+    memset(page, 0, sizeof(*page));
+}
+
+static pagecache_page_t* pagecache_lookup(int drive, uint32_t hash,
+                                          const char* key, uint32_t index) {
+    pagecache_page_t* page = cache_buckets[pagecache_bucket(hash, index)];
+    for (; page; page = page->hash_next) {
+        if (page->stale) {
+            continue;
+        }
+        if (page->drive == drive && page->hash == hash &&
+            page->index == index && strcmp(page->path, key) == 0) {
+            return page;
+        }
+    }
+    return NULL;
+}
+
+static pagecache_page_t* pagecache_find_victim(void) {
+    pagecache_page_t* victim = NULL;
+    for (uint32_t i = 0; i < PAGECACHE_MAX_PAGES; i++) {
+        pagecache_page_t* page = &cache_pages[i];
+        if (!page->used || page->refs != 0) {
+            continue;
+        }
+        if (!victim || page->last_use < victim->last_use) {
+            victim = page;
+        }
+    }
+    return victim;
+}
+
+static pagecache_page_t* pagecache_find_empty(void) {
+    for (uint32_t i = 0; i < PAGECACHE_MAX_PAGES; i++) {
+        if (!cache_pages[i].used) {
+            return &cache_pages[i];
+        }
+    }
+    return NULL;
+}
+
+uint32_t pagecache_reclaim(uint32_t want) {
+    uint32_t freed = 0;
+    uint32_t flags = irq_save();
+    while (freed < want) {
+        pagecache_page_t* victim = pagecache_find_victim();
+        if (!victim) {
+            break;
+        }
+        pagecache_free_slot(victim);
+        cache_evictions++;
+        freed++;
+    }
+    irq_restore(flags);
+    return freed;
+}
+
+static bool pagecache_low_memory(void) {
+    return pmm_get_free_memory() < PAGECACHE_LOW_WATER;
+}
+
+static uint8_t* pagecache_alloc_data(uint32_t* out_phys) {
+    if (pagecache_low_memory()) {
+        pagecache_reclaim(PAGECACHE_MAX_PAGES / 16u);
+    }
+    uint8_t* data = (uint8_t*)kmalloc(PAGECACHE_PAGE_SIZE, 1, out_phys);
+    if (!data && pagecache_reclaim(PAGECACHE_MAX_PAGES / 16u) > 0) {
+        data = (uint8_t*)kmalloc(PAGECACHE_PAGE_SIZE, 1, out_phys);
+    }
+    return data;
+}
+
+pagecache_page_t* pagecache_get(const char* path, uint32_t page_index) {
+    char key[PAGECACHE_PATH_MAX];
+    int drive = -1;
+    if (!pagecache_make_key(path, key, &drive)) {
+        return NULL;
+    }
+    uint32_t hash = pagecache_hash(key);
+
+    uint32_t flags = irq_save();
+    pagecache_page_t* page = pagecache_lookup(drive, hash, key, page_index);
+    if (page) {
+        page->refs++;
+        page->last_use = ++cache_clock;
+        cache_hits++;
+        irq_restore(flags);
+        return page;
+    }
+    cache_misses++;
+    irq_restore(flags);
+
+    uint32_t file_size = fscmd_get_file_size(path);
+    uint32_t start = page_index * PAGECACHE_PAGE_SIZE;
+    if (start / PAGECACHE_PAGE_SIZE != page_index || start >= file_size) {
+        return NULL;
+    }
+    uint32_t valid = file_size - start;
+    if (valid > PAGECACHE_PAGE_SIZE) {
+        valid = PAGECACHE_PAGE_SIZE;
+    }
+
+    uint32_t phys = 0;
+    uint8_t* data = pagecache_alloc_data(&phys);
+    if (!data) {
+        return NULL;
+    }
+    if (!fscmd_read_file_partial(path, start, data, valid)) {
+        kfree(data);
+        return NULL;
+    }
+    if (valid < PAGECACHE_PAGE_SIZE) {
+        memset(data + valid, 0, PAGECACHE_PAGE_SIZE - valid);
+    }
+
+    flags = irq_save();
+    // I/O 중에 다른 쪽에서 같은 페이지를 채웠으면 그쪽을 사용
+    page = pagecache_lookup(drive, hash, key, page_index);
+    if (page) {
+        page->refs++;
+        page->last_use = ++cache_clock;
+        irq_restore(flags);
+        kfree(data);
+        return page;
+    }
+
+    page = pagecache_find_empty();
+    if (!page) {
+        page = pagecache_find_victim();
+        if (page) {
+            pagecache_free_slot(page);
+            cache_evictions++;
+        }
+    }
+    if (!page) {
+        irq_restore(flags);
+        kfree(data);
+        return NULL;
+    }
+
+    page->used = true;
+    page->stale = false;
+    page->drive = drive;
+    page->hash = hash;
+    page->index = page_index;
+    page->valid = valid;
+    page->refs = 1;
+    page->last_use = ++cache_clock;
+    page->phys = phys;
+    page->data = data;
+    strncpy(page->path, key, sizeof(page->path) - 1);
+    page->path[sizeof(page->path) - 1] = '\0';
+    uint32_t bucket = pagecache_bucket(hash, page_index);
+    page->hash_next = cache_buckets[bucket];
+    cache_buckets[bucket] = page;
+    irq_restore(flags);
+    return page;
+}
+
+void pagecache_put(pagecache_page_t* page) {
+    if (!page) {
+        return;
+    }
+    uint32_t flags = irq_save();
+    if (page->refs > 0) {
+        page->refs--;
+    }
+    if (page->stale && page->refs == 0) {
+        pagecache_free_slot(page);
+    }
+    irq_restore(flags);
+}
+
+uint8_t* pagecache_page_data(const pagecache_page_t* page) {
+    return page ? page->data : NULL;
+}
+
+uint32_t pagecache_page_phys(const pagecache_page_t* page) {
+    return page ? page->phys : 0;
+}
+
+uint32_t pagecache_page_valid(const pagecache_page_t* page) {
+    return page ? page->valid : 0;
+}
+
+int pagecache_read(const char* path, uint32_t offset, uint8_t* buf, uint32_t size) {
+    if (!path || !buf) {
+        return -1;
+    }
+
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t pos = offset + done;
+        if (pos < offset) {
+            break;
+        }
+        uint32_t in_page = pos % PAGECACHE_PAGE_SIZE;
+        pagecache_page_t* page = pagecache_get(path, pos / PAGECACHE_PAGE_SIZE);
+        if (!page) {
+            break;
+        }
+        if (page->valid <= in_page) {
+            pagecache_put(page);
+            break;
+        }
+        uint32_t chunk = page->valid - in_page;
+        if (chunk > size - done) {
+            chunk = size - done;
+        }
+        memcpy(buf + done, page->data + in_page, chunk);
+        done += chunk;
+        bool eof = page->valid < PAGECACHE_PAGE_SIZE;
+        pagecache_put(page);
+        if (eof) {
+            break;
+        }
+    }
+
+    if (done == 0 && size != 0 && !fscmd_exists(path)) {
+        return -1;
+    }
+    return (int)done;
+}
+
+static void pagecache_drop(pagecache_page_t* page) {
+    if (page->refs == 0) {
+        pagecache_free_slot(page);
+    } else {
+        page->stale = true;
+    }
+}
+
+// path 자체와 path 아래(디렉터리 이동/삭제) 페이지를 모두 무효화
+void pagecache_invalidate(const char* path) {
+    char key[PAGECACHE_PATH_MAX];
+    int drive = -1;
+    if (!pagecache_make_key(path, key, &drive)) {
+        return;
+    }
+    size_t len = strlen(key);
+    bool root = (len == 1 && key[0] == '/');
+
+    uint32_t flags = irq_save();
+    for (uint32_t i = 0; i < PAGECACHE_MAX_PAGES; i++) {
+        pagecache_page_t* page = &cache_pages[i];
+        if (!page->used || page->stale || page->drive != drive) {
+            continue;
+        }
+        if (root || strcmp(page->path, key) == 0 ||
+            (strncmp(page->path, key, len) == 0 && page->path[len] == '/')) {
+            pagecache_drop(page);
+        }
+    }
+    irq_restore(flags);
+}
+
+void pagecache_invalidate_drive(int drive) {
+    uint32_t flags = irq_save();
+    for (uint32_t i = 0; i < PAGECACHE_MAX_PAGES; i++) {
+        pagecache_page_t* page = &cache_pages[i];
+        if (page->used && !page->stale && page->drive == drive) {
+            pagecache_drop(page);
+        }
+    }
+    irq_restore(flags);
+}
+
+void pagecache_invalidate_all(void) {
+    uint32_t flags = irq_save();
+    for (uint32_t i = 0; i < PAGECACHE_MAX_PAGES; i++) {
+        pagecache_page_t* page = &cache_pages[i];
+        if (page->used && !page->stale) {
+            pagecache_drop(page);
+        }
+    }
+    irq_restore(flags);
+}
+
+int pagecache_deny_write(const char* path) {
+    char key[PAGECACHE_PATH_MAX];
+    int drive = -1;
+    if (!pagecache_make_key(path, key, &drive)) {
+        return -1;
+    }
+    mount_t* m = mount_find_drive(drive);
+    int slot = -1;
+    uint32_t flags = irq_save();
+    for (uint32_t i = 0; i < PAGECACHE_DENY_MAX; i++) {
+        pagecache_deny_t* d = &deny_table[i];
+        if (d->refs && d->drive == drive && strcmp(d->path, key) == 0) {
+            slot = (int)i;
+            break;
+        }
+        if (!d->refs && slot < 0) {
+            slot = (int)i;
+        }
+    }
+    if (slot >= 0) {
+        pagecache_deny_t* d = &deny_table[slot];
+        if (d->refs++ == 0) {
+            d->drive = drive;
+            d->nocase = !m || m->fs != FS_XVFS;
+            strcpy(d->path, key);
+        }
+    }
+    irq_restore(flags);
+    return slot;
+}
+
+void pagecache_allow_write(int slot) {
+    if (slot < 0 || slot >= (int)PAGECACHE_DENY_MAX) {
+        return;
+    }
+    uint32_t flags = irq_save();
+    if (deny_table[slot].refs) {
+        deny_table[slot].refs--;
+    }
+    irq_restore(flags);
+}
+
+// key 자체(subtree면 key 아래도)에 막힌 파일이 있으면 true.
+// lower는 대소문자를 무시하는 볼륨(FAT)에 맞춰 비교할 키
+static bool pagecache_denied_key(int drive, const char* key, const char* lower, bool subtree) {
+    size_t len = strlen(key);
+    bool root = (len == 1 && key[0] == '/');
+    bool denied = false;
+    uint32_t flags = irq_save();
+    for (uint32_t i = 0; i < PAGECACHE_DENY_MAX && !denied; i++) {
+        const pagecache_deny_t* d = &deny_table[i];
+        if (!d->refs || (drive >= 0 && d->drive != drive)) {
+            continue;
+        }
+        const char* k = d->nocase ? lower : key;
+        if (!subtree) {
+            denied = strcmp(d->path, k) == 0;
+        } else {
+            denied = root || (strncmp(d->path, k, len) == 0 &&
+                              (d->path[len] == '\0' || d->path[len] == '/'));
+        }
+    }
+    irq_restore(flags);
+    return denied;
+}
+
+bool pagecache_write_denied(const char* path, bool subtree) {
+    char key[PAGECACHE_PATH_MAX];
+    int drive = -1;
+    if (!pagecache_make_key(path, key, &drive)) {
+        return false;
+    }
+    return pagecache_denied_key(drive, key, key, subtree);
+}
+
+bool pagecache_write_denied_at(int drive, const char* path, bool subtree) {
+    char key[PAGECACHE_PATH_MAX];
+    char lower[PAGECACHE_PATH_MAX];
+    if (!path || !path[0]) {
+        return false;
+    }
+    normalize_path(key, "/", path);
+    strcpy(lower, key);
+    strlower(lower);
+    return pagecache_denied_key(drive, key, lower, subtree);
+}
+
+void pagecache_get_stats(pagecache_stats_t* out) {
+    if (!out) {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+    uint32_t flags = irq_save();
+    for (uint32_t i = 0; i < PAGECACHE_MAX_PAGES; i++) {
+        if (!cache_pages[i].used) {
+            continue;
+        }
+        out->pages++;
+        if (cache_pages[i].refs) {
+            out->pinned++;
+        }
+    }
+    out->hits = cache_hits;
+    out->misses = cache_misses;
+    out->evictions = cache_evictions;
+    irq_restore(flags);
+}
@@ -0,0 +1,47 @@
+#ifndef PAGECACHE_H
+#define PAGECACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 파일 데이터 페이지 캐시 (drive, 절대경로, 페이지 번호) 단위 4KB
+#define PAGECACHE_PAGE_SIZE 4096u
+#define PAGECACHE_MAX_PAGES 256u
+#define PAGECACHE_PATH_MAX  256u
+// PMM 여유 메모리가 이 값보다 작으면 새 페이지를 넣기 전에 LRU 페이지를 회수
+#define PAGECACHE_LOW_WATER (2u * 1024u * 1024u)
+// 실행 중인 이미지처럼 내용이 바뀌면 안 되는 파일 수
+#define PAGECACHE_DENY_MAX  32u
+
+typedef struct pagecache_page pagecache_page_t;
+
+typedef struct {
+    uint32_t pages;
+    uint32_t pinned;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+} pagecache_stats_t;
+
+bool pagecache_abs_path(const char* path, char* out, uint32_t size);
+int pagecache_read(const char* path, uint32_t offset, uint8_t* buf, uint32_t size);
+pagecache_page_t* pagecache_get(const char* path, uint32_t page_index);
+void pagecache_put(pagecache_page_t* page);
+uint8_t* pagecache_page_data(const pagecache_page_t* page);
+uint32_t pagecache_page_phys(const pagecache_page_t* page);
+uint32_t pagecache_page_valid(const pagecache_page_t* page);
+void pagecache_invalidate(const char* path);
+void pagecache_invalidate_drive(int drive);
+void pagecache_invalidate_all(void);
+uint32_t pagecache_reclaim(uint32_t want);
+
+// 요구 페이징으로 다시 읽는 파일(실행 이미지)은 살아 있는 동안 쓰기/삭제/이동을 막음.
+// deny는 allow에 넘길 번호를 돌려줌 (자리가 없으면 -1). subtree면 path 아래 파일도 봄 (rm/rmdir/mv 원본)
+int pagecache_deny_write(const char* path);
+void pagecache_allow_write(int slot);
+bool pagecache_write_denied(const char* path, bool subtree);
+// fsbg처럼 현재 볼륨을 거치지 않는 경로용. drive < 0 이면 모든 드라이브에서 찾음
+bool pagecache_write_denied_at(int drive, const char* path, bool subtree);
+void pagecache_get_stats(pagecache_stats_t* out);
+
+#endif
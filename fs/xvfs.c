@@ -1,5 +1,7 @@
 #include "xvfs.h"
 #include "fscmd.h"
+#include "dirent.h"
+#include "dcache.h"
 #include "../drivers/ata.h"
 #include "../drivers/screen.h"
 #include "../kernel/kernel.h"
@@ -89,6 +91,24 @@ bool xvfs_init(uint8_t drive, uint32_t base_lba) {
     kprintf("  Block size: %u, Root LBA=%u\n", sb.block_size, current_dir_block);
     return true;
 }
+void xvfs_save_state(XVFS_VolumeState* out) {
+    if (!out) return;
+    out->sb = sb;
+    out->base_lba = xvfs_base_lba;
+    out->current_dir_block = current_dir_block;
+    out->root_block = xvfs_root_block;
+    out->drive = xvfs_drive;
+}
+
+void xvfs_load_state(const XVFS_VolumeState* in) {
+    if (!in) return;
+    sb = in->sb;
+    xvfs_base_lba = in->base_lba;
+    current_dir_block = in->current_dir_block;
+    xvfs_root_block = in->root_block;
+    xvfs_drive = in->drive;
+}
+
 /*
 static int xvfs_find_entry(uint32_t dir_block, const char* name, XVFS_FileEntry* out, int* out_index) {
     uint8_t buf[512];
@@ -294,6 +314,53 @@ int xvfs_read_dir_entries(const char* path, XVFS_FileEntry* out_entries, uint32_
     return (int)count;
 }
 
+// 디렉터리는 블록 하나이므로 cookie는 슬롯 번호
+int xvfs_getdents(const char* path, uint32_t* cookie, uint8_t* buf, uint32_t len) {
+    if (!cookie || !buf)
+        return -1;
+
+    uint32_t dir_block = 0;
+    if (!path || !path[0]) {
+        dir_block = current_dir_block;
+    } else {
+        dir_block = xvfs_resolve_path(path, true, NULL);
+    }
+    if (!dir_block)
+        return -1;
+
+    uint8_t block[512];
+    if (!read_block(dir_block, block))
+        return -1;
+
+    XVFS_FileEntry* entry = (XVFS_FileEntry*)block;
+    dirent_writer_t w;
+    dirent_writer_init(&w, buf, len, *cookie);
+
+    for (uint32_t i = *cookie; i < 512 / sizeof(XVFS_FileEntry); i++) {
+        uint8_t first = (uint8_t)entry[i].name[0];
+        if (first == 0x00 || first == 0xE5) {
+            dirent_skip(&w, i + 1);
+            continue;
+        }
+
+        char name[XVFS_MAX_NAME + 1];
+        memcpy(name, entry[i].name, XVFS_MAX_NAME);
+        name[XVFS_MAX_NAME] = '\0';
+
+        fs_dirent_t info;
+        memset(&info, 0, sizeof(info));
+        info.cookie = i + 1;
+        info.size = entry[i].size;
+        info.ino = entry[i].start;
+        info.attr = (entry[i].attr & 1u) ? DIRENT_ATTR_DIR : 0;
+        if (!dirent_put(&w, &info, name))
+            break;
+    }
+
+    *cookie = w.cookie;
+    return dirent_result(&w);
+}
+
 bool xvfs_find_file(const char* path, XVFS_FileEntry* out_entry) {
     char name[17] = {0};
 
@@ -497,6 +564,7 @@ bool xvfs_create_file(const char* fullpath, const uint8_t* data, uint32_t size)
 
     // ───── 디렉터리 엔트리 저장 ─────
     write_block(dir_block, buf);
+    dcache_invalidate_entry(xvfs_drive, dir_block, name, false);
 
     kprintf("xvfs: created '%s' in dir=%u (%u bytes)\n", name, dir_block, size);
     return true;
@@ -564,6 +632,97 @@ bool xvfs_write_file(const char* fullpath, const uint8_t* data, uint32_t size) {
     return true;
 }
 
+static bool xvfs_block_used(uint32_t block) {
+    uint8_t bitbuf[512];
+    uint32_t bits_per_block = 512 * 8;
+    uint32_t bit_index = block % bits_per_block;
+    if (!ata_read_sector(xvfs_drive, xvfs_base_lba + sb.bitmap_start + block / bits_per_block, bitbuf))
+        return true;
+    return (bitbuf[bit_index / 8] & (1 << (bit_index % 8))) != 0;
+}
+
+// offset부터 size바이트만 씀. 파일은 연속 블록이므로 끝을 넘으면 바로 뒤 블록이
+// 비어 있을 때만 늘릴 수 있음. 이전 끝과 offset 사이의 구멍은 0으로 채움
+bool xvfs_write_at(const char* fullpath, uint32_t offset, const uint8_t* data, uint32_t size) {
+    uint32_t end = offset + size;
+    if (!fullpath || (!data && size > 0) || end < offset)
+        return false;
+
+    uint8_t buf[512];
+    char name[17] = {0};
+    uint32_t dir_block = xvfs_resolve_path(fullpath, false, name);
+    if (!dir_block) {
+        kprintf("xvfs: invalid path: %s\n", fullpath);
+        return false;
+    }
+
+    XVFS_FileEntry* target = NULL;
+    for (int pass = 0; pass < 2 && !target; pass++) {
+        if (pass == 1 && !xvfs_create_file(fullpath, NULL, 0))
+            return false;
+        read_block(dir_block, buf);
+        XVFS_FileEntry* e = (XVFS_FileEntry*)buf;
+        for (size_t i = 0; i < 512 / sizeof(XVFS_FileEntry); i++) {
+            if ((uint8_t)e[i].name[0] == 0x00 || (uint8_t)e[i].name[0] == 0xE5)
+                continue;
+            if (strncmp(e[i].name, name, XVFS_MAX_NAME) == 0) {
+                target = &e[i];
+                break;
+            }
+        }
+    }
+    if (!target || (target->attr & 1))
+        return false;
+    if (size == 0)
+        return true;
+
+    // 새로 필요한 블록이 다른 파일 것이면 옮길 수 없으므로 실패
+    uint32_t have = target->size ? (target->size + 511) / 512 : 1;
+    uint32_t need = (end + 511) / 512;
+    for (uint32_t b = have; b < need; b++) {
+        uint32_t blk = target->start + b;
+        if (blk >= sb.total_blocks || xvfs_block_used(blk)) {
+            kprintf("xvfs: no room to grow '%s'\n", name);
+            return false;
+        }
+    }
+    for (uint32_t b = have; b < need; b++)
+        xvfs_mark_block(target->start + b, true);
+
+    uint8_t tmp[512];
+    uint32_t pos = offset < target->size ? offset : target->size;
+    while (pos < end) {
+        uint32_t lba = xvfs_base_lba + target->start + pos / 512;
+        uint32_t in = pos % 512;
+        if (in == 0 && pos >= offset && end - pos >= 512) {
+            uint32_t n = (end - pos) / 512;
+            if (n > 256)
+                n = 256;
+            ata_write(xvfs_drive, lba, (uint16_t)n, data + (pos - offset));
+            pos += n * 512;
+            continue;
+        }
+        uint32_t chunk = 512 - in;
+        if (chunk > end - pos)
+            chunk = end - pos;
+        uint32_t gap = 0;
+        if (pos < offset)
+            gap = (offset - pos < chunk) ? offset - pos : chunk;
+        ata_read_sector(xvfs_drive, lba, tmp);
+        memset(tmp + in, 0, gap);
+        if (chunk > gap)
+            memcpy(tmp + in + gap, data + (pos + gap - offset), chunk - gap);
+        ata_write_sector(xvfs_drive, lba, tmp);
+        pos += chunk;
+    }
+
+    if (end > target->size) {
+        target->size = end;
+        write_block(dir_block, buf);
+    }
+    return true;
+}
+
 bool xvfs_rm(const char* path) {
     char name[17] = {0};
     uint32_t dir_block = xvfs_resolve_path(path, false, name);
@@ -612,6 +771,7 @@ bool xvfs_rm(const char* path) {
     memset(&entry[found], 0, sizeof(XVFS_FileEntry));
     entry[found].name[0] = 0xE5;
     write_block(dir_block, buf);
+    dcache_invalidate_entry(xvfs_drive, dir_block, name, false);
 
     kprintf("xvfs: deleted '%s' (%u blocks freed)\n", path, file_blocks);
     return true;
@@ -760,6 +920,31 @@ bool xvfs_mv(const char* src_path, const char* dst_path) {
     return true;
 }
 
+// 디렉터리 블록에서 이름 하나를 찾고 결과를 dcache에 보관
+static bool xvfs_lookup_cached(uint32_t dir_block, const char* name, bool* out_is_dir, uint32_t* out_start) {
+    uint8_t type = DCACHE_NEGATIVE;
+    uint32_t node = 0;
+    if (!dcache_lookup(xvfs_drive, dir_block, name, false, &type, &node)) {
+        uint8_t buf[512];
+        if (!read_block(dir_block, buf))
+            return false;
+        XVFS_FileEntry* entry = (XVFS_FileEntry*)buf;
+        for (size_t i = 0; i < 512 / sizeof(XVFS_FileEntry); i++) {
+            if ((uint8_t)entry[i].name[0] == 0x00 || (uint8_t)entry[i].name[0] == 0xE5)
+                continue;
+            if (strncmp(entry[i].name, name, XVFS_MAX_NAME) == 0) {
+                type = (entry[i].attr & 1) ? DCACHE_DIR : DCACHE_FILE;
+                node = entry[i].start;
+                break;
+            }
+        }
+        dcache_insert(xvfs_drive, dir_block, name, false, type, node);
+    }
+    *out_is_dir = (type == DCACHE_DIR);
+    *out_start = node;
+    return type != DCACHE_NEGATIVE;
+}
+
 static uint32_t xvfs_resolve_path(const char* path, bool want_dir, char* out_name) {
     // want_dir = true  → 마지막 토큰이 디렉토리여야 함 (cd, ls 등)
     // want_dir = false → 마지막 토큰은 파일로 간주 (create, cat, rm 등)
@@ -779,41 +964,26 @@ static uint32_t xvfs_resolve_path(const char* path, bool want_dir, char* out_nam
         strcpy(last_token, token);
         next = strtok(NULL, "/");
 
-        uint8_t buf[512];
-        read_block(dir_block, buf);
-        XVFS_FileEntry* entry = (XVFS_FileEntry*)buf;
-
-        bool found = false;
-        for (size_t i = 0; i < 512 / sizeof(XVFS_FileEntry); i++) {
-            if ((uint8_t)entry[i].name[0] == 0x00 || (uint8_t)entry[i].name[0] == 0xE5)
-                continue;
-
-            if (strncmp(entry[i].name, token, XVFS_MAX_NAME) == 0) {
-                if (next != NULL) {
-                    // 중간 경로는 반드시 디렉토리
-                    if (!(entry[i].attr & 1))
-                        return 0;
-                    dir_block = entry[i].start;
-                    found = true;
-                } else {
-                    // 마지막 토큰
-                    if (want_dir) {
-                        // cd, ls, mkdir — 디렉토리만 허용
-                        if (entry[i].attr & 1) {
-                            dir_block = entry[i].start;
-                            found = true;
-                        } else {
-                            return 0; // 마지막이 파일인데 디렉토리 요구
-                        }
-                    } else {
-                        // cat, write, rm — 부모 디렉토리까지만 반환
-                        // out_name에 파일 이름만 남기고 종료
-                        if (out_name)
-                            strncpy(out_name, token, 16);
-                        return dir_block;
-                    }
-                }
-                break;
+        bool is_dir = false;
+        uint32_t start = 0;
+        bool found = xvfs_lookup_cached(dir_block, token, &is_dir, &start);
+        if (found) {
+            if (next != NULL) {
+                // 중간 경로는 반드시 디렉토리
+                if (!is_dir)
+                    return 0;
+                dir_block = start;
+            } else if (want_dir) {
+                // 마지막 토큰: cd, ls, mkdir — 디렉토리만 허용
+                if (!is_dir)
+                    return 0; // 마지막이 파일인데 디렉토리 요구
+                dir_block = start;
+            } else {
+                // cat, write, rm — 부모 디렉토리까지만 반환
+                // out_name에 파일 이름만 남기고 종료
+                if (out_name)
+                    strncpy(out_name, token, 16);
+                return dir_block;
             }
         }
 
@@ -902,6 +1072,7 @@ static bool xvfs_create_dir_at(uint32_t parent_block, const char* name) {
         kprint("xvfs: failed to update parent directory\n");
         return false;
     }
+    dcache_invalidate_entry(xvfs_drive, parent_block, name, false);
 
     kprintf("xvfs: directory '%s' created at block %u (parent=%u)\n",
             name, dir_block, parent_block);
@@ -1014,6 +1185,8 @@ bool xvfs_rmdir(const char* path) {
     memset(&entry[found], 0, sizeof(XVFS_FileEntry));
     entry[found].name[0] = 0xE5;
     write_block(parent_block, buf);
+    dcache_invalidate_entry(xvfs_drive, parent_block, name, false);
+    dcache_invalidate_children(xvfs_drive, dir_block);
 
     kprintf("xvfs: directory '%s' removed\n", name);
     return true;
@@ -29,12 +29,24 @@ typedef struct {
     uint8_t attr; // 0 = file, 1 = dir
 } __attribute__((packed)) XVFS_FileEntry;
 
+// 마운트 테이블이 볼륨마다 보관하는 드라이버 상태
+typedef struct {
+    XVFS_Superblock sb;
+    uint32_t base_lba;
+    uint32_t current_dir_block;
+    uint32_t root_block;
+    uint8_t drive;
+} XVFS_VolumeState;
+
 bool xvfs_init(uint8_t drive, uint32_t base_lba);
+void xvfs_save_state(XVFS_VolumeState* out);
+void xvfs_load_state(const XVFS_VolumeState* in);
 void xvfs_ls(const char* path);
 bool xvfs_find_entry(const char* path, XVFS_FileEntry* out_entry);
 bool xvfs_find_file(const char* path, XVFS_FileEntry* out_entry);
 bool xvfs_is_dir(const char* path);
 int xvfs_read_dir_entries(const char* path, XVFS_FileEntry* out_entries, uint32_t max_entries);
+int xvfs_getdents(const char* path, uint32_t* cookie, uint8_t* buf, uint32_t len);
 void xvfs_cat(const char* filename);
 bool xvfs_rm(const char* filename);
 bool xvfs_exists(const char* filename);
@@ -55,6 +67,7 @@ bool xvfs_rmdir(const char* path);
 
 bool xvfs_create_file(const char* name, const uint8_t* data, uint32_t size);
 bool xvfs_write_file(const char* name, const uint8_t* data, uint32_t size);
+bool xvfs_write_at(const char* path, uint32_t offset, const uint8_t* data, uint32_t size);
 bool xvfs_format_at(uint8_t drive, uint32_t base_lba, uint32_t total_sectors);
 bool xvfs_format(uint8_t drive);
 
@@ -9,6 +9,7 @@
 #include "../fs/fscmd.h"
 #include "../mm/mem.h"
 #include "../mm/paging.h"
+#include "../mm/vma.h"
 #include "../cpu/tss.h"
 #include "../libc/string.h"
 
@@ -37,14 +38,19 @@ static void log_user_mappings(const char* tag, process_t* p) {
         return;
     }
     uint32_t phys = 0;
-    bool miss_entry = (p->entry && vmm_virt_to_phys(p->entry, &phys) != 0);
+    // 이미지 페이지는 처음 접근할 때 채워지므로 영역에 들어 있으면 정상
+    bool miss_entry = (p->entry && vmm_virt_to_phys(p->entry, &phys) != 0 &&
+                       !vma_contains(p->entry));
     bool miss_load = false;
     bool miss_stack = false;
     if (p->image_load_base && p->image_load_base != p->entry) {
-        miss_load = (vmm_virt_to_phys(p->image_load_base, &phys) != 0);
+        miss_load = (vmm_virt_to_phys(p->image_load_base, &phys) != 0 &&
+                     !vma_contains(p->image_load_base));
     }
+    // 스택은 맨 위 페이지만 늘 매핑되어 있음
+    uint32_t stack_top_page = p->stack_base + p->stack_size - PAGE_SIZE;
     if (p->stack_base) {
-        miss_stack = (vmm_virt_to_phys(p->stack_base, &phys) != 0);
+        miss_stack = (vmm_virt_to_phys(stack_top_page, &phys) != 0);
     }
     if (!miss_entry && !miss_load && !miss_stack) {
         return;
@@ -64,50 +70,12 @@ static void log_user_mappings(const char* tag, process_t* p) {
         dump_mapping(p->image_load_base);
     }
     if (miss_stack) {
-        dump_mapping(p->stack_base);
+        dump_mapping(stack_top_page);
     }
 }
 
-static void ensure_user_mappings(process_t* p) {
-    if (!p || p->is_kernel || !p->page_dir || p->page_dir_phys == 0) {
-        return;
-    }
-
-    uint32_t irq_flags = irq_save();
-    paging_set_current_dir((uint32_t*)p->page_dir, p->page_dir_phys);
-
-    if (p->image_base && p->image_size && p->image_load_base) {
-        for (uint32_t off = 0; off < p->image_size; off += PAGE_SIZE) {
-            uint32_t phys = 0;
-            if (vmm_virt_to_phys(p->image_base + off, &phys) != 0) {
-                kprintf("user map: image phys lookup failed (%08x)\n",
-                        p->image_base + off);
-                break;
-            }
-            vmm_map_page(p->image_load_base + off, phys,
-                         PAGE_PRESENT | PAGE_RW | PAGE_USER);
-        }
-    }
-
-    if (p->stack_kern_base && p->stack_size && p->stack_base) {
-        for (uint32_t off = 0; off < p->stack_size; off += PAGE_SIZE) {
-            uint32_t phys = 0;
-            if (vmm_virt_to_phys(p->stack_kern_base + off, &phys) != 0) {
-                kprintf("user map: stack phys lookup failed (%08x)\n",
-                        p->stack_kern_base + off);
-                break;
-            }
-            vmm_map_page(p->stack_base + off, phys,
-                         PAGE_PRESENT | PAGE_RW | PAGE_USER);
-        }
-    }
-    irq_restore(irq_flags);
-}
-
 __attribute__((noreturn, used)) static void enter_user_process_c(process_t* p) {
-    log_user_mappings("pre", p);
-    ensure_user_mappings(p);
-    log_user_mappings("post", p);
+    log_user_mappings("enter", p);
     tss_set_kernel_stack(p->kstack_base + p->kstack_size);
     proc_start(p->context_esp);
 }
@@ -161,20 +129,18 @@ bool load_bin(const char* path, uint32_t* phys_entry, uint32_t* out_size) {
     return true;
 }
 
-bool bin_load_image(const char* path, uint32_t* out_entry, uint32_t* out_image_base,
+bool bin_load_image(const char* path, uint32_t* out_entry,
                     uint32_t* out_image_size, uint32_t* out_load_base) {
-    if (!path || !out_entry || !out_image_base || !out_image_size) {
+    if (!path || !out_entry || !out_image_size) {
         return false;
     }
 
     uint32_t entry = 0;
-    uint32_t image_base = 0;
     uint32_t image_size = 0;
     bool is_elf = false;
 
-    if (elf_load_image(path, &entry, &image_base, &image_size, out_load_base, &is_elf)) {
+    if (elf_load_image(path, &entry, &image_size, out_load_base, &is_elf)) {
         *out_entry = entry;
-        *out_image_base = image_base;
         *out_image_size = image_size;
         return true;
     }
@@ -199,21 +165,16 @@ bool bin_load_image(const char* path, uint32_t* out_entry, uint32_t* out_image_b
     memcpy(virt_entry, (void*)phys_entry, bin_size);
 
     uint32_t load_base = BIN_LOAD_ADDR;
-    uint32_t irq_flags = irq_save();
-    for (uint32_t off = 0; off < alloc_size; off += PAGE_SIZE) {
-        uint32_t phys = 0;
-        if (vmm_virt_to_phys((uint32_t)virt_entry + off, &phys) != 0) {
-            kprint("BIN image phys lookup failed\n");
-            irq_restore(irq_flags);
-            kfree(virt_entry);
-            return false;
-        }
-        vmm_map_page(load_base + off, phys, PAGE_PRESENT | PAGE_RW | PAGE_USER);
+    if (vmm_map_user_copy(load_base, virt_entry, alloc_size,
+                          PAGE_PRESENT | PAGE_RW | PAGE_USER) != 0) {
+        kprint("BIN image map failed\n");
+        vmm_unmap_user_range(load_base, load_base + alloc_size);
+        kfree(virt_entry);
+        return false;
     }
-    irq_restore(irq_flags);
+    kfree(virt_entry);
 
     *out_entry = load_base;
-    *out_image_base = (uint32_t)virt_entry;
     *out_image_size = alloc_size;
     if (out_load_base) {
         *out_load_base = load_base;
@@ -264,7 +225,6 @@ __attribute__((naked)) void bin_exit_trampoline(void) {
 // ======================================================
 bool start_init(void) {
     uint32_t entry = 0;
-    uint32_t image_base = 0;
     uint32_t image_size = 0;
     uint32_t image_load_base = 0;
     bool is_elf = false;
@@ -282,7 +242,7 @@ bool start_init(void) {
     uint32_t prev_phys = paging_current_dir_phys();
     paging_set_current_dir((uint32_t*)init_proc->page_dir, init_proc->page_dir_phys);
 
-    if (elf_load_image("/system/core/init.sys", &entry, &image_base, &image_size,
+    if (elf_load_image("/system/core/init.sys", &entry, &image_size,
                        &image_load_base, &is_elf)) {
         kprintf("[init.sys] Loaded ELF entry %x\n", entry);
     } else if (is_elf) {
@@ -325,39 +285,29 @@ bool start_init(void) {
                 (uint32_t)virt_entry, bin_size);
 
         uint32_t load_base = BIN_LOAD_ADDR;
-        uint32_t irq_flags = irq_save();
-        for (uint32_t off = 0; off < alloc_size; off += PAGE_SIZE) {
-            uint32_t phys = 0;
-            if (vmm_virt_to_phys((uint32_t)virt_entry + off, &phys) != 0) {
-                kprint("[init.sys] image phys lookup failed\n");
-                irq_restore(irq_flags);
-                kfree(virt_entry);
+        int rc = vmm_map_user_copy(load_base, virt_entry, alloc_size,
+                                   PAGE_PRESENT | PAGE_RW | PAGE_USER);
+        kfree(virt_entry);
+        if (rc != 0) {
+            kprint("[init.sys] image map failed\n");
             paging_set_current_dir(prev_dir, prev_phys);
             irq_restore(irq_flags);
             proc_cleanup_process(init_proc);
             return false;
         }
-            vmm_map_page(load_base + off, phys, PAGE_PRESENT | PAGE_RW | PAGE_USER);
-        }
-        irq_restore(irq_flags);
 
         entry = load_base;
-        image_base = (uint32_t)virt_entry;
         image_size = alloc_size;
         image_load_base = load_base;
     }
 
     if (!proc_build_user_frame(init_proc, entry, NULL, 0)) {
-        if (image_base) {
-            kfree((void*)image_base);
-        }
         paging_set_current_dir(prev_dir, prev_phys);
         irq_restore(irq_flags);
         proc_cleanup_process(init_proc);
         return false;
     }
 
-    init_proc->image_base = image_base;
     init_proc->image_size = image_size;
     init_proc->image_load_base = image_load_base;
     init_proc->entry = entry;
@@ -388,7 +338,6 @@ process_t* bin_create_process(const char* path, const char* const* argv, int arg
     }
 
     uint32_t entry = 0;
-    uint32_t image_base = 0;
     uint32_t image_size = 0;
     uint32_t image_load_base = 0;
     bool is_elf = false;
@@ -398,7 +347,7 @@ process_t* bin_create_process(const char* path, const char* const* argv, int arg
     uint32_t prev_phys = paging_current_dir_phys();
     paging_set_current_dir((uint32_t*)bin_proc->page_dir, bin_proc->page_dir_phys);
 
-    if (elf_load_image(path, &entry, &image_base, &image_size, &image_load_base, &is_elf)) {
+    if (elf_load_image(path, &entry, &image_size, &image_load_base, &is_elf)) {
         kprintf("Executing ELF %s at entry %x\n", path, entry);
     } else if (is_elf) {
         kprintf("ELF load failed: %s\n", path);
@@ -434,38 +383,29 @@ process_t* bin_create_process(const char* path, const char* const* argv, int arg
         kprintf("Executing %s at virt %x\n", path, (uint32_t)virt_entry);
 
         uint32_t load_base = BIN_LOAD_ADDR;
-        uint32_t irq_flags = irq_save();
-        for (uint32_t off = 0; off < alloc_size; off += PAGE_SIZE) {
-            uint32_t phys = 0;
-            if (vmm_virt_to_phys((uint32_t)virt_entry + off, &phys) != 0) {
-                kprint("BIN image phys lookup failed\n");
-                irq_restore(irq_flags);
-                kfree(virt_entry);
-                paging_set_current_dir(prev_dir, prev_phys);
-                proc_cleanup_process(bin_proc);
-                return NULL;
-            }
-            vmm_map_page(load_base + off, phys, PAGE_PRESENT | PAGE_RW | PAGE_USER);
+        int rc = vmm_map_user_copy(load_base, virt_entry, alloc_size,
+                                   PAGE_PRESENT | PAGE_RW | PAGE_USER);
+        kfree(virt_entry);
+        if (rc != 0) {
+            kprint("BIN image map failed\n");
+            paging_set_current_dir(prev_dir, prev_phys);
+            irq_restore(irq_flags);
+            proc_cleanup_process(bin_proc);
+            return NULL;
         }
-        irq_restore(irq_flags);
 
         entry = load_base;
-        image_base = (uint32_t)virt_entry;
         image_size = alloc_size;
         image_load_base = load_base;
     }
 
     if (!proc_build_user_frame(bin_proc, entry, use_argv, use_argc)) {
-        if (image_base) {
-            kfree((void*)image_base);
-        }
         paging_set_current_dir(prev_dir, prev_phys);
         irq_restore(irq_flags);
         proc_cleanup_process(bin_proc);
         return NULL;
     }
 
-    bin_proc->image_base = image_base;
     bin_proc->image_size = image_size;
     bin_proc->image_load_base = image_load_base;
     bin_proc->entry = entry;
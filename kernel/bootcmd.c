@@ -53,9 +53,8 @@ static bool map_framebuffer_range(uint64_t addr, uint64_t size) {
     else
         flags |= PAGE_PCD;
 
-    for (uint32_t p = start; p < end_aligned; p += PAGE_SIZE)
-        vmm_map_page(p, p, flags);
-
+    // 4MB 정렬이 맞는 부분은 큰 페이지 (PAT WC는 PDE의 PAT 비트로 옮겨짐)
+    vmm_map_range(start, start, end_aligned - start, flags);
     return true;
 }
 
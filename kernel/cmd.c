@@ -6,6 +6,7 @@
 #include "../drivers/keyboard.h"
 #include "../drivers/spk.h"
 #include "../drivers/ata.h"
+#include "../drivers/blkcache.h"
 #include "../drivers/pci.h"
 #include "../drivers/hal.h"
 #include "../drivers/ac97.h"
@@ -24,6 +25,9 @@
 #include "run.h"
 #include "../libc/string.h"
 #include "../mm/mem.h"
+#include "../mm/slab.h"
+#include "../mm/kmprof.h"
+#include "../mm/pmm.h"
 #include "../fs/fat16.h"
 #include "../fs/fat32.h"
 #include "../fs/xvfs.h"
@@ -31,6 +35,7 @@
 #include "../fs/note.h"
 #include "../fs/disk.h"
 #include "../fs/fsbg.h"
+#include "../fs/mount.h"
 #include "../fs/fs_quick.h"
 #include "../mm/paging.h"
 #include "cmd.h"
@@ -642,6 +647,9 @@ void cmd_time() {
 
 //reboot,off
 void reboot() {
+    // 캐시에 남은 섹터를 먼저 디스크로
+    blkcache_sync_all();
+
     // PIC 마스크 걸고 인터럽트 막음
     asm volatile("cli");
 
@@ -657,6 +665,7 @@ void reboot() {
 void fs_unmount_all(void) {
     current_drive = -1;
     current_fs = FS_NONE;
+    mount_unmount_all();
 
     fat16_drive = -1;
     fat32_drive = -1;
@@ -693,62 +702,28 @@ void m_disk(const char* cmd) {
         }
 
         const char* type = disks[d].fs_type;
-        uint32_t base = disks[d].base_lba;
         if (strcmp(type, "Unknown") == 0 || strcmp(type, "MBR") == 0) {
             refresh_disk_kind(d);
             type = disks[d].fs_type;
-            base = disks[d].base_lba;
-        }
-
-        // ───── FAT16 ─────
-        if (strcmp(type, "FAT16") == 0) {
-            if (fat16_init(d, base)) {
-                fat16_drive = d;
-                current_drive = d;
-                current_fs = FS_FAT16;
-
-                fscmd_reset_path();
-
-                kprintf("Drive %d mounted successfully as FAT16.\n", d);
-            } else {
-                kprintf("Failed to mount drive %d (FAT16 init error)\n", d);
-            }
-        }
-
-        // ───── FAT32 ─────
-        else if (strcmp(type, "FAT32") == 0) {
-            if (fat32_init(d, base)) {
-                fat32_drive = d;
-                current_drive = d;
-                current_fs = FS_FAT32;
-
-                fscmd_reset_path();
-
-                kprintf("Drive %d mounted successfully as FAT32.\n", d);
-            } else {
-                kprintf("Failed to mount drive %d (FAT32 init error)\n", d);
-            }
         }
 
-        // ───── XVFS ─────
-        else if (strcmp(type, "XVFS") == 0) {
-            if (xvfs_init(d, base)) {
-                xvfs_drive = d;
-                current_drive = d;
-                current_fs = FS_XVFS;
-
-                fscmd_reset_path();
-
-                kprintf("Drive %d mounted successfully as XVFS.\n", d);
-            } else {
-                kprintf("Failed to mount drive %d (XVFS init error)\n", d);
-            }
+        if (strcmp(type, "FAT16") != 0 && strcmp(type, "FAT32") != 0 &&
+            strcmp(type, "XVFS") != 0) {
+            kprintf("Drive %d: Unsupported filesystem (%s)\n", d, type);
+            return;
         }
 
-        else {
-            kprintf("Drive %d: Unsupported filesystem (%s)\n", d, type);
+        // 이미 마운트된 볼륨이면 부트 섹터를 다시 읽지 않고 전환만 함
+        mount_t* m = mount_volume(d);
+        if (!m) {
+            kprintf("Failed to mount drive %d (%s init error)\n", d, type);
+            return;
         }
 
+        current_drive = d;
+        current_fs = m->fs;
+        fscmd_reset_path();
+        kprintf("Drive %d mounted successfully as %s (%s).\n", d, type, m->prefix);
         return;
     }
 
@@ -767,49 +742,27 @@ void m_disk_num(int disk) {
     }
 
     const char* type = disks[disk].fs_type;
-    uint32_t base = disks[disk].base_lba;
 
     if (strcmp(type, "Unknown") == 0 || strcmp(type, "MBR") == 0) {
         refresh_disk_kind(disk);
         type = disks[disk].fs_type;
-        base = disks[disk].base_lba;
     }
 
-    bool mounted = false;
-
-    if (strcmp(type, "FAT16") == 0) {
-        mounted = fat16_init(disk, base);
-        if (mounted) {
-            fat16_drive = disk;
-            current_fs = FS_FAT16;
-        }
-    }
-    else if (strcmp(type, "FAT32") == 0) {
-        mounted = fat32_init(disk, base);
-        if (mounted) {
-            fat32_drive = disk;
-            current_fs = FS_FAT32;
-        }
-    }
-    else if (strcmp(type, "XVFS") == 0) {
-        mounted = xvfs_init(disk, base);
-        if (mounted) {
-            xvfs_drive = disk;
-            current_fs = FS_XVFS;
-        }
-    }
-    else {
+    if (strcmp(type, "FAT16") != 0 && strcmp(type, "FAT32") != 0 &&
+        strcmp(type, "XVFS") != 0) {
         kprintf("Drive %d: Unsupported filesystem (%s)\n", disk, type);
         return;
     }
 
-    if (!mounted) {
+    mount_t* m = mount_volume(disk);
+    if (!m) {
         kprintf("Failed to mount drive %d (%s init error)\n", disk, type);
         return;
     }
 
     // ✅ 여기서만 전역 상태 변경
     current_drive = disk;
+    current_fs = m->fs;
     fscmd_reset_path();
     kprintf("Drive %d mounted successfully as %s.\n", disk, type);
 }
@@ -2210,6 +2163,10 @@ static bool dispatch_help(const char *orig_cmd, char *cmd, bool *out_success) {
     kprint("  cp <src> <dst>       - copy a file\n");
     kprint("  pc                   - Show CPU vendor & brand\n");
     kprint("  ps                   - List processes\n");
+    kprint("  heapstat             - Show kernel heap usage and fragmentation\n");
+    kprint("  heapstat hw <KB>     - Return free heap pages above this size\n");
+    kprint("  slabinfo             - Show slab allocator caches\n");
+    kprint("  kmprof [on|off|<N>]  - Profile kmalloc call sites, show top N\n");
     kprint("  kill [-f] <pid>      - Terminate process by pid (kernel with -f)\n");
     kprint("  fg <pid>             - Bring background process to foreground\n");
     kprint("  ver                  - Show orionOS version\n");
@@ -2240,8 +2197,10 @@ static bool dispatch_help(const char *orig_cmd, char *cmd, bool *out_success) {
     kprint("  klog                 - Show kernel log\n");
     kprint("  bootlog              - Prints the log output during booting\n");
     kprint("  df                   - Show disk free space\n");
+    kprint("  sync                 - Write cached disk sectors back now\n");
     kprint("  disk                 - mount disk\n");
     kprint("  disk ls              - list disk\n");
+    kprint("  mount                - List mounted volumes (/d<N>, /usb<N> prefixes)\n");
     kprint("  diskscan             - Rescan disk drives\n");
     kprint("  usbscan              - Rescan USB ports\n");
     kprint("  svrd <drive#>/<file> - Save ramdisk image to file\n");
@@ -2740,6 +2699,16 @@ static bool dispatch_disk(const char *orig_cmd, char *cmd, bool *out_success) {
     return true;
 }
 
+static bool dispatch_mount(const char *orig_cmd, char *cmd, bool *out_success) {
+    (void)orig_cmd;
+    if (strcmp(cmd, "mount") != 0)
+        return false;
+
+    mount_list();
+    *out_success = true;
+    return true;
+}
+
 static bool dispatch_cwd(const char *orig_cmd, char *cmd, bool *out_success) {
     (void)orig_cmd;
     if (strcmp(cmd, "cwd") != 0)
@@ -2789,6 +2758,7 @@ static bool dispatch_poweroff(const char *orig_cmd, char *cmd, bool *out_success
     if (strcmp(cmd, "poweroff") != 0)
         return false;
 
+    blkcache_sync_all();
     clear_screen();
     hal_wbinvd();
     asm volatile ("cli");
@@ -2798,6 +2768,166 @@ static bool dispatch_poweroff(const char *orig_cmd, char *cmd, bool *out_success
     return true;
 }
 
+static bool dispatch_sync(const char *orig_cmd, char *cmd, bool *out_success) {
+    (void)orig_cmd;
+    if (strcmp(cmd, "sync") != 0)
+        return false;
+
+    blkcache_stats_t before;
+    blkcache_stats_t after;
+    blkcache_get_stats(&before);
+    bool ok = blkcache_sync_all();
+    blkcache_get_stats(&after);
+    kprintf("sync: %u sectors written in %u requests%s\n",
+            after.writebacks - before.writebacks, after.flushes - before.flushes,
+            ok ? "" : " (some writes failed)");
+    kprintf("  cache: %u sectors, %u dirty, hits %u, misses %u\n",
+            after.cached, after.dirty, after.hits, after.misses);
+    *out_success = ok;
+    return true;
+}
+
+static bool dispatch_heapstat(const char *orig_cmd, char *cmd, bool *out_success) {
+    (void)orig_cmd;
+    if (strncmp(cmd, "heapstat", 8) != 0 || (cmd[8] != '\0' && cmd[8] != ' '))
+        return false;
+
+    if (cmd[8] == ' ') {
+        if (strncmp(cmd + 9, "hw ", 3) != 0) {
+            kprint("Usage: heapstat [hw <KB>]\n");
+            *out_success = false;
+            return true;
+        }
+        int kb = atoi(cmd + 12);
+        if (kb < 0) {
+            kprint("Usage: heapstat [hw <KB>]\n");
+            *out_success = false;
+            return true;
+        }
+        kheap_set_high_water((uint32_t)kb * 1024u);
+        kprintf("heap high-water mark %u KB\n", (uint32_t)kb);
+        *out_success = true;
+        return true;
+    }
+
+    kheap_stats_t st;
+    kheap_get_stats(&st);
+    // 단편화: 빈 공간 중 가장 큰 블록 하나로 쓸 수 없는 비율
+    uint32_t frag = 0;
+    if (st.free_bytes >= 16u)
+        frag = 100u - (st.largest_free / 16u) * 100u / (st.free_bytes / 16u);
+
+    kprintf("heap [%08X - %08X) + %u arenas, committed %u KB (high-water %u KB)\n",
+            st.heap_base, st.heap_end, st.arenas - 1u, st.committed / 1024u,
+            st.high_water / 1024u);
+    kprintf("  used : %u KB in %u blocks (peak %u KB)\n", st.used_bytes / 1024u,
+            st.used_blocks, st.peak_used / 1024u);
+    kprintf("  free : %u KB in %u blocks, largest %u KB\n", st.free_bytes / 1024u,
+            st.free_blocks, st.largest_free / 1024u);
+    kprintf("  fragmentation: %u%%\n", frag);
+    for (uint32_t i = 0; i < KHEAP_CLASSES; i++) {
+        if (st.free_by_class[i])
+            kprintf("    >= %8u B : %u free\n", kheap_class_min_size(i), st.free_by_class[i]);
+    }
+
+    kmem_cache_stats_t caches[SLAB_MAX_CACHES];
+    int n = slab_get_stats(caches, SLAB_MAX_CACHES);
+    uint32_t slabs = 0;
+    uint32_t objs = 0;
+    for (int i = 0; i < n; i++) {
+        slabs += caches[i].slabs;
+        objs += caches[i].active;
+    }
+    kprintf("  slab : %u KB in %u pages, %u objects (see slabinfo)\n",
+            slabs * 4u, slabs, objs);
+
+    uint32_t blocks[PMM_MAX_ORDER + 1];
+    pmm_count_free_blocks(blocks);
+    kprintf("phys free %u MB (+%u zeroed pages), contiguous blocks by order:\n",
+            (uint32_t)(pmm_get_free_memory() / 1024u / 1024u), pmm_zero_pool_count());
+    kprint(" ");
+    for (uint32_t i = 0; i <= PMM_MAX_ORDER; i++)
+        kprintf(" %u:%u", i, blocks[i]);
+    kprint("\n");
+    *out_success = true;
+    return true;
+}
+
+static bool dispatch_slabinfo(const char *orig_cmd, char *cmd, bool *out_success) {
+    (void)orig_cmd;
+    if (strcmp(cmd, "slabinfo") != 0)
+        return false;
+
+    kmem_cache_stats_t stats[SLAB_MAX_CACHES];
+    int n = slab_get_stats(stats, SLAB_MAX_CACHES);
+    kprint("cache            size  /slab  active  slabs     allocs\n");
+    for (int i = 0; i < n; i++) {
+        kprintf("%s", stats[i].name);
+        for (int pad = (int)strlen(stats[i].name); pad < 16; pad++)
+            kprint(" ");
+        kprintf("%5u  %5u  %6u  %5u  %9u\n", stats[i].obj_size, stats[i].per_slab,
+                stats[i].active, stats[i].slabs, stats[i].allocs);
+    }
+    *out_success = true;
+    return true;
+}
+
+static bool dispatch_kmprof(const char *orig_cmd, char *cmd, bool *out_success) {
+    (void)orig_cmd;
+    if (strncmp(cmd, "kmprof", 6) != 0 || (cmd[6] != '\0' && cmd[6] != ' '))
+        return false;
+
+    const char* arg = cmd[6] ? cmd + 7 : "";
+    if (strcmp(arg, "on") == 0 || strcmp(arg, "off") == 0) {
+        kmprof_enable(arg[1] == 'n');
+        kprintf("kmalloc profiler %s\n", arg);
+        *out_success = true;
+        return true;
+    }
+    if (strcmp(arg, "reset") == 0) {
+        kmprof_reset();
+        kprint("kmalloc profiler reset\n");
+        *out_success = true;
+        return true;
+    }
+
+    int top = 10;
+    if (*arg) {
+        top = atoi(arg);
+        if (top <= 0) {
+            kprint("Usage: kmprof [on|off|reset|<N>]\n");
+            *out_success = false;
+            return true;
+        }
+    }
+    if (top > 32)
+        top = 32;
+
+    kmprof_summary_t sum;
+    kmprof_summary(&sum);
+    kheap_stats_t st;
+    kheap_get_stats(&st);
+    kprintf("kmprof %s, %u s, %u sites, %u live allocs (%u dropped)\n",
+            sum.enabled ? "on" : "off", sum.seconds, sum.sites, sum.tracked, sum.dropped);
+    kprintf("  live %u KB, peak %u KB; heap peak %u KB, committed %u KB\n",
+            sum.live_bytes / 1024u, sum.peak_live / 1024u, st.peak_used / 1024u,
+            st.committed / 1024u);
+
+    kmprof_site_t sites[32];
+    int n = kmprof_top(sites, top);
+    kprint("site       allocs    /s  live KB  peak KB  <=32 <=128 <=512  <=4K <=64K  more\n");
+    for (int i = 0; i < n; i++) {
+        uint32_t rate = sum.seconds ? sites[i].allocs / sum.seconds : sites[i].allocs;
+        kprintf("%08X %8u %5u %8u %8u", sites[i].site, sites[i].allocs, rate,
+                sites[i].live_bytes / 1024u, sites[i].peak_live / 1024u);
+        for (uint32_t b = 0; b < KMPROF_BUCKETS; b++)
+            kprintf(" %5u", sites[i].hist[b]);
+        kprint("\n");
+    }
+    *out_success = true;
+    return true;
+}
+
 static bool dispatch_bootlog(const char *orig_cmd, char *cmd, bool *out_success) {
     (void)orig_cmd;
     if (strcmp(cmd, "bootlog") != 0)
@@ -2825,6 +2955,7 @@ static bool dispatch_diskscan(const char *orig_cmd, char *cmd, bool *out_success
 
     kprint("[DISK] refreshing disk list...\n");
     detect_disks_quick();
+    mount_drop_stale();
     cmd_disk_ls();
     *out_success = true;
     return true;
@@ -2841,6 +2972,9 @@ static bool dispatch_usbscan(const char *orig_cmd, char *cmd, bool *out_success)
         current_fs = FS_NONE;
         fscmd_reset_path();
     }
+    for (int d = USB_DRIVE_BASE; d < MAX_DISKS; d++) {
+        mount_unmount(d);
+    }
 
     (void)ehci_take_rescan_pending();
     (void)ohci_take_rescan_pending();
@@ -3043,11 +3177,16 @@ bool execute_single_command(const char *orig_cmd, char *cmd) {
         {dispatch_font},
         {dispatch_hangul},
         {dispatch_disk},
+        {dispatch_mount},
         {dispatch_cwd},
         {dispatch_uptime},
         {dispatch_time},
         {dispatch_reboot},
         {dispatch_poweroff},
+        {dispatch_sync},
+        {dispatch_heapstat},
+        {dispatch_slabinfo},
+        {dispatch_kmprof},
         {dispatch_bootlog},
         {dispatch_klog},
         {dispatch_diskscan},
@@ -1,7 +1,9 @@
 #include "elf.h"
 #include "../fs/fscmd.h"
+#include "../fs/pagecache.h"
 #include "../mm/mem.h"
 #include "../mm/paging.h"
+#include "../mm/vma.h"
 #include "../drivers/screen.h"
 #include "../libc/string.h"
 
@@ -47,6 +49,7 @@
 
 #define ELF_USER_VADDR_MIN 0x08000000u
 #define ELF_USER_VADDR_MAX 0xBFFFFFFFu
+#define ELF_MAX_SEGMENTS 8
 #define EFLAGS_IF 0x200u
 
 static inline uint32_t irq_save(void) {
@@ -111,6 +114,32 @@ typedef struct __attribute__((packed)) {
     uint16_t st_shndx;
 } Elf32_Sym;
 
+typedef struct {
+    uint32_t vaddr;         // 적재 주소 기준
+    uint32_t offset;
+    uint32_t filesz;        // 이 뒤로 memsz까지는 BSS
+} elf_seg_t;
+
+typedef struct {
+    uint32_t addr;
+    uint32_t type;
+    uint32_t sym;           // 심볼 재배치면 풀어 둔 심볼 값
+} elf_reloc_t;
+
+// 이미지 영역이 참조하는 적재 정보. fork한 자식도 같은 것을 공유
+typedef struct {
+    uint32_t refs;
+    int deny_slot;          // 이미지가 살아 있는 동안 파일 쓰기/삭제를 막는 pagecache 표 번호
+    char path[PAGECACHE_PATH_MAX];
+    uint32_t load_bias;
+    uint32_t start;
+    uint32_t end;
+    uint32_t seg_count;
+    elf_seg_t segs[ELF_MAX_SEGMENTS];
+    uint32_t reloc_count;
+    elf_reloc_t* relocs;    // 주소순
+} elf_image_t;
+
 static uint32_t align_up(uint32_t val, uint32_t align) {
     return (val + align - 1u) & ~(align - 1u);
 }
@@ -136,39 +165,6 @@ static uint32_t choose_pie_base(uint32_t image_size, uint32_t min_base) {
     return base;
 }
 
-static bool read_file_exact(const char* path, uint8_t* dest, uint32_t size) {
-    uint32_t offset = 0;
-    while (offset < size) {
-        uint32_t to_read = size - offset;
-        if (to_read > 1024u) {
-            to_read = 1024u;
-        }
-        if (!fscmd_read_file_partial(path, offset, dest + offset, to_read)) {
-            return false;
-        }
-        offset += to_read;
-    }
-    return true;
-}
-
-static void* elf_image_ptr(uint8_t* image, uint32_t base_vaddr, uint32_t image_size,
-                           uint32_t vaddr, uint32_t size) {
-    if (!image) {
-        return NULL;
-    }
-    if (vaddr < base_vaddr) {
-        return NULL;
-    }
-    uint32_t off = vaddr - base_vaddr;
-    if (off > image_size) {
-        return NULL;
-    }
-    if (size > image_size - off) {
-        return NULL;
-    }
-    return image + off;
-}
-
 static bool elf_ident_ok(const unsigned char* ident) {
     if (!ident) {
         return false;
@@ -184,43 +180,105 @@ static bool elf_ident_ok(const unsigned char* ident) {
     return true;
 }
 
-static bool resolve_symbol(uint8_t* image, uint32_t base_vaddr, uint32_t image_size,
-                           uint32_t load_bias, uint32_t symtab_vaddr,
-                           uint32_t sym_ent, uint32_t sym_index,
-                           uint32_t* out_sym) {
-    if (!out_sym || symtab_vaddr == 0 || sym_ent < sizeof(Elf32_Sym)) {
+static void elf_image_get(void* ctx) {
+    elf_image_t* img = (elf_image_t*)ctx;
+    uint32_t irq = irq_save();
+    img->refs++;
+    irq_restore(irq);
+}
+
+static void elf_image_put(void* ctx) {
+    elf_image_t* img = (elf_image_t*)ctx;
+    uint32_t irq = irq_save();
+    bool last = (--img->refs == 0);
+    irq_restore(irq);
+    if (!last) {
+        return;
+    }
+    pagecache_allow_write(img->deny_slot);
+    if (img->relocs) {
+        kfree(img->relocs);
+    }
+    kfree(img);
+}
+
+// 적재된 주소 기준으로 [vaddr, vaddr+size)의 이미지 내용을 파일에서 읽음 (BSS와 틈은 0)
+static bool elf_read_vaddr(const elf_image_t* img, uint32_t vaddr, void* dst, uint32_t size) {
+    if (vaddr < img->start || vaddr > img->end || size > img->end - vaddr) {
         return false;
     }
-    uint32_t sym_vaddr = symtab_vaddr + sym_index * sym_ent;
-    Elf32_Sym* sym = (Elf32_Sym*)elf_image_ptr(image, base_vaddr, image_size,
-                                               sym_vaddr, sym_ent);
-    if (!sym) {
+    memset(dst, 0, size);
+    uint32_t end = vaddr + size;
+    for (uint32_t i = 0; i < img->seg_count; i++) {
+        const elf_seg_t* seg = &img->segs[i];
+        uint32_t lo = seg->vaddr > vaddr ? seg->vaddr : vaddr;
+        uint32_t hi = seg->vaddr + seg->filesz < end ? seg->vaddr + seg->filesz : end;
+        if (lo >= hi) {
+            continue;
+        }
+        uint32_t len = hi - lo;
+        if (pagecache_read(img->path, seg->offset + (lo - seg->vaddr),
+                           (uint8_t*)dst + (lo - vaddr), len) != (int)len) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool resolve_symbol(const elf_image_t* img, uint32_t symtab, uint32_t sym_ent,
+                           uint32_t sym_index, uint32_t* out_sym) {
+    if (symtab == 0 || sym_ent < sizeof(Elf32_Sym)) {
+        return false;
+    }
+    Elf32_Sym sym;
+    if (!elf_read_vaddr(img, symtab + sym_index * sym_ent, &sym, sizeof(sym))) {
         return false;
     }
-    if (sym->st_shndx == 0) {
+    if (sym.st_shndx == 0) {
         return false;
     }
-    *out_sym = load_bias + sym->st_value;
+    *out_sym = img->load_bias + sym.st_value;
     return true;
 }
 
-static bool apply_relocations(uint8_t* image, uint32_t base_vaddr, uint32_t image_size,
-                              uint32_t load_bias, Elf32_Phdr* phdrs, uint16_t phnum) {
-    Elf32_Phdr* dyn_ph = NULL;
+// 페이지를 채울 때 그 페이지에 걸친 항목만 찾도록 주소순 정렬
+static void sort_relocs(elf_reloc_t* r, uint32_t n) {
+    for (uint32_t gap = n / 2; gap > 0; gap /= 2) {
+        for (uint32_t i = gap; i < n; i++) {
+            elf_reloc_t tmp = r[i];
+            uint32_t j = i;
+            while (j >= gap && r[j - gap].addr > tmp.addr) {
+                r[j] = r[j - gap];
+                j -= gap;
+            }
+            r[j] = tmp;
+        }
+    }
+}
+
+// REL 표를 읽어 심볼 값까지 풀어 둠. 실제 값은 페이지를 채울 때 씀
+static bool collect_relocations(elf_image_t* img, const Elf32_Phdr* phdrs, uint16_t phnum) {
+    const Elf32_Phdr* dyn_ph = NULL;
     for (uint16_t i = 0; i < phnum; i++) {
         if (phdrs[i].p_type == PT_DYNAMIC) {
             dyn_ph = &phdrs[i];
             break;
         }
     }
-    if (!dyn_ph) {
+    if (!dyn_ph || dyn_ph->p_memsz < sizeof(Elf32_Dyn)) {
         return true;
     }
 
-    Elf32_Dyn* dyn = (Elf32_Dyn*)elf_image_ptr(image, base_vaddr, image_size,
-                                               dyn_ph->p_vaddr, dyn_ph->p_memsz);
+    uint32_t dyn_count = dyn_ph->p_memsz / sizeof(Elf32_Dyn);
+    Elf32_Dyn* dyn = (Elf32_Dyn*)kmalloc(dyn_count * sizeof(Elf32_Dyn), 0, NULL);
     if (!dyn) {
+        kprint("[ELF] kmalloc failed\n");
+        return false;
+    }
+    if (!elf_read_vaddr(img, dyn_ph->p_vaddr + img->load_bias, dyn,
+                        dyn_count * sizeof(Elf32_Dyn))) {
         kprint("[ELF] dynamic section out of range\n");
+        kfree(dyn);
         return false;
     }
 
@@ -231,7 +289,6 @@ static bool apply_relocations(uint8_t* image, uint32_t base_vaddr, uint32_t imag
     uint32_t sym_ent = sizeof(Elf32_Sym);
     uint32_t rela_sz = 0;
 
-    uint32_t dyn_count = dyn_ph->p_memsz / sizeof(Elf32_Dyn);
     for (uint32_t i = 0; i < dyn_count; i++) {
         if (dyn[i].d_tag == DT_NULL) {
             break;
@@ -261,6 +318,7 @@ static bool apply_relocations(uint8_t* image, uint32_t base_vaddr, uint32_t imag
                 break;
         }
     }
+    kfree(dyn);
 
     if (rela_sz) {
         kprint("[ELF] RELA relocations not supported\n");
@@ -273,76 +331,143 @@ static bool apply_relocations(uint8_t* image, uint32_t base_vaddr, uint32_t imag
         kprint("[ELF] invalid REL table\n");
         return false;
     }
+    if (symtab_vaddr) {
+        symtab_vaddr += img->load_bias;
+    }
 
-    Elf32_Rel* rel = (Elf32_Rel*)elf_image_ptr(image, base_vaddr, image_size,
-                                               rel_vaddr, rel_sz);
-    if (!rel) {
+    uint32_t rel_count = rel_sz / rel_ent;
+    Elf32_Rel* rel = (Elf32_Rel*)kmalloc(rel_sz, 0, NULL);
+    img->relocs = (elf_reloc_t*)kmalloc(rel_count * sizeof(elf_reloc_t), 0, NULL);
+    if (!rel || !img->relocs) {
+        kprint("[ELF] kmalloc failed\n");
+        if (rel) {
+            kfree(rel);
+        }
+        return false;
+    }
+    if (!elf_read_vaddr(img, rel_vaddr + img->load_bias, rel, rel_sz)) {
         kprint("[ELF] REL table out of range\n");
+        kfree(rel);
         return false;
     }
 
-    uint32_t rel_count = rel_sz / rel_ent;
+    uint32_t n = 0;
     for (uint32_t i = 0; i < rel_count; i++) {
         uint32_t type = ELF32_R_TYPE(rel[i].r_info);
         uint32_t sym_index = ELF32_R_SYM(rel[i].r_info);
-        uint32_t* reloc = (uint32_t*)elf_image_ptr(image, base_vaddr, image_size,
-                                                   rel[i].r_offset, sizeof(uint32_t));
-        if (!reloc) {
+        uint32_t addr = rel[i].r_offset + img->load_bias;
+        if (addr < img->start || addr > img->end - sizeof(uint32_t)) {
             kprint("[ELF] relocation out of range\n");
+            kfree(rel);
             return false;
         }
 
         uint32_t sym_val = 0;
         switch (type) {
             case R_386_NONE:
-                break;
+                continue;
             case R_386_RELATIVE:
-                *reloc += load_bias;
                 break;
             case R_386_32:
-                if (!resolve_symbol(image, base_vaddr, image_size, load_bias,
-                                    symtab_vaddr, sym_ent, sym_index, &sym_val)) {
-                    kprint("[ELF] symbol resolve failed\n");
-                    return false;
-                }
-                *reloc = sym_val + *reloc;
-                break;
             case R_386_PC32:
-                if (!resolve_symbol(image, base_vaddr, image_size, load_bias,
-                                    symtab_vaddr, sym_ent, sym_index, &sym_val)) {
-                    kprint("[ELF] symbol resolve failed\n");
-                    return false;
-                }
-                *reloc = sym_val + *reloc - (load_bias + rel[i].r_offset);
-                break;
             case R_386_GLOB_DAT:
             case R_386_JMP_SLOT:
-                if (!resolve_symbol(image, base_vaddr, image_size, load_bias,
-                                    symtab_vaddr, sym_ent, sym_index, &sym_val)) {
+                if (!resolve_symbol(img, symtab_vaddr, sym_ent, sym_index, &sym_val)) {
                     kprint("[ELF] symbol resolve failed\n");
+                    kfree(rel);
                     return false;
                 }
-                *reloc = sym_val;
                 break;
             default:
                 kprint("[ELF] unsupported relocation type\n");
+                kfree(rel);
                 return false;
         }
+        img->relocs[n].addr = addr;
+        img->relocs[n].type = type;
+        img->relocs[n].sym = sym_val;
+        n++;
     }
+    kfree(rel);
 
+    img->reloc_count = n;
+    sort_relocs(img->relocs, n);
     return true;
 }
 
+static uint32_t relocate_word(const elf_image_t* img, const elf_reloc_t* r, uint32_t word) {
+    switch (r->type) {
+        case R_386_RELATIVE:
+            return word + img->load_bias;
+        case R_386_32:
+            return r->sym + word;
+        case R_386_PC32:
+            return r->sym + word - r->addr;
+        default:
+            return r->sym;
+    }
+}
+
+// 페이지 폴트에서 호출: 파일 내용을 읽고 이 페이지에 걸친 재배치만 적용
+static bool elf_fill_page(void* ctx, uint32_t page_vaddr, uint8_t* dst) {
+    const elf_image_t* img = (const elf_image_t*)ctx;
+    if (!elf_read_vaddr(img, page_vaddr, dst, PAGE_SIZE)) {
+        return false;
+    }
+
+    uint32_t lo = 0;
+    uint32_t hi = img->reloc_count;
+    uint32_t first = page_vaddr > sizeof(uint32_t) ? page_vaddr - (sizeof(uint32_t) - 1u) : 0;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (img->relocs[mid].addr < first) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    uint32_t page_end = page_vaddr + PAGE_SIZE;
+    for (uint32_t i = lo; i < img->reloc_count && img->relocs[i].addr < page_end; i++) {
+        const elf_reloc_t* r = &img->relocs[i];
+        uint32_t word = 0;
+        bool inside = r->addr >= page_vaddr && r->addr + sizeof(uint32_t) <= page_end;
+        if (inside) {
+            memcpy(&word, dst + (r->addr - page_vaddr), sizeof(word));
+        } else if (!elf_read_vaddr(img, r->addr, &word, sizeof(word))) {
+            return false;
+        }
+        word = relocate_word(img, r, word);
+
+        // 페이지 경계에 걸친 항목은 이 페이지에 속한 바이트만 씀
+        const uint8_t* bytes = (const uint8_t*)&word;
+        for (uint32_t b = 0; b < sizeof(word); b++) {
+            uint32_t at = r->addr + b;
+            if (at >= page_vaddr && at < page_end) {
+                dst[at - page_vaddr] = bytes[b];
+            }
+        }
+    }
+    return true;
+}
+
+static const vma_ops_t elf_vma_ops = {
+    .fill = elf_fill_page,
+    .get = elf_image_get,
+    .put = elf_image_put,
+};
+
+// 헤더와 재배치 정보만 읽고 세그먼트는 영역으로 등록. 실제 페이지는 처음 접근할 때
+// 페이지 캐시에서 채우고 BSS는 0 페이지로 시작
 bool elf_load_image(const char* path,
                     uint32_t* out_entry,
-                    uint32_t* out_image_base,
                     uint32_t* out_image_size,
                     uint32_t* out_load_base,
                     bool* out_is_elf) {
     if (out_is_elf) {
         *out_is_elf = false;
     }
-    if (!path || !out_entry || !out_image_base || !out_image_size) {
+    if (!path || !out_entry || !out_image_size) {
         return false;
     }
 
@@ -351,69 +476,74 @@ bool elf_load_image(const char* path,
         return false;
     }
 
-    uint8_t* file = (uint8_t*)kmalloc(size, 0, NULL);
-    if (!file) {
-        kprint("[ELF] kmalloc failed\n");
-        return false;
-    }
-    if (!read_file_exact(path, file, size)) {
+    Elf32_Ehdr eh;
+    if (pagecache_read(path, 0, (uint8_t*)&eh, sizeof(eh)) != (int)sizeof(eh)) {
         kprint("[ELF] read failed\n");
-        kfree(file);
         return false;
     }
-
-    Elf32_Ehdr* eh = (Elf32_Ehdr*)file;
-    if (!elf_ident_ok(eh->e_ident)) {
-        kfree(file);
+    if (!elf_ident_ok(eh.e_ident)) {
         return false;
     }
     if (out_is_elf) {
         *out_is_elf = true;
     }
 
-    if ((eh->e_type != ET_EXEC && eh->e_type != ET_DYN) ||
-        eh->e_machine != EM_386 || eh->e_version != EV_CURRENT) {
+    if ((eh.e_type != ET_EXEC && eh.e_type != ET_DYN) ||
+        eh.e_machine != EM_386 || eh.e_version != EV_CURRENT) {
         kprint("[ELF] unsupported header\n");
-        kfree(file);
         return false;
     }
-    bool is_pie = (eh->e_type == ET_DYN);
+    bool is_pie = (eh.e_type == ET_DYN);
 
-    if (eh->e_phentsize != sizeof(Elf32_Phdr) || eh->e_phnum == 0) {
+    if (eh.e_phentsize != sizeof(Elf32_Phdr) || eh.e_phnum == 0) {
         kprint("[ELF] invalid program header table\n");
-        kfree(file);
         return false;
     }
-    if (eh->e_phoff > size ||
-        eh->e_phoff + (uint32_t)eh->e_phnum * sizeof(Elf32_Phdr) > size) {
+    uint32_t ph_size = (uint32_t)eh.e_phnum * sizeof(Elf32_Phdr);
+    if (eh.e_phoff > size || eh.e_phoff + ph_size > size) {
         kprint("[ELF] program headers out of range\n");
-        kfree(file);
+        return false;
+    }
+
+    Elf32_Phdr* phdrs = (Elf32_Phdr*)kmalloc(ph_size, 0, NULL);
+    if (!phdrs) {
+        kprint("[ELF] kmalloc failed\n");
+        return false;
+    }
+    if (pagecache_read(path, eh.e_phoff, (uint8_t*)phdrs, ph_size) != (int)ph_size) {
+        kprint("[ELF] read failed\n");
+        kfree(phdrs);
         return false;
     }
 
     uint32_t min_vaddr = 0xFFFFFFFFu;
     uint32_t max_vaddr = 0;
+    uint32_t seg_count = 0;
 
-    Elf32_Phdr* phdrs = (Elf32_Phdr*)(file + eh->e_phoff);
-    for (uint16_t i = 0; i < eh->e_phnum; i++) {
+    for (uint16_t i = 0; i < eh.e_phnum; i++) {
         Elf32_Phdr* ph = &phdrs[i];
         if (ph->p_type != PT_LOAD || ph->p_memsz == 0) {
             continue;
         }
         if (ph->p_filesz > ph->p_memsz) {
             kprint("[ELF] segment filesz > memsz\n");
-            kfree(file);
+            kfree(phdrs);
             return false;
         }
         if (ph->p_offset > size || ph->p_offset + ph->p_filesz > size) {
             kprint("[ELF] segment out of range\n");
-            kfree(file);
+            kfree(phdrs);
             return false;
         }
         uint32_t seg_end = ph->p_vaddr + ph->p_memsz;
         if (seg_end < ph->p_vaddr) {
             kprint("[ELF] segment overflow\n");
-            kfree(file);
+            kfree(phdrs);
+            return false;
+        }
+        if (++seg_count > ELF_MAX_SEGMENTS) {
+            kprint("[ELF] too many segments\n");
+            kfree(phdrs);
             return false;
         }
         if (ph->p_vaddr < min_vaddr) {
@@ -426,12 +556,12 @@ bool elf_load_image(const char* path,
 
     if (min_vaddr == 0xFFFFFFFFu) {
         kprint("[ELF] no loadable segments\n");
-        kfree(file);
+        kfree(phdrs);
         return false;
     }
-    if (eh->e_entry < min_vaddr || eh->e_entry >= max_vaddr) {
+    if (eh.e_entry < min_vaddr || eh.e_entry >= max_vaddr) {
         kprint("[ELF] entry point out of range\n");
-        kfree(file);
+        kfree(phdrs);
         return false;
     }
 
@@ -439,7 +569,7 @@ bool elf_load_image(const char* path,
     uint32_t image_size = align_up(max_vaddr - base_vaddr, PAGE_SIZE);
     if (image_size == 0) {
         kprint("[ELF] invalid image size\n");
-        kfree(file);
+        kfree(phdrs);
         return false;
     }
 
@@ -452,74 +582,72 @@ bool elf_load_image(const char* path,
         load_base = choose_pie_base(image_size, min_base);
         if (load_base == 0) {
             kprint("[ELF] no space for PIE image\n");
-            kfree(file);
+            kfree(phdrs);
             return false;
         }
     } else {
         if (min_vaddr < ELF_USER_VADDR_MIN || max_vaddr > ELF_USER_VADDR_MAX) {
             kprint("[ELF] segment address out of user range\n");
-            kfree(file);
+            kfree(phdrs);
             return false;
         }
     }
 
-    uint32_t load_bias = load_base - base_vaddr;
-
-    uint8_t* image = (uint8_t*)kmalloc(image_size, 1, NULL);
-    if (!image) {
-        kprint("[ELF] image alloc failed\n");
-        kfree(file);
+    elf_image_t* img = (elf_image_t*)kmalloc(sizeof(elf_image_t), 0, NULL);
+    if (!img) {
+        kprint("[ELF] kmalloc failed\n");
+        kfree(phdrs);
         return false;
     }
-    memset(image, 0, image_size);
-
-    for (uint16_t i = 0; i < eh->e_phnum; i++) {
+    memset(img, 0, sizeof(*img));
+    img->refs = 1;
+    // 폴트는 cwd가 바뀐 뒤에도 나므로 마운트 접두사가 붙은 절대경로로 보관
+    if (!pagecache_abs_path(path, img->path, sizeof(img->path))) {
+        strncpy(img->path, path, sizeof(img->path) - 1);
+    }
+    // 페이지를 나중에 파일에서 다시 읽으므로 이미지가 사라질 때까지 파일을 고정
+    img->deny_slot = pagecache_deny_write(img->path);
+    if (img->deny_slot < 0) {
+        kprint("[ELF] cannot pin executable file\n");
+        kfree(img);
+        kfree(phdrs);
+        return false;
+    }
+    img->load_bias = load_base - base_vaddr;
+    img->start = load_base;
+    img->end = load_base + image_size;
+    for (uint16_t i = 0; i < eh.e_phnum; i++) {
         Elf32_Phdr* ph = &phdrs[i];
         if (ph->p_type != PT_LOAD || ph->p_memsz == 0) {
             continue;
         }
-        uint32_t seg_offset = ph->p_vaddr - base_vaddr;
-        if (seg_offset + ph->p_memsz > image_size) {
-            kprint("[ELF] segment exceeds image size\n");
-            kfree(image);
-            kfree(file);
-            return false;
-        }
-        if (ph->p_filesz > 0) {
-            memcpy(image + seg_offset, file + ph->p_offset, ph->p_filesz);
-        }
+        elf_seg_t* seg = &img->segs[img->seg_count++];
+        seg->vaddr = ph->p_vaddr + img->load_bias;
+        seg->offset = ph->p_offset;
+        seg->filesz = ph->p_filesz;
     }
 
-    if (is_pie) {
-        if (!apply_relocations(image, base_vaddr, image_size, load_bias,
-                               phdrs, eh->e_phnum)) {
-            kfree(image);
-            kfree(file);
-            return false;
-        }
+    if (is_pie && !collect_relocations(img, phdrs, eh.e_phnum)) {
+        elf_image_put(img);
+        kfree(phdrs);
+        return false;
     }
+    kfree(phdrs);
 
-    uint32_t irq_flags = irq_save();
-    for (uint32_t off = 0; off < image_size; off += PAGE_SIZE) {
-        uint32_t phys = 0;
-        if (vmm_virt_to_phys((uint32_t)image + off, &phys) != 0) {
-            kprint("[ELF] image phys lookup failed\n");
-            irq_restore(irq_flags);
-            kfree(image);
-            kfree(file);
-            return false;
-        }
-        vmm_map_page(load_base + off, phys, PAGE_PRESENT | PAGE_RW | PAGE_USER);
+    // 같은 주소에 있던 이전 내용은 버리고 새 영역으로 덮음 (non-PIE 재실행)
+    vmm_unmap_user_range(img->start, img->end);
+    vma_unmap(paging_current_dir_phys(), img->start, img->end);
+    if (vma_map(img->start, img->end, PAGE_PRESENT | PAGE_RW | PAGE_USER,
+                &elf_vma_ops, img) != 0) {
+        kprint("[ELF] cannot register image area\n");
+        elf_image_put(img);
+        return false;
     }
-    irq_restore(irq_flags);
 
-    *out_entry = eh->e_entry + load_bias;
-    *out_image_base = (uint32_t)image;
+    *out_entry = eh.e_entry + img->load_bias;
     *out_image_size = image_size;
     if (out_load_base) {
         *out_load_base = load_base;
     }
-
-    kfree(file);
     return true;
 }
@@ -6,7 +6,6 @@
 
 bool elf_load_image(const char* path,
                     uint32_t* out_entry,
-                    uint32_t* out_image_base,
                     uint32_t* out_image_size,
                     uint32_t* out_load_base,
                     bool* out_is_elf);
@@ -22,6 +22,7 @@
 #include "../drivers/mouse.h"
 #include "../drivers/spk.h"
 #include "../drivers/ata.h"
+#include "../drivers/blkcache.h"
 #include "../drivers/pci.h"
 #include "../fs/fat16.h"
 #include "../fs/fat32.h"
@@ -104,6 +105,7 @@ void kernel_main(uint32_t magic, uint32_t addr) {
     kprintf("addr  = %08X\n", addr);
     isr_install();
     irq_install();
+    string_init_cpu();
     
     kprint("initializing PMM...\n");
     pmm_init(g_mb_info_addr);
@@ -123,6 +125,7 @@ void kernel_main(uint32_t magic, uint32_t addr) {
     proc_init();
     timer_task_init();
     workqueue_init();
+    blkcache_init();
 
     set_color(15, 0);
     enable_cursor(14, 15);
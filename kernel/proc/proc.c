@@ -3,7 +3,10 @@
 #include "../bin.h"
 #include "../syscall.h"
 #include "../../mm/mem.h"
+#include "../../mm/kstack.h"
 #include "../../mm/paging.h"
+#include "../../mm/mmap.h"
+#include "../../mm/vma.h"
 #include "../../cpu/tss.h"
 #include "../../libc/string.h"
 #include "../../drivers/screen.h"
@@ -31,9 +34,12 @@ static process_t* proc_create_kernel_common(const char* name, uint32_t entry,
 void proc_wake_vfork_parent(process_t* child);
 
 static void sysmgr_watchdog_thread(void);
-#define PROC_STACK_SIZE 16384
-#define PROC_KSTACK_SIZE 65536
+#define PROC_STACK_ARGS_MAX 16384u
+#define PROC_KSTACK_SIZE KSTACK_SIZE
 #define USER_STACK_TOP 0xBFF00000u
+// 유저 스택은 1MB를 예약해 두고 처음 접근할 때 페이지 폴트에서 늘림.
+// 그 아래 USER_MMAP_END까지는 아무것도 매핑하지 않으므로 넘치면 바로 폴트가 남
+#define USER_STACK_RESERVE 0x100000u
 #define KERNEL_CS 0x08
 #define KERNEL_DS 0x10
 #define USER_CS   0x1B
@@ -75,14 +81,19 @@ static void proc_log_user_map(const char* tag, const process_t* p) {
         return;
     }
     uint32_t phys = 0;
-    bool miss_entry = (p->entry && vmm_virt_to_phys(p->entry, &phys) != 0);
+    // 이미지 페이지는 처음 접근할 때 채워지므로 영역에 들어 있으면 정상
+    bool miss_entry = (p->entry && vmm_virt_to_phys(p->entry, &phys) != 0 &&
+                       !vma_contains(p->entry));
     bool miss_load = false;
     bool miss_stack = false;
     if (p->image_load_base && p->image_load_base != p->entry) {
-        miss_load = (vmm_virt_to_phys(p->image_load_base, &phys) != 0);
+        miss_load = (vmm_virt_to_phys(p->image_load_base, &phys) != 0 &&
+                     !vma_contains(p->image_load_base));
     }
+    // 스택은 맨 위 페이지만 늘 매핑되어 있음
+    uint32_t stack_top_page = p->stack_base + p->stack_size - PAGE_SIZE;
     if (p->stack_base) {
-        miss_stack = (vmm_virt_to_phys(p->stack_base, &phys) != 0);
+        miss_stack = (vmm_virt_to_phys(stack_top_page, &phys) != 0);
     }
     if (!miss_entry && !miss_load && !miss_stack) {
         return;
@@ -106,7 +117,7 @@ static void proc_log_user_map(const char* tag, const process_t* p) {
         dump_mapping(p->image_load_base);
     }
     if (miss_stack) {
-        dump_mapping(p->stack_base);
+        dump_mapping(stack_top_page);
     }
 }
 
@@ -118,19 +129,15 @@ static void proc_cleanup(process_t* p) {
     uint32_t pid = p->pid;
     if (pid != 0) {
         sys_close_fds_for_pid(pid);
+        mmap_release_pid(pid);
     }
 
-    if (p->stack_kern_base) {
-        kfree((void*)p->stack_kern_base);
-    }
     if (p->kstack_base) {
-        kfree((void*)p->kstack_base);
-    }
-    if (p->image_base) {
-        kfree((void*)p->image_base);
+        kstack_free(p->kstack_base);
     }
+    // 이미지/스택 페이지는 주소 공간이 소유하므로 디렉터리와 함께 반환
     if (!p->is_kernel && p->page_dir) {
-        kfree((void*)p->page_dir);
+        paging_free_user_dir((uint32_t*)p->page_dir, p->page_dir_phys);
     }
 
     memset(p, 0, sizeof(*p));
@@ -162,11 +169,12 @@ static const uint8_t user_exit_stub[] = {
     0xEB, 0xFE                    // jmp $
 };
 
+// 스택을 채우는 동안에는 p의 주소 공간이 현재 디렉터리이므로 유저 주소에 바로 씀
 static inline void* proc_stack_ptr(process_t* p, uint32_t user_addr) {
     if (!p || user_addr < p->stack_base) {
         return NULL;
     }
-    return (void*)(p->stack_kern_base + (user_addr - p->stack_base));
+    return (void*)user_addr;
 }
 
 static uint32_t setup_user_stack(process_t* p, const char* const* argv, int argc) {
@@ -253,6 +261,19 @@ static uint32_t setup_user_stack(process_t* p, const char* const* argv, int argc
     return sp;
 }
 
+// setup_user_stack이 쓰는 바이트 수 (종료 스텁 + 문자열 + argv 배열 + 헤더)
+static uint32_t user_stack_args_size(const char* const* argv, int argc) {
+    uint32_t need = 16u + 3u + 8u;
+    if (!argv || argc < 0) {
+        argc = 0;
+    }
+    for (int i = 0; i < argc; i++) {
+        need += (uint32_t)strlen(argv[i] ? argv[i] : "") + 1u;
+    }
+    need += (uint32_t)(argc + 1) * sizeof(uint32_t);
+    return need;
+}
+
 static bool build_initial_frame(process_t* p, uint32_t entry,
                                 const char* const* argv, int argc) {
     uint32_t kstack_top = p->kstack_base + p->kstack_size;
@@ -288,35 +309,28 @@ static bool build_kernel_frame(process_t* p, uint32_t entry) {
     return true;
 }
 
-static bool proc_map_user_stack(process_t* p) {
-    if (!p || !p->stack_base || !p->stack_kern_base || p->stack_size == 0) {
-        return false;
-    }
-    uint32_t base = p->stack_base;
-    for (uint32_t offset = 0; offset < p->stack_size; offset += PAGE_SIZE) {
-        uint32_t phys = 0;
-        if (vmm_virt_to_phys(p->stack_kern_base + offset, &phys) != 0) {
-            return false;
-        }
-        vmm_map_page(base + offset, phys, PAGE_PRESENT | PAGE_RW | PAGE_USER);
-    }
-    return true;
-}
-
-static bool proc_init_user_stack(process_t* p) {
-    if (!p) {
+// p의 주소 공간이 현재 디렉터리일 때 호출. 인자가 들어갈 맨 위 페이지만 미리 매핑함
+static bool proc_init_user_stack(process_t* p, uint32_t initial) {
+    if (!p || initial > p->stack_size) {
         return false;
     }
     p->stack_base = USER_STACK_TOP - p->stack_size;
-    p->stack_kern_base = (uint32_t)kmalloc(p->stack_size, PAGE_SIZE, NULL);
-    if (!p->stack_kern_base) {
+    if (vma_map(p->stack_base, USER_STACK_TOP, PAGE_PRESENT | PAGE_RW | PAGE_USER,
+                NULL, NULL) != 0) {
+        p->stack_base = 0;
         return false;
     }
-    memset((void*)p->stack_kern_base, 0, p->stack_size);
-    if (!proc_map_user_stack(p)) {
-        kfree((void*)p->stack_kern_base);
-        p->stack_kern_base = 0;
-        return false;
+    uint32_t first = (USER_STACK_TOP - initial) & ~(PAGE_SIZE - 1u);
+    if (first == USER_STACK_TOP) {
+        first -= PAGE_SIZE;
+    }
+    for (uint32_t page = first; page < USER_STACK_TOP; page += PAGE_SIZE) {
+        if (vmm_map_user_page(page, PAGE_PRESENT | PAGE_RW | PAGE_USER) != 0) {
+            vmm_unmap_user_range(first, page);
+            vma_unmap(paging_current_dir_phys(), p->stack_base, USER_STACK_TOP);
+            p->stack_base = 0;
+            return false;
+        }
     }
     return true;
 }
@@ -338,26 +352,25 @@ static process_t* proc_create_common(const char* name, uint32_t entry,
                 return NULL;
             }
             p->kstack_size = PROC_KSTACK_SIZE;
-            p->kstack_base = (uint32_t)kmalloc(p->kstack_size, 1, NULL);
+            p->kstack_base = kstack_alloc();
             if (!p->kstack_base) {
-                kfree((void*)p->page_dir);
+                paging_free_user_dir((uint32_t*)p->page_dir, p->page_dir_phys);
                 p->page_dir = 0;
                 p->page_dir_phys = 0;
                 p->state = PROC_UNUSED;
                 return NULL;
             }
-            p->stack_size = PROC_STACK_SIZE;
+            p->stack_size = USER_STACK_RESERVE;
             p->stack_base = 0;
-            p->stack_kern_base = 0;
             uint32_t irq_flags = irq_save();
             uint32_t* prev_dir = paging_current_dir();
             uint32_t prev_phys = paging_current_dir_phys();
             paging_set_current_dir((uint32_t*)p->page_dir, p->page_dir_phys);
-            if (!proc_init_user_stack(p)) {
+            if (!proc_init_user_stack(p, user_stack_args_size(argv, argc))) {
                 paging_set_current_dir(prev_dir, prev_phys);
                 irq_restore(irq_flags);
-                kfree((void*)p->kstack_base);
-                kfree((void*)p->page_dir);
+                kstack_free(p->kstack_base);
+                paging_free_user_dir((uint32_t*)p->page_dir, p->page_dir_phys);
                 p->kstack_base = 0;
                 p->page_dir = 0;
                 p->page_dir_phys = 0;
@@ -368,11 +381,9 @@ static process_t* proc_create_common(const char* name, uint32_t entry,
                 if (!build_initial_frame(p, entry, argv, argc)) {
                     paging_set_current_dir(prev_dir, prev_phys);
                     irq_restore(irq_flags);
-                    kfree((void*)p->stack_kern_base);
-                    kfree((void*)p->kstack_base);
-                    kfree((void*)p->page_dir);
+                    kstack_free(p->kstack_base);
+                    paging_free_user_dir((uint32_t*)p->page_dir, p->page_dir_phys);
                     p->stack_base = 0;
-                    p->stack_kern_base = 0;
                     p->kstack_base = 0;
                     p->page_dir = 0;
                     p->page_dir_phys = 0;
@@ -413,16 +424,15 @@ static process_t* proc_create_kernel_common(const char* name, uint32_t entry,
             p->page_dir = (uint32_t)paging_kernel_dir();
             p->page_dir_phys = paging_kernel_dir_phys();
             p->kstack_size = PROC_KSTACK_SIZE;
-            p->kstack_base = (uint32_t)kmalloc(p->kstack_size, 1, NULL);
+            p->kstack_base = kstack_alloc();
             if (!p->kstack_base) {
                 p->state = PROC_UNUSED;
                 return NULL;
             }
             p->stack_base = 0;
             p->stack_size = 0;
-            p->stack_kern_base = 0;
             if (!build_kernel_frame(p, entry)) {
-                kfree((void*)p->kstack_base);
+                kstack_free(p->kstack_base);
                 p->kstack_base = 0;
                 p->state = PROC_UNUSED;
                 return NULL;
@@ -595,45 +605,6 @@ void proc_wake_vfork_parent(process_t* child) {
     }
 }
 
-static void fixup_forked_stack_frames(uint32_t child_base, uint32_t parent_base,
-                                      uint32_t size, uint32_t child_ebp) {
-    if (size == 0 || child_ebp == 0) {
-        return;
-    }
-
-    uint32_t child_end = child_base + size;
-    uint32_t parent_end = parent_base + size;
-    if (child_end < child_base || parent_end < parent_base) {
-        return;
-    }
-    if (child_ebp < child_base || child_ebp >= child_end) {
-        return;
-    }
-
-    int64_t delta = (int64_t)child_base - (int64_t)parent_base;
-    uint32_t ebp = child_ebp;
-    uint32_t max_frames = size / sizeof(uint32_t);
-
-    for (uint32_t i = 0; i < max_frames; i++) {
-        if (ebp < child_base || ebp + sizeof(uint32_t) > child_end) {
-            break;
-        }
-        uint32_t saved = *(uint32_t*)ebp;
-        if (saved < parent_base || saved >= parent_end) {
-            break;
-        }
-        uint32_t new_saved = (uint32_t)((int64_t)saved + delta);
-        if (new_saved < child_base || new_saved >= child_end) {
-            break;
-        }
-        *(uint32_t*)ebp = new_saved;
-        if (new_saved <= ebp) {
-            break;
-        }
-        ebp = new_saved;
-    }
-}
-
 process_t* proc_fork(registers_t* regs) {
     if (!current_proc || !regs || current_proc->is_kernel) {
         return NULL;
@@ -654,7 +625,6 @@ process_t* proc_fork(registers_t* regs) {
     child->is_kernel = false;
     child->pid = next_pid++;
     child->entry = current_proc->entry;
-    child->image_base = 0;
     child->image_size = current_proc->image_size;
     child->image_load_base = current_proc->image_load_base;
     child->page_dir = (uint32_t)paging_create_user_dir(&child->page_dir_phys);
@@ -665,93 +635,34 @@ process_t* proc_fork(registers_t* regs) {
     child->vfork_parent_pid = current_proc->pid;
 
     child->kstack_size = PROC_KSTACK_SIZE;
-    child->kstack_base = (uint32_t)kmalloc(child->kstack_size, 1, NULL);
+    child->kstack_base = kstack_alloc();
     if (!child->kstack_base) {
+        paging_free_user_dir((uint32_t*)child->page_dir, child->page_dir_phys);
+        child->page_dir = 0;
+        child->page_dir_phys = 0;
         child->state = PROC_UNUSED;
         return NULL;
     }
 
+    // 이미지와 스택 페이지는 복사하지 않고 읽기 전용으로 공유 (쓰기 때 페이지 폴트에서 복사).
+    // 스택 주소도 부모와 같으므로 esp/ebp를 고칠 필요가 없음
+    if (paging_clone_user_space((uint32_t*)child->page_dir, child->page_dir_phys) != 0) {
+        kstack_free(child->kstack_base);
+        paging_free_user_dir((uint32_t*)child->page_dir, child->page_dir_phys);
+        child->kstack_base = 0;
+        child->page_dir = 0;
+        child->page_dir_phys = 0;
+        child->state = PROC_UNUSED;
+        return NULL;
+    }
+    child->stack_base = current_proc->stack_base;
+    child->stack_size = current_proc->stack_size;
+    child->brk = current_proc->brk;
+
     uint32_t kstack_top = child->kstack_base + child->kstack_size;
     registers_t* frame = (registers_t*)(kstack_top - sizeof(registers_t));
     memcpy(frame, regs, sizeof(*frame));
     frame->eax = 0;
-
-    child->stack_base = 0;
-    child->stack_size = 0;
-    if (current_proc->stack_base && current_proc->stack_size) {
-        child->stack_size = current_proc->stack_size;
-        child->stack_base = 0;
-        child->stack_kern_base = 0;
-        if (child->image_size && child->image_load_base && current_proc->image_base) {
-            child->image_base = (uint32_t)kmalloc(child->image_size, 1, NULL);
-            if (!child->image_base) {
-                kfree((void*)child->kstack_base);
-                child->kstack_base = 0;
-                kfree((void*)child->page_dir);
-                child->page_dir = 0;
-                child->page_dir_phys = 0;
-                child->state = PROC_UNUSED;
-                return NULL;
-            }
-            memcpy((void*)child->image_base, (void*)current_proc->image_base, child->image_size);
-        }
-
-        uint32_t irq_flags = irq_save();
-        uint32_t* prev_dir = paging_current_dir();
-        uint32_t prev_phys = paging_current_dir_phys();
-        paging_set_current_dir((uint32_t*)child->page_dir, child->page_dir_phys);
-        if (child->image_base && child->image_size && child->image_load_base) {
-            for (uint32_t offset = 0; offset < child->image_size; offset += PAGE_SIZE) {
-                uint32_t phys = 0;
-                if (vmm_virt_to_phys(child->image_base + offset, &phys) != 0) {
-                    paging_set_current_dir(prev_dir, prev_phys);
-                    irq_restore(irq_flags);
-                    kfree((void*)child->image_base);
-                    kfree((void*)child->kstack_base);
-                    kfree((void*)child->page_dir);
-                    child->image_base = 0;
-                    child->kstack_base = 0;
-                    child->page_dir = 0;
-                    child->page_dir_phys = 0;
-                    child->state = PROC_UNUSED;
-                    return NULL;
-                }
-                vmm_map_page(child->image_load_base + offset, phys,
-                             PAGE_PRESENT | PAGE_RW | PAGE_USER);
-            }
-        }
-        if (!proc_init_user_stack(child)) {
-            paging_set_current_dir(prev_dir, prev_phys);
-            irq_restore(irq_flags);
-            kfree((void*)child->image_base);
-            kfree((void*)child->kstack_base);
-            kfree((void*)child->page_dir);
-            child->image_base = 0;
-            child->kstack_base = 0;
-            child->page_dir = 0;
-            child->page_dir_phys = 0;
-            child->state = PROC_UNUSED;
-            return NULL;
-        }
-        paging_set_current_dir(prev_dir, prev_phys);
-        irq_restore(irq_flags);
-        memcpy((void*)child->stack_kern_base, (void*)current_proc->stack_kern_base,
-               child->stack_size);
-        uint32_t parent_stack_base = current_proc->stack_base;
-        uint32_t parent_stack_end = parent_stack_base + current_proc->stack_size;
-        if (parent_stack_end >= parent_stack_base &&
-            regs->esp >= parent_stack_base && regs->esp <= parent_stack_end) {
-            uint32_t offset = regs->esp - parent_stack_base;
-            frame->esp = child->stack_base + offset;
-        }
-        if (parent_stack_end >= parent_stack_base &&
-            regs->ebp >= parent_stack_base && regs->ebp < parent_stack_end) {
-            uint32_t offset = regs->ebp - parent_stack_base;
-            frame->ebp = child->stack_base + offset;
-            fixup_forked_stack_frames(child->stack_base, parent_stack_base,
-                                      child->stack_size, frame->ebp);
-        }
-    }
     child->context_esp = (uint32_t)frame;
 
     if (current_proc->name[0]) {
@@ -763,64 +674,72 @@ process_t* proc_fork(registers_t* regs) {
     return child;
 }
 
-bool proc_exec(process_t* p, uint32_t entry, uint32_t image_base, uint32_t image_size,
+// 새 이미지는 호출 전에 p의 주소 공간에 이미 매핑되어 있음
+bool proc_exec(process_t* p, uint32_t entry, uint32_t image_size,
                uint32_t image_load_base, const char* const* argv, int argc) {
     if (!p || p->is_kernel) {
         return false;
     }
 
-    uint32_t old_stack_base = p->stack_base;
-    uint32_t old_stack_size = p->stack_size;
-    uint32_t old_stack_kern = p->stack_kern_base;
-    uint32_t old_image_base = p->image_base;
+    // 이전 스택을 놓은 뒤에는 되돌릴 수 없으므로 인자 크기는 미리 확인
+    uint32_t args_size = user_stack_args_size(argv, argc);
+    if (args_size > PROC_STACK_ARGS_MAX) {
+        return false;
+    }
+
     uint32_t old_image_size = p->image_size;
     uint32_t old_image_load = p->image_load_base;
-    uint32_t old_entry = p->entry;
-
-    p->stack_size = PROC_STACK_SIZE;
-    p->stack_base = 0;
-    p->stack_kern_base = 0;
 
     uint32_t irq_flags = irq_save();
     uint32_t* prev_dir = paging_current_dir();
     uint32_t prev_phys = paging_current_dir_phys();
     paging_set_current_dir((uint32_t*)p->page_dir, p->page_dir_phys);
-    if (!proc_init_user_stack(p)) {
+
+    // 이전 스택은 같은 주소에 새로 깔리므로 먼저 놓음 (fork 직후라면 부모와의 공유만 끊김)
+    if (p->stack_base && p->stack_size) {
+        vmm_unmap_user_range(p->stack_base, p->stack_base + p->stack_size);
+        vma_unmap(p->page_dir_phys, p->stack_base, p->stack_base + p->stack_size);
+    }
+    p->stack_size = USER_STACK_RESERVE;
+    p->stack_base = 0;
+    if (!proc_init_user_stack(p, args_size) || !build_initial_frame(p, entry, argv, argc)) {
         paging_set_current_dir(prev_dir, prev_phys);
         irq_restore(irq_flags);
-        p->stack_base = old_stack_base;
-        p->stack_size = old_stack_size;
-        p->stack_kern_base = old_stack_kern;
         return false;
     }
 
+    // 새 이미지와 겹치지 않는 이전 이미지 페이지와 영역 반환
+    if (old_image_load && old_image_size) {
+        uint32_t old_end = old_image_load + old_image_size;
+        uint32_t new_end = image_load_base + image_size;
+        if (old_image_load < image_load_base) {
+            uint32_t end = old_end < image_load_base ? old_end : image_load_base;
+            vmm_unmap_user_range(old_image_load, end);
+            vma_unmap(p->page_dir_phys, old_image_load, end);
+        }
+        if (old_end > new_end) {
+            uint32_t start = old_image_load > new_end ? old_image_load : new_end;
+            vmm_unmap_user_range(start, old_end);
+            vma_unmap(p->page_dir_phys, start, old_end);
+        }
+    }
+
+    // brk 힙은 새 이미지에 넘기지 않음
+    if (p->brk > USER_BRK_BASE) {
+        uint32_t brk_end = (p->brk + PAGE_SIZE - 1u) & ~(PAGE_SIZE - 1u);
+        vmm_unmap_user_range(USER_BRK_BASE, brk_end);
+        vma_unmap(p->page_dir_phys, USER_BRK_BASE, brk_end);
+    }
+    p->brk = 0;
+    // mmap 영역(fork로 넘겨받은 익명 영역 포함)도 새 이미지에 넘기지 않음
+    mmap_release_current(p->pid);
+
     p->entry = entry;
-    p->image_base = image_base;
     p->image_size = image_size;
     p->image_load_base = image_load_base;
 
-    if (!build_initial_frame(p, entry, argv, argc)) {
-        paging_set_current_dir(prev_dir, prev_phys);
-        irq_restore(irq_flags);
-        kfree((void*)p->stack_kern_base);
-        p->stack_base = old_stack_base;
-        p->stack_size = old_stack_size;
-        p->stack_kern_base = old_stack_kern;
-        p->image_base = old_image_base;
-        p->image_size = old_image_size;
-        p->image_load_base = old_image_load;
-        p->entry = old_entry;
-        return false;
-    }
     paging_set_current_dir(prev_dir, prev_phys);
     irq_restore(irq_flags);
-
-    if (old_stack_kern) {
-        kfree((void*)old_stack_kern);
-    }
-    if (old_image_base) {
-        kfree((void*)old_image_base);
-    }
     return true;
 }
 
@@ -20,12 +20,10 @@ typedef struct {
     uint32_t pid;
     char name[PROC_NAME_MAX];
     uint32_t entry;
-    uint32_t image_base;
     uint32_t image_size;
     uint32_t image_load_base;
     uint32_t stack_base;
     uint32_t stack_size;
-    uint32_t stack_kern_base;
     uint32_t kstack_base;
     uint32_t kstack_size;
     uint32_t context_esp;
@@ -33,6 +31,7 @@ typedef struct {
     uint32_t vfork_parent_pid;
     uint32_t page_dir;
     uint32_t page_dir_phys;
+    uint32_t brk;               // 0이면 아직 brk를 쓰지 않음 (USER_BRK_BASE)
     proc_state_t state;
     bool is_kernel;
 } process_t;
@@ -74,7 +73,7 @@ bool proc_pid_alive(uint32_t pid);
 process_t* proc_lookup(uint32_t pid);
 bool proc_pid_exited(uint32_t pid, uint32_t* exit_code);
 process_t* proc_fork(registers_t* regs);
-bool proc_exec(process_t* p, uint32_t entry, uint32_t image_base, uint32_t image_size,
+bool proc_exec(process_t* p, uint32_t entry, uint32_t image_size,
                uint32_t image_load_base, const char* const* argv, int argc);
 void proc_wake_vfork_parent(process_t* child);
 bool proc_make_current(process_t* p, registers_t* regs);
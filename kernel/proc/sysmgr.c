@@ -5,6 +5,7 @@
 #include "../bin.h"
 #include "../kernel.h"
 #include "../../libc/string.h"
+#include "../../mm/pmm.h"
 #include "../../drivers/hal.h"
 #include "../../drivers/keyboard.h"
 #include "../../drivers/screen.h"
@@ -183,6 +184,8 @@ void sysmgr_thread(void) {
 void sysmgr_idle_loop(void) {
     while (1) {
         (void)proc_start_reaper();
+        // 할 일이 없을 때 페이지를 미리 0으로 채워 둠 (생성/폴트 경로에서 memset을 덜어냄)
+        pmm_zero_pool_refill(PMM_ZERO_REFILL);
         hal_wait_for_interrupt();
         if (!proc_current()) {
             hal_disable_interrupts();
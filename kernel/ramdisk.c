@@ -17,16 +17,14 @@ static uint8_t* ramdisk_map_module(uint32_t start, uint32_t size) {
     if (map_size == 0)
         return NULL;
 
-    if (RAMDISK_MAP_BASE + map_size < RAMDISK_MAP_BASE)
+    // 물리 주소와 4MB 안의 위치를 맞춰 두면 가운데 부분은 큰 페이지로 매핑됨
+    uint32_t map_base = RAMDISK_MAP_BASE + (map_start & (LARGE_PAGE_SIZE - 1u));
+    // 창 위쪽은 커널 힙 아레나 자리
+    if (map_base + map_size < map_base || map_base + map_size > KHEAP_ARENA_START)
         return NULL;
 
-    for (uint32_t offset = 0; offset < map_size; offset += PAGE_SIZE) {
-        vmm_map_page(RAMDISK_MAP_BASE + offset,
-                     map_start + offset,
-                     PAGE_PRESENT | PAGE_RW);
-    }
-
-    return (uint8_t*)(RAMDISK_MAP_BASE + (start - map_start));
+    vmm_map_range(map_base, map_start, map_size, PAGE_PRESENT | PAGE_RW);
+    return (uint8_t*)(map_base + (start - map_start));
 }
 
 bool ramdisk_load_from_path(const char* path) {
@@ -14,12 +14,17 @@
 #include "../drivers/mouse.h"
 #include "../drivers/screen.h"
 #include "../drivers/spk.h"
+#include "../drivers/blkcache.h"
 #include "../libc/string.h"
 #include "../mm/mem.h"
 #include "../mm/paging.h"
+#include "../mm/mmap.h"
+#include "../mm/vma.h"
 #include "../fs/fscmd.h"
+#include "../fs/pagecache.h"
 #include "../fs/note.h"
 #include "../fs/disk.h"
+#include "../fs/mount.h"
 
 #define KERNEL_DS 0x10
 #define SYS_OPEN  12
@@ -51,12 +56,43 @@
 #define SYS_GUI_SEND 38
 #define SYS_GUI_RECV 39
 #define SYS_DIR_LIST 40
+#define SYS_MMAP 41
+#define SYS_MUNMAP 42
+#define SYS_RING_SETUP 43
+#define SYS_RING_ENTER 44
+#define SYS_GETDENTS 45
+#define SYS_PREAD 46
+#define SYS_PWRITE 47
+#define SYS_READV 48
+#define SYS_WRITEV 49
+#define SYS_LSEEK 50
+#define SYS_COPY_FILE 51
+#define SYS_FSYNC 52
+#define SYS_SYNC 53
+#define SYS_BRK 54
 
 #define MAX_OPEN_FILES 16
 #define MAX_PATH_LEN   256
 #define MAX_ARGC       16
 #define EFLAGS_IF      0x200u
 
+#define SYS_OFFSET_CURRENT   ((uint32_t)-1)
+#define SYS_RING_MAX_ENTRIES 256u
+#define SYS_IOV_MAX          64u
+#define SYS_COPY_CHUNK       (64u * 1024u)
+
+#define SYS_SEEK_SET 0
+#define SYS_SEEK_CUR 1
+#define SYS_SEEK_END 2
+#define MAX_RINGS            MAX_PROCS
+
+#define SYS_RING_OP_NOP   0
+#define SYS_RING_OP_OPEN  1
+#define SYS_RING_OP_READ  2
+#define SYS_RING_OP_WRITE 3
+#define SYS_RING_OP_CLOSE 4
+#define SYS_RING_OP_STAT  5
+
 #define WAIT_RUNNING   ((uint32_t)-1)
 #define WAIT_NO_SUCH   ((uint32_t)-2)
 
@@ -120,6 +156,63 @@ typedef struct {
     uint32_t name_len;
 } sys_dir_list_t;
 
+typedef struct {
+    uint32_t path_ptr;
+    uint32_t buf_ptr;
+    uint32_t buf_len;
+    uint32_t cookie;        // in/out: 0이면 처음부터
+} sys_getdents_t;
+
+typedef struct {
+    uint32_t base;
+    uint32_t len;
+} sys_iovec_t;
+
+typedef struct {
+    uint32_t src_fd;
+    uint32_t src_offset;    // SYS_OFFSET_CURRENT 이면 fd 위치를 쓰고 전진
+    uint32_t dst_fd;
+    uint32_t dst_offset;
+    uint32_t len;           // 0 이면 원본 끝까지
+} sys_copy_file_t;
+
+typedef struct {
+    uint32_t fd;
+    uint32_t offset;
+    uint32_t length;
+    uint32_t prot;
+    uint32_t flags;
+} sys_mmap_req_t;
+
+typedef struct {
+    uint32_t opcode;
+    int32_t fd;
+    uint32_t addr;
+    uint32_t len;
+    uint32_t offset;
+    uint32_t user_data;
+} sys_ring_sqe_t;
+
+typedef struct {
+    uint32_t user_data;
+    int32_t res;
+} sys_ring_cqe_t;
+
+typedef struct {
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    uint32_t entries;
+    uint32_t sqes_ptr;
+    uint32_t cqes_ptr;
+} sys_ring_t;
+
+typedef struct {
+    uint32_t pid;
+    uint32_t ring;
+} sys_ring_reg_t;
+
 typedef struct {
     int used;
     uint32_t owner_pid;
@@ -129,6 +222,7 @@ typedef struct {
 } syscall_fd_t;
 
 static syscall_fd_t fd_table[MAX_OPEN_FILES];
+static sys_ring_reg_t ring_table[MAX_RINGS];
 
 #define GUI_QUEUE_MAX 64
 static sys_gui_msg_t gui_queue[GUI_QUEUE_MAX];
@@ -182,7 +276,8 @@ static int validate_user_buffer(uint32_t addr, uint32_t size) {
 
     for (;;) {
         uint32_t phys = 0;
-        if (vmm_virt_to_phys(page, &phys) != 0)
+        // 아직 채워지지 않은 이미지/BSS 페이지는 여기서 채움
+        if (vmm_virt_to_phys(page, &phys) != 0 && vma_fault_in(page, 1) != 0)
             return -1;
         if (page == end_page)
             break;
@@ -199,7 +294,7 @@ static int copy_user_string(char* dst, uint32_t src, uint32_t max_len) {
 
     uint32_t page = src & ~0xFFFu;
     uint32_t phys = 0;
-    if (vmm_virt_to_phys(page, &phys) != 0)
+    if (vmm_virt_to_phys(page, &phys) != 0 && vma_fault_in(page, 1) != 0)
         return -1;
 
     for (uint32_t i = 0; i + 1 < max_len; i++) {
@@ -207,7 +302,7 @@ static int copy_user_string(char* dst, uint32_t src, uint32_t max_len) {
         uint32_t new_page = addr & ~0xFFFu;
         if (new_page != page) {
             page = new_page;
-            if (vmm_virt_to_phys(page, &phys) != 0)
+            if (vmm_virt_to_phys(page, &phys) != 0 && vma_fault_in(page, 1) != 0)
                 return -1;
         }
         char c = *(char*)addr;
@@ -312,6 +407,11 @@ void sys_close_fds_for_pid(uint32_t pid) {
     if (pid == 0) {
         return;
     }
+    for (int i = 0; i < MAX_RINGS; i++) {
+        if (ring_table[i].pid == pid) {
+            memset(&ring_table[i], 0, sizeof(ring_table[i]));
+        }
+    }
     for (int i = 0; i < MAX_OPEN_FILES; i++) {
         if (!fd_table[i].used) {
             continue;
@@ -330,6 +430,441 @@ static bool is_console_path(const char* path) {
         strcasecmp(path, "/dev/console") == 0;
 }
 
+static int sys_do_open(const char* path, uint32_t owner_pid) {
+    if (is_console_path(path)) {
+        int fd = alloc_fd(owner_pid);
+        if (fd < 0) {
+            return -1;
+        }
+        strncpy(fd_table[fd].path, path, sizeof(fd_table[fd].path) - 1);
+        fd_table[fd].path[sizeof(fd_table[fd].path) - 1] = '\0';
+        fd_table[fd].size = 0;
+        return fd;
+    }
+
+    if (!fscmd_exists(path)) {
+        if (!fscmd_write_file(path, "", 0)) {
+            return -1;
+        }
+    }
+
+    int fd = alloc_fd(owner_pid);
+    if (fd < 0) {
+        return -1;
+    }
+
+    strncpy(fd_table[fd].path, path, sizeof(fd_table[fd].path) - 1);
+    fd_table[fd].path[sizeof(fd_table[fd].path) - 1] = '\0';
+    fd_table[fd].size = fscmd_get_file_size(fd_table[fd].path);
+    return fd;
+}
+
+// offset == SYS_OFFSET_CURRENT 이면 fd 위치에서 읽고 위치를 전진
+static int sys_do_read(uint32_t fd_num, uint32_t buf, uint32_t len, uint32_t offset) {
+    syscall_fd_t* fd = get_fd(fd_num, proc_current_pid());
+    if (!fd || len == 0 || !buf) {
+        return 0;
+    }
+
+    if (validate_user_buffer(buf, len) != 0) {
+        return -1;
+    }
+
+    uint32_t pos = (offset == SYS_OFFSET_CURRENT) ? fd->offset : offset;
+    if (pos >= fd->size) {
+        return 0;
+    }
+
+    uint32_t remaining = fd->size - pos;
+    uint32_t to_read = len < remaining ? len : remaining;
+    int read = pagecache_read(fd->path, pos, (uint8_t*)buf, to_read);
+    if (read < 0) {
+        return -1;
+    }
+    if (offset == SYS_OFFSET_CURRENT) {
+        fd->offset += (uint32_t)read;
+    }
+    return read;
+}
+
+static void sys_console_write(const char* p, uint32_t len) {
+    uint32_t irq_flags = console_write_lock();
+    for (uint32_t i = 0; i < len; i++) {
+        kprint_char(p[i]);
+    }
+    console_write_unlock(irq_flags);
+}
+
+static int sys_do_write(uint32_t fd_num, uint32_t buf, uint32_t len) {
+    syscall_fd_t* fd = get_fd(fd_num, proc_current_pid());
+    if (!fd) {
+        return -1;
+    }
+    if (len == 0) {
+        return 0;
+    }
+    if (!buf || validate_user_buffer(buf, len) != 0) {
+        return -1;
+    }
+
+    if (is_console_path(fd->path)) {
+        sys_console_write((const char*)buf, len);
+        return (int)len;
+    }
+
+    if (!fscmd_write_file(fd->path, (const char*)buf, len)) {
+        return -1;
+    }
+
+    fd->size = len;
+    fd->offset = 0;
+    return (int)len;
+}
+
+static int sys_do_close(uint32_t fd_num) {
+    syscall_fd_t* fd = get_fd(fd_num, proc_current_pid());
+    if (!fd) {
+        return -1;
+    }
+    memset(fd, 0, sizeof(*fd));
+    return 0;
+}
+
+// 파일시스템의 구간 쓰기로 [pos, pos + len)에 닿는 클러스터만 다시 씀
+static int sys_write_at(syscall_fd_t* fd, const uint8_t* data, uint32_t len, uint32_t pos) {
+    uint32_t end = pos + len;
+    if (end < pos) {
+        return -1;
+    }
+    if (!fscmd_write_at(fd->path, pos, (const char*)data, len)) {
+        return -1;
+    }
+    if (end > fd->size) {
+        fd->size = end;
+    }
+    return (int)len;
+}
+
+static int sys_do_pwrite(uint32_t fd_num, uint32_t buf, uint32_t len, uint32_t offset) {
+    syscall_fd_t* fd = get_fd(fd_num, proc_current_pid());
+    if (!fd) {
+        return -1;
+    }
+    if (len == 0) {
+        return 0;
+    }
+    if (!buf || validate_user_buffer(buf, len) != 0) {
+        return -1;
+    }
+    if (is_console_path(fd->path)) {
+        sys_console_write((const char*)buf, len);
+        return (int)len;
+    }
+    return sys_write_at(fd, (const uint8_t*)buf, len, offset);
+}
+
+// iovec 배열을 커널로 복사하고 각 버퍼를 검증. 반환: 전체 길이 (-1 = 잘못된 요청)
+static int sys_copy_iov(uint32_t iov_ptr, uint32_t iovcnt, sys_iovec_t* out) {
+    if (iovcnt == 0 || iovcnt > SYS_IOV_MAX || !iov_ptr ||
+        validate_user_buffer(iov_ptr, iovcnt * sizeof(sys_iovec_t)) != 0) {
+        return -1;
+    }
+    memcpy(out, (const void*)iov_ptr, iovcnt * sizeof(sys_iovec_t));
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < iovcnt; i++) {
+        if (out[i].len == 0) {
+            continue;
+        }
+        if (!out[i].base || validate_user_buffer(out[i].base, out[i].len) != 0) {
+            return -1;
+        }
+        if (total + out[i].len < total || total + out[i].len > 0x7FFFFFFFu) {
+            return -1;
+        }
+        total += out[i].len;
+    }
+    return (int)total;
+}
+
+static int sys_do_readv(uint32_t fd_num, uint32_t iov_ptr, uint32_t iovcnt) {
+    syscall_fd_t* fd = get_fd(fd_num, proc_current_pid());
+    if (!fd) {
+        return -1;
+    }
+    sys_iovec_t iov[SYS_IOV_MAX];
+    if (sys_copy_iov(iov_ptr, iovcnt, iov) < 0) {
+        return -1;
+    }
+
+    // 페이지 캐시를 통해 연속 구간을 순서대로 채움
+    uint32_t done = 0;
+    for (uint32_t i = 0; i < iovcnt; i++) {
+        uint32_t pos = fd->offset + done;
+        if (pos >= fd->size) {
+            break;
+        }
+        uint32_t want = iov[i].len;
+        if (want > fd->size - pos) {
+            want = fd->size - pos;
+        }
+        if (want == 0) {
+            continue;
+        }
+        int got = pagecache_read(fd->path, pos, (uint8_t*)iov[i].base, want);
+        if (got < 0) {
+            return done ? (int)done : -1;
+        }
+        done += (uint32_t)got;
+        if ((uint32_t)got < want) {
+            break;
+        }
+    }
+    fd->offset += done;
+    return (int)done;
+}
+
+static int sys_do_writev(uint32_t fd_num, uint32_t iov_ptr, uint32_t iovcnt) {
+    syscall_fd_t* fd = get_fd(fd_num, proc_current_pid());
+    if (!fd) {
+        return -1;
+    }
+    sys_iovec_t iov[SYS_IOV_MAX];
+    int total = sys_copy_iov(iov_ptr, iovcnt, iov);
+    if (total <= 0) {
+        return total;
+    }
+
+    if (is_console_path(fd->path)) {
+        for (uint32_t i = 0; i < iovcnt; i++) {
+            sys_console_write((const char*)iov[i].base, iov[i].len);
+        }
+        return total;
+    }
+
+    // pwrite처럼 검증된 유저 버퍼를 그대로 구간 쓰기에 넘김 (커널 사본 없음)
+    uint32_t done = 0;
+    for (uint32_t i = 0; i < iovcnt; i++) {
+        if (iov[i].len == 0) {
+            continue;
+        }
+        if (sys_write_at(fd, (const uint8_t*)iov[i].base, iov[i].len, fd->offset + done) < 0) {
+            if (done == 0) {
+                return -1;
+            }
+            break;
+        }
+        done += iov[i].len;
+    }
+    fd->offset += done;
+    return (int)done;
+}
+
+// 고정 크기 커널 버퍼 하나로 원본을 조각씩 읽어 대상 끝에 이어 씀. 유저 공간은 거치지 않고,
+// 읽기와 쓰기 모두 블록 캐시를 지나며 대상은 닿는 클러스터만 기록됨
+static int sys_do_copy_file(const sys_copy_file_t* req) {
+    uint32_t pid = proc_current_pid();
+    syscall_fd_t* src = get_fd(req->src_fd, pid);
+    syscall_fd_t* dst = get_fd(req->dst_fd, pid);
+    if (!src || !dst || src == dst || is_console_path(src->path)) {
+        return -1;
+    }
+
+    uint32_t src_pos = (req->src_offset == SYS_OFFSET_CURRENT) ? src->offset : req->src_offset;
+    uint32_t dst_pos = (req->dst_offset == SYS_OFFSET_CURRENT) ? dst->offset : req->dst_offset;
+    if (src_pos >= src->size) {
+        return 0;
+    }
+    uint32_t len = src->size - src_pos;
+    if (req->len != 0 && req->len < len) {
+        len = req->len;
+    }
+    if (len > 0x7FFFFFFFu) {
+        len = 0x7FFFFFFFu;
+    }
+
+    uint32_t cap = len < SYS_COPY_CHUNK ? len : SYS_COPY_CHUNK;
+    uint8_t* buf = (uint8_t*)kmalloc(cap, 0, NULL);
+    if (!buf) {
+        return -1;
+    }
+
+    bool console = is_console_path(dst->path);
+    uint32_t done = 0;
+    while (done < len) {
+        uint32_t chunk = len - done < cap ? len - done : cap;
+        if (!fscmd_read_file_partial(src->path, src_pos + done, buf, chunk)) {
+            break;
+        }
+        if (console) {
+            sys_console_write((const char*)buf, chunk);
+        } else if (sys_write_at(dst, buf, chunk, dst_pos + done) < 0) {
+            break;
+        }
+        done += chunk;
+    }
+    kfree(buf);
+    if (done == 0) {
+        return -1;
+    }
+
+    if (req->src_offset == SYS_OFFSET_CURRENT) {
+        src->offset += done;
+    }
+    if (req->dst_offset == SYS_OFFSET_CURRENT) {
+        dst->offset += done;
+    }
+    return (int)done;
+}
+
+static int sys_do_lseek(uint32_t fd_num, int32_t offset, uint32_t whence) {
+    syscall_fd_t* fd = get_fd(fd_num, proc_current_pid());
+    if (!fd) {
+        return -1;
+    }
+    int64_t base;
+    if (whence == SYS_SEEK_SET) {
+        base = 0;
+    } else if (whence == SYS_SEEK_CUR) {
+        base = fd->offset;
+    } else if (whence == SYS_SEEK_END) {
+        base = fd->size;
+    } else {
+        return -1;
+    }
+    int64_t pos = base + offset;
+    if (pos < 0 || pos > 0x7FFFFFFF) {
+        return -1;
+    }
+    fd->offset = (uint32_t)pos;
+    return (int)pos;
+}
+
+// 파일 단위 dirty 추적은 없으므로 fd가 있는 볼륨 전체를 기록
+static int sys_do_fsync(uint32_t fd_num) {
+    syscall_fd_t* fd = get_fd(fd_num, proc_current_pid());
+    if (!fd) {
+        return -1;
+    }
+    if (is_console_path(fd->path)) {
+        return 0;
+    }
+    int drive = current_drive;
+    mount_strip_prefix(fd->path, &drive);
+    if (drive < 0) {
+        return -1;
+    }
+    return blkcache_sync_drive((uint8_t)drive) ? 0 : -1;
+}
+
+static sys_ring_reg_t* ring_lookup(uint32_t pid) {
+    for (int i = 0; i < MAX_RINGS; i++) {
+        if (ring_table[i].ring && ring_table[i].pid == pid) {
+            return &ring_table[i];
+        }
+    }
+    return NULL;
+}
+
+static int ring_setup(uint32_t ring_ptr) {
+    if (!ring_ptr || validate_user_buffer(ring_ptr, sizeof(sys_ring_t)) != 0) {
+        return -1;
+    }
+    sys_ring_t* ring = (sys_ring_t*)ring_ptr;
+    uint32_t entries = ring->entries;
+    if (entries == 0 || entries > SYS_RING_MAX_ENTRIES || (entries & (entries - 1u)) != 0) {
+        return -1;
+    }
+    if (validate_user_buffer(ring->sqes_ptr, entries * sizeof(sys_ring_sqe_t)) != 0 ||
+        validate_user_buffer(ring->cqes_ptr, entries * sizeof(sys_ring_cqe_t)) != 0) {
+        return -1;
+    }
+
+    uint32_t pid = proc_current_pid();
+    sys_ring_reg_t* reg = ring_lookup(pid);
+    if (!reg) {
+        for (int i = 0; i < MAX_RINGS; i++) {
+            if (!ring_table[i].ring) {
+                reg = &ring_table[i];
+                break;
+            }
+        }
+    }
+    if (!reg) {
+        return -1;
+    }
+
+    ring->sq_head = ring->sq_tail = 0;
+    ring->cq_head = ring->cq_tail = 0;
+    reg->pid = pid;
+    reg->ring = ring_ptr;
+    return 0;
+}
+
+static int32_t ring_exec(const sys_ring_sqe_t* sqe) {
+    switch (sqe->opcode) {
+        case SYS_RING_OP_NOP:
+            return 0;
+        case SYS_RING_OP_OPEN:
+        case SYS_RING_OP_STAT: {
+            char path[MAX_PATH_LEN];
+            if (copy_user_string(path, sqe->addr, sizeof(path)) != 0) {
+                return -1;
+            }
+            if (sqe->opcode == SYS_RING_OP_OPEN) {
+                return sys_do_open(path, proc_current_pid());
+            }
+            if (is_console_path(path) || !fscmd_exists(path)) {
+                return -1;
+            }
+            return (int32_t)fscmd_get_file_size(path);
+        }
+        case SYS_RING_OP_READ:
+            return sys_do_read((uint32_t)sqe->fd, sqe->addr, sqe->len, sqe->offset);
+        case SYS_RING_OP_WRITE:
+            return sys_do_write((uint32_t)sqe->fd, sqe->addr, sqe->len);
+        case SYS_RING_OP_CLOSE:
+            return sys_do_close((uint32_t)sqe->fd);
+        default:
+            return -1;
+    }
+}
+
+// 제출 큐에서 최대 to_submit 개를 꺼내 순서대로 실행하고 완료 큐에 결과를 기록
+static int ring_enter(uint32_t to_submit) {
+    sys_ring_reg_t* reg = ring_lookup(proc_current_pid());
+    if (!reg || validate_user_buffer(reg->ring, sizeof(sys_ring_t)) != 0) {
+        return -1;
+    }
+    sys_ring_t* ring = (sys_ring_t*)reg->ring;
+    uint32_t entries = ring->entries;
+    if (entries == 0 || entries > SYS_RING_MAX_ENTRIES || (entries & (entries - 1u)) != 0) {
+        return -1;
+    }
+    uint32_t mask = entries - 1u;
+    if (validate_user_buffer(ring->sqes_ptr, entries * sizeof(sys_ring_sqe_t)) != 0 ||
+        validate_user_buffer(ring->cqes_ptr, entries * sizeof(sys_ring_cqe_t)) != 0) {
+        return -1;
+    }
+    sys_ring_sqe_t* sqes = (sys_ring_sqe_t*)ring->sqes_ptr;
+    sys_ring_cqe_t* cqes = (sys_ring_cqe_t*)ring->cqes_ptr;
+
+    int done = 0;
+    while ((uint32_t)done < to_submit && ring->sq_head != ring->sq_tail) {
+        if (ring->cq_tail - ring->cq_head >= entries) {
+            break;  // 완료 큐가 가득 참
+        }
+        sys_ring_sqe_t sqe = sqes[ring->sq_head & mask];
+        ring->sq_head++;
+
+        sys_ring_cqe_t* cqe = &cqes[ring->cq_tail & mask];
+        cqe->user_data = sqe.user_data;
+        cqe->res = ring_exec(&sqe);
+        ring->cq_tail++;
+        done++;
+    }
+    return done;
+}
+
 static bool parse_motd_color_suffix(char* line, uint8_t* out_fg, uint8_t* out_bg) {
     if (!line || !out_fg || !out_bg) {
         return false;
@@ -548,115 +1083,75 @@ void syscall_handler(registers_t* regs) {
                 regs->eax = (uint32_t)-1;
                 break;
             }
-
-            uint32_t owner_pid = proc_current_pid();
-            if (is_console_path(path)) {
-                int fd = alloc_fd(owner_pid);
-                if (fd < 0) {
-                    regs->eax = (uint32_t)-1;
-                    break;
-                }
-                strncpy(fd_table[fd].path, path, sizeof(fd_table[fd].path) - 1);
-                fd_table[fd].path[sizeof(fd_table[fd].path) - 1] = '\0';
-                fd_table[fd].size = 0;
-                regs->eax = (uint32_t)fd;
-                break;
-            }
-
-            if (!fscmd_exists(path)) {
-                if (!fscmd_write_file(path, "", 0)) {
-                    regs->eax = (uint32_t)-1;
-                    break;
-                }
-            }
-
-            int fd = alloc_fd(owner_pid);
-            if (fd < 0) {
-                regs->eax = (uint32_t)-1;
-                break;
-            }
-
-            strncpy(fd_table[fd].path, path, sizeof(fd_table[fd].path) - 1);
-            fd_table[fd].path[sizeof(fd_table[fd].path) - 1] = '\0';
-            fd_table[fd].size = fscmd_get_file_size(fd_table[fd].path);
-            regs->eax = (uint32_t)fd;
+            regs->eax = (uint32_t)sys_do_open(path, proc_current_pid());
             break;
         }
 
         case SYS_READ: { // read(fd, buf, len)
-            syscall_fd_t* fd = get_fd(ebx, proc_current_pid());
-            if (!fd || ecx == 0 || !regs->edx) {
+            if (ecx == 0 || !regs->edx) {
                 regs->eax = 0;
                 break;
             }
+            regs->eax = (uint32_t)sys_do_read(ebx, regs->edx, ecx, SYS_OFFSET_CURRENT);
+            break;
+        }
+
+        case SYS_WRITE: { // write(fd, buf, len) - overwrite
+            regs->eax = (uint32_t)sys_do_write(ebx, regs->edx, ecx);
+            break;
+        }
 
-            if (validate_user_buffer(regs->edx, ecx) != 0) {
+        case SYS_PREAD: { // pread(fd, buf, len, offset)
+            if (regs->esi == SYS_OFFSET_CURRENT) {
                 regs->eax = (uint32_t)-1;
                 break;
             }
+            regs->eax = (uint32_t)sys_do_read(ebx, regs->edx, ecx, regs->esi);
+            break;
+        }
 
-            if (fd->offset >= fd->size) {
-                regs->eax = 0;
-                break;
-            }
+        case SYS_PWRITE: { // pwrite(fd, buf, len, offset)
+            regs->eax = (uint32_t)sys_do_pwrite(ebx, regs->edx, ecx, regs->esi);
+            break;
+        }
 
-            uint32_t remaining = fd->size - fd->offset;
-            uint32_t to_read = ecx < remaining ? ecx : remaining;
-            int read = fscmd_read_file(fd->path, (uint8_t*)regs->edx, fd->offset, to_read);
-            if (read < 0) {
-                regs->eax = (uint32_t)-1;
-                break;
-            }
-            fd->offset += (uint32_t)read;
-            regs->eax = (uint32_t)read;
+        case SYS_READV: { // readv(fd, iov, iovcnt)
+            regs->eax = (uint32_t)sys_do_readv(ebx, regs->edx, ecx);
             break;
         }
 
-        case SYS_WRITE: { // write(fd, buf, len) - overwrite
-            syscall_fd_t* fd = get_fd(ebx, proc_current_pid());
-            if (!fd) {
-                regs->eax = (uint32_t)-1;
-                break;
-            }
-            if (ecx == 0) {
-                regs->eax = 0;
-                break;
-            }
-            if (!regs->edx || validate_user_buffer(regs->edx, ecx) != 0) {
-                regs->eax = (uint32_t)-1;
-                break;
-            }
+        case SYS_WRITEV: { // writev(fd, iov, iovcnt)
+            regs->eax = (uint32_t)sys_do_writev(ebx, regs->edx, ecx);
+            break;
+        }
 
-            if (is_console_path(fd->path)) {
-                const char* buf = (const char*)regs->edx;
-                uint32_t irq_flags = console_write_lock();
-                for (uint32_t i = 0; i < ecx; i++) {
-                    kprint_char(buf[i]);
-                }
-                console_write_unlock(irq_flags);
-                regs->eax = ecx;
-                break;
-            }
+        case SYS_LSEEK: { // lseek(fd, offset, whence) -> new offset
+            regs->eax = (uint32_t)sys_do_lseek(ebx, (int32_t)ecx, edx);
+            break;
+        }
 
-            if (!fscmd_write_file(fd->path, (const char*)regs->edx, ecx)) {
+        case SYS_COPY_FILE: { // copy_file(req) -> bytes copied
+            if (!ebx || validate_user_buffer(ebx, sizeof(sys_copy_file_t)) != 0) {
                 regs->eax = (uint32_t)-1;
                 break;
             }
+            sys_copy_file_t req = *(sys_copy_file_t*)ebx;
+            regs->eax = (uint32_t)sys_do_copy_file(&req);
+            break;
+        }
 
-            fd->size = ecx;
-            fd->offset = 0;
-            regs->eax = ecx;
+        case SYS_FSYNC: { // fsync(fd)
+            regs->eax = (uint32_t)sys_do_fsync(ebx);
+            break;
+        }
+
+        case SYS_SYNC: { // sync()
+            regs->eax = blkcache_sync_all() ? 0u : (uint32_t)-1;
             break;
         }
 
         case SYS_CLOSE: { // close(fd)
-            syscall_fd_t* fd = get_fd(ebx, proc_current_pid());
-            if (!fd) {
-                regs->eax = (uint32_t)-1;
-                break;
-            }
-            memset(fd, 0, sizeof(*fd));
-            regs->eax = 0;
+            regs->eax = (uint32_t)sys_do_close(ebx);
             break;
         }
 
@@ -722,7 +1217,6 @@ void syscall_handler(registers_t* regs) {
             }
 
             uint32_t entry = 0;
-            uint32_t image_base = 0;
             uint32_t image_size = 0;
             uint32_t image_load_base = 0;
             if (!fscmd_exists(path)) {
@@ -730,7 +1224,7 @@ void syscall_handler(registers_t* regs) {
                 regs->eax = EXEC_ERR_NOENT;
                 break;
             }
-            if (!bin_load_image(path, &entry, &image_base, &image_size, &image_load_base)) {
+            if (!bin_load_image(path, &entry, &image_size, &image_load_base)) {
                 free_kernel_argv(argv, argc);
                 regs->eax = EXEC_ERR_NOEXEC;
                 break;
@@ -739,17 +1233,16 @@ void syscall_handler(registers_t* regs) {
             process_t* cur = proc_current();
             if (!cur || cur->is_kernel) {
                 free_kernel_argv(argv, argc);
-                if (image_base) {
-                    kfree((void*)image_base);
-                }
                 regs->eax = EXEC_ERR_PERM;
                 break;
             }
-            if (!proc_exec(cur, entry, image_base, image_size, image_load_base,
+            if (!proc_exec(cur, entry, image_size, image_load_base,
                            (const char* const*)argv, argc)) {
                 free_kernel_argv(argv, argc);
-                if (image_base) {
-                    kfree((void*)image_base);
+                if (image_load_base != cur->image_load_base) {
+                    vmm_unmap_user_range(image_load_base, image_load_base + image_size);
+                    vma_unmap(paging_current_dir_phys(), image_load_base,
+                              image_load_base + image_size);
                 }
                 regs->eax = EXEC_ERR_NOMEM;
                 break;
@@ -1044,6 +1537,85 @@ void syscall_handler(registers_t* regs) {
             break;
         }
 
+        case SYS_GETDENTS: { // getdents(req) -> bytes (0 = end)
+            if (!ebx || validate_user_buffer(ebx, sizeof(sys_getdents_t)) != 0) {
+                regs->eax = (uint32_t)-1;
+                break;
+            }
+            sys_getdents_t req = *(sys_getdents_t*)ebx;
+            if (!req.buf_ptr || req.buf_len == 0 ||
+                validate_user_buffer(req.buf_ptr, req.buf_len) != 0) {
+                regs->eax = (uint32_t)-1;
+                break;
+            }
+            char path[MAX_PATH_LEN];
+            const char* use_path = NULL;
+            if (req.path_ptr) {
+                if (copy_user_string(path, req.path_ptr, sizeof(path)) != 0) {
+                    regs->eax = (uint32_t)-1;
+                    break;
+                }
+                if (path[0] != '\0') {
+                    use_path = path;
+                }
+            }
+            uint32_t cookie = req.cookie;
+            int bytes = fscmd_getdents(use_path, &cookie, (uint8_t*)req.buf_ptr, req.buf_len);
+            ((sys_getdents_t*)ebx)->cookie = cookie;
+            regs->eax = (bytes < 0) ? (uint32_t)-1 : (uint32_t)bytes;
+            break;
+        }
+
+        case SYS_MMAP: { // mmap(req) -> addr
+            if (!ebx || validate_user_buffer(ebx, sizeof(sys_mmap_req_t)) != 0) {
+                regs->eax = (uint32_t)-1;
+                break;
+            }
+            sys_mmap_req_t req = *(sys_mmap_req_t*)ebx;
+            uint32_t pid = proc_current_pid();
+            if (req.flags & MMAP_ANON) {
+                uint32_t addr = mmap_anon(pid, req.length, req.prot);
+                regs->eax = addr ? addr : (uint32_t)-1;
+                break;
+            }
+            syscall_fd_t* fd = get_fd(req.fd, pid);
+            if (!fd || is_console_path(fd->path)) {
+                regs->eax = (uint32_t)-1;
+                break;
+            }
+            uint32_t addr = mmap_file(pid, fd->path, req.offset, req.length,
+                                      req.prot, req.flags);
+            regs->eax = addr ? addr : (uint32_t)-1;
+            break;
+        }
+
+        case SYS_BRK: { // brk(addr) -> 새 brk (실패하면 이전 값). 0이면 현재 값만
+            process_t* p = proc_current();
+            if (!p || p->is_kernel) {
+                regs->eax = (uint32_t)-1;
+                break;
+            }
+            uint32_t cur = p->brk ? p->brk : USER_BRK_BASE;
+            p->brk = ebx ? mmap_brk(cur, ebx) : cur;
+            regs->eax = p->brk;
+            break;
+        }
+
+        case SYS_MUNMAP: { // munmap(addr, len)
+            regs->eax = (mmap_unmap(proc_current_pid(), ebx, ecx) == 0) ? 0 : (uint32_t)-1;
+            break;
+        }
+
+        case SYS_RING_SETUP: { // ring_setup(ring)
+            regs->eax = (uint32_t)ring_setup(ebx);
+            break;
+        }
+
+        case SYS_RING_ENTER: { // ring_enter(to_submit) -> submitted
+            regs->eax = (uint32_t)ring_enter(ebx);
+            break;
+        }
+
         case SYS_DISK: { // disk(cmd)
             char cmd[MAX_PATH_LEN];
             cmd[0] = '\0';
@@ -184,12 +184,23 @@ void *memmove(void *dest, const void *src, size_t n) {
     unsigned char *d = (unsigned char*)dest;
     const unsigned char *s = (const unsigned char*)src;
 
-    if (d < s) {
-        for (size_t i = 0; i < n; i++)
-            d[i] = s[i];
-    } else if (d > s) {
-        for (size_t i = n; i > 0; i--)
-            d[i-1] = s[i-1];
+    if (d == s || n == 0)
+        return dest;
+    // 앞으로 복사해도 안 덮이면 memcpy 경로
+    if (d < s || d >= s + n)
+        return memcpy(dest, src, n);
+
+    // 뒤에서부터: 남는 바이트를 먼저 옮기고 나머지는 dword를 거꾸로
+    d += n;
+    s += n;
+    for (size_t tail = n & 3u; tail > 0; tail--)
+        *--d = *--s;
+    size_t dwords = n >> 2;
+    if (dwords) {
+        d -= 4;
+        s -= 4;
+        __asm__ volatile("std; rep movsl; cld"
+                         : "+D"(d), "+S"(s), "+c"(dwords) :: "memory");
     }
     return dest;
 }
@@ -468,14 +479,69 @@ int sprintf(char *out, const char *fmt, ...) {
 
 void* memset(void* dest, int val, size_t len) {
     uint8_t* ptr = (uint8_t*)dest;
+    if (len >= 16) {
+        // 목적지를 4바이트 경계에 맞춘 뒤 rep stosd
+        size_t head = (size_t)(-(uintptr_t)ptr) & 3u;
+        len -= head;
+        while (head--)
+            *ptr++ = (uint8_t)val;
+        uint32_t word = (uint8_t)val * 0x01010101u;
+        size_t dwords = len >> 2;
+        __asm__ volatile("rep stosl"
+                         : "+D"(ptr), "+c"(dwords) : "a"(word) : "memory");
+        len &= 3u;
+    }
     while (len--)
         *ptr++ = (uint8_t)val;
     return dest;
 }
 
+// 이보다 큰 복사는 movnti로 캐시를 건너뜀 (프레임버퍼, 램디스크 같은 큰 덩어리)
+#define MEMCPY_NT_MIN (256u * 1024u)
+
+static bool memcpy_nt = false;
+
+void string_init_cpu(void) {
+    uint32_t eax = 1, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    // movnti는 SSE2지만 XMM 레지스터를 안 쓰므로 FPU 상태 저장 없이 써도 됨
+    memcpy_nt = (edx & (1u << 26)) != 0;
+}
+
+// 16바이트 단위, d는 4바이트 정렬
+static void copy_nt(uint8_t* d, const uint8_t* s, size_t n) {
+    for (; n >= 16; n -= 16, d += 16, s += 16) {
+        const uint32_t* src = (const uint32_t*)s;
+        uint32_t a = src[0], b = src[1], c = src[2], e = src[3];
+        __asm__ volatile("movnti %1, 0(%0)\n\t"
+                         "movnti %2, 4(%0)\n\t"
+                         "movnti %3, 8(%0)\n\t"
+                         "movnti %4, 12(%0)"
+                         :: "r"(d), "r"(a), "r"(b), "r"(c), "r"(e) : "memory");
+    }
+    __asm__ volatile("sfence" ::: "memory");
+}
+
 void* memcpy(void* dest, const void* src, size_t n) {
     uint8_t* d = (uint8_t*)dest;
     const uint8_t* s = (const uint8_t*)src;
+    if (n >= 16) {
+        size_t head = (size_t)(-(uintptr_t)d) & 3u;
+        n -= head;
+        while (head--)
+            *d++ = *s++;
+        if (memcpy_nt && n >= MEMCPY_NT_MIN) {
+            size_t chunk = n & ~(size_t)15u;
+            copy_nt(d, s, chunk);
+            d += chunk;
+            s += chunk;
+            n -= chunk;
+        }
+        size_t dwords = n >> 2;
+        __asm__ volatile("rep movsl"
+                         : "+D"(d), "+S"(s), "+c"(dwords) :: "memory");
+        n &= 3u;
+    }
     while (n--)
         *d++ = *s++;
     return dest;
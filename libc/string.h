@@ -36,6 +36,8 @@ int isdigit(char c);
 int sprintf(char *out, const char *fmt, ...);
 void* memset(void* dest, int val, size_t len);
 void* memcpy(void* dest, const void* src, size_t n);
+// CPUID로 큰 복사용 movnti 경로를 켬 (부팅 때 한 번)
+void string_init_cpu(void);
 int atoi(const char* str);
 uint32_t rand();
 unsigned long strtoul(const char *nptr, char **endptr, int base);
@@ -0,0 +1,226 @@
+// mm/dma.c
+#include "dma.h"
+#include "paging.h"
+#include "pmm.h"
+#include "../drivers/screen.h"
+#include "../libc/string.h"
+
+#define EFLAGS_IF 0x200u
+
+#define DMA_PAGES      (KDMA_SIZE / PAGE_SIZE)
+#define DMA_WORDS      (DMA_PAGES / 32)
+
+struct dma_pool {
+    bool used;
+    char name[DMA_NAME_MAX];
+    uint32_t obj_size;
+    uint32_t per_page;
+    uint32_t flags;
+    void* free;             // 객체 첫 4바이트로 잇는 free 리스트
+    uint32_t pages;
+    uint32_t active;
+};
+
+static uint32_t dma_vmap[DMA_WORDS];        // 1 = 사용 중인 창 페이지
+static uint32_t dma_phys[DMA_PAGES];        // 창 페이지 -> 물리 주소
+static uint8_t dma_order[DMA_PAGES];        // 할당 첫 페이지에 order + 1
+static struct dma_pool pools[DMA_MAX_POOLS];
+
+static inline uint32_t irq_save(void) {
+    uint32_t flags = 0;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+static uint32_t dma_page_flags(uint32_t flags) {
+    uint32_t pte = PAGE_PRESENT | PAGE_RW;
+    if (flags & DMA_WC) {
+        if (paging_pat_wc_enabled())
+            pte |= PAGE_PAT;
+        else
+            pte |= PAGE_PCD | PAGE_PWT;
+    } else if (flags & DMA_UNCACHED) {
+        pte |= PAGE_PCD | PAGE_PWT;
+    }
+    return pte;
+}
+
+static uint32_t dma_size_order(size_t size) {
+    uint32_t pages = (uint32_t)((size + PAGE_SIZE - 1u) / PAGE_SIZE);
+    uint32_t order = 0;
+    while ((1u << order) < pages)
+        order++;
+    return order;
+}
+
+// 창에서 2^order 페이지 구간을 찾음 (드라이버 초기화 때 주로 불리므로 선형 탐색)
+static int dma_vmap_alloc(uint32_t order) {
+    uint32_t n = 1u << order;
+    for (uint32_t start = 0; start + n <= DMA_PAGES; start += n) {
+        uint32_t k = 0;
+        while (k < n && !(dma_vmap[(start + k) / 32] & (1u << ((start + k) % 32))))
+            k++;
+        if (k == n) {
+            for (k = 0; k < n; k++)
+                dma_vmap[(start + k) / 32] |= 1u << ((start + k) % 32);
+            return (int)start;
+        }
+    }
+    return -1;
+}
+
+static void dma_vmap_release(uint32_t start, uint32_t order) {
+    for (uint32_t k = 0; k < (1u << order); k++)
+        dma_vmap[(start + k) / 32] &= ~(1u << ((start + k) % 32));
+}
+
+void* dma_alloc_coherent(size_t size, uint32_t flags, uint32_t* out_phys) {
+    if (size == 0)
+        return NULL;
+    uint32_t order = dma_size_order(size);
+    if (order > PMM_MAX_ORDER)
+        return NULL;
+
+    void* frames = pmm_alloc_pages(order);
+    if (!frames)
+        return NULL;
+
+    uint32_t irq = irq_save();
+    int start = dma_vmap_alloc(order);
+    irq_restore(irq);
+    if (start < 0) {
+        pmm_free_pages(frames, order);
+        kprint("[DMA] window exhausted\n");
+        return NULL;
+    }
+
+    uint32_t virt = KDMA_START + (uint32_t)start * PAGE_SIZE;
+    uint32_t phys = (uint32_t)frames;
+    uint32_t pte = dma_page_flags(flags);
+    for (uint32_t i = 0; i < (1u << order); i++) {
+        vmm_map_page(virt + i * PAGE_SIZE, phys + i * PAGE_SIZE, pte);
+        dma_phys[start + i] = phys + i * PAGE_SIZE;
+    }
+    dma_order[start] = (uint8_t)(order + 1u);
+    memset((void*)virt, 0, (size_t)PAGE_SIZE << order);
+
+    if (out_phys)
+        *out_phys = phys;
+    return (void*)virt;
+}
+
+void dma_free_coherent(void* virt) {
+    uint32_t addr = (uint32_t)virt;
+    if (addr < KDMA_START || addr >= KDMA_START + KDMA_SIZE || (addr & 0xFFFu))
+        return;
+    uint32_t start = (addr - KDMA_START) / PAGE_SIZE;
+    if (dma_order[start] == 0) {
+        kprintf("[DMA] bad free %08X\n", addr);
+        return;
+    }
+    uint32_t order = dma_order[start] - 1u;
+    uint32_t phys = dma_phys[start];
+
+    for (uint32_t i = 0; i < (1u << order); i++) {
+        vmm_unmap_page(addr + i * PAGE_SIZE);
+        dma_phys[start + i] = 0;
+    }
+    dma_order[start] = 0;
+    pmm_free_pages((void*)phys, order);
+
+    uint32_t irq = irq_save();
+    dma_vmap_release(start, order);
+    irq_restore(irq);
+}
+
+uint32_t dma_virt_to_phys(const void* virt) {
+    uint32_t addr = (uint32_t)virt;
+    if (addr >= KDMA_START && addr < KDMA_START + KDMA_SIZE) {
+        uint32_t page = dma_phys[(addr - KDMA_START) / PAGE_SIZE];
+        return page ? page | (addr & 0xFFFu) : 0;
+    }
+    uint32_t phys = 0;
+    if (vmm_virt_to_phys(addr, &phys) != 0)
+        return 0;
+    return phys;
+}
+
+dma_pool_t* dma_pool_create(const char* name, size_t size, size_t align, uint32_t flags) {
+    if (!name || size == 0 || size > PAGE_SIZE)
+        return NULL;
+    if (align < sizeof(void*))
+        align = sizeof(void*);
+    if ((align & (align - 1u)) != 0 || align > PAGE_SIZE)
+        return NULL;
+    uint32_t stride = (uint32_t)((size + align - 1u) & ~(align - 1u));
+
+    uint32_t irq = irq_save();
+    for (int i = 0; i < DMA_MAX_POOLS; i++) {
+        if (pools[i].used && strcmp(pools[i].name, name) == 0) {
+            irq_restore(irq);
+            return &pools[i];
+        }
+    }
+    for (int i = 0; i < DMA_MAX_POOLS; i++) {
+        struct dma_pool* p = &pools[i];
+        if (p->used)
+            continue;
+        memset(p, 0, sizeof(*p));
+        p->used = true;
+        strncpy(p->name, name, DMA_NAME_MAX - 1);
+        p->obj_size = stride;
+        p->per_page = PAGE_SIZE / stride;
+        p->flags = flags;
+        irq_restore(irq);
+        return p;
+    }
+    irq_restore(irq);
+    kprintf("[DMA] cannot create pool %s\n", name);
+    return NULL;
+}
+
+void* dma_pool_alloc(dma_pool_t* pool, uint32_t* out_phys) {
+    if (!pool)
+        return NULL;
+
+    uint32_t irq = irq_save();
+    if (!pool->free) {
+        irq_restore(irq);
+        // 페이지 하나를 통째로 받아 객체 단위로 쪼갬 (풀 페이지는 반납하지 않음)
+        uint8_t* page = (uint8_t*)dma_alloc_coherent(PAGE_SIZE, pool->flags, NULL);
+        if (!page)
+            return NULL;
+        irq = irq_save();
+        for (uint32_t i = pool->per_page; i > 0; i--) {
+            void** obj = (void**)(page + (i - 1u) * pool->obj_size);
+            *obj = pool->free;
+            pool->free = obj;
+        }
+        pool->pages++;
+    }
+    void** obj = (void**)pool->free;
+    pool->free = *obj;
+    pool->active++;
+    irq_restore(irq);
+
+    memset(obj, 0, pool->obj_size);
+    if (out_phys)
+        *out_phys = dma_virt_to_phys(obj);
+    return obj;
+}
+
+void dma_pool_free(dma_pool_t* pool, void* virt) {
+    if (!pool || !virt)
+        return;
+    uint32_t irq = irq_save();
+    *(void**)virt = pool->free;
+    pool->free = virt;
+    pool->active--;
+    irq_restore(irq);
+}
@@ -0,0 +1,30 @@
+// mm/dma.h
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// 장치가 읽고 쓰는 버퍼 전용 가상 창 (슬랩 창 위, 램디스크 매핑 아래)
+#define KDMA_START     0xC7000000u
+#define KDMA_SIZE      (16u * 1024u * 1024u)
+
+// 매핑 속성
+#define DMA_CACHED     0x0u     // x86 PCI는 캐시 스누핑을 하므로 기본값
+#define DMA_UNCACHED   0x1u
+#define DMA_WC         0x2u     // PAT WC를 못 쓰면 uncached
+
+#define DMA_MAX_POOLS  16
+#define DMA_NAME_MAX   16
+
+typedef struct dma_pool dma_pool_t;
+
+// 물리적으로 연속이고 크기(2의 거듭제곱 페이지)만큼 정렬된 버퍼. 0으로 채워서 줌
+void* dma_alloc_coherent(size_t size, uint32_t flags, uint32_t* out_phys);
+void dma_free_coherent(void* virt);
+
+// 디스크립터(TRB, qTD, PRDT, BDL 등)용 고정 크기 풀. 객체는 4KB 경계를 넘지 않음
+dma_pool_t* dma_pool_create(const char* name, size_t size, size_t align, uint32_t flags);
+void* dma_pool_alloc(dma_pool_t* pool, uint32_t* out_phys);
+void dma_pool_free(dma_pool_t* pool, void* virt);
+
+// DMA 창 안은 표에서 바로, 밖이면 페이지 테이블을 봄. 실패하면 0
+uint32_t dma_virt_to_phys(const void* virt);
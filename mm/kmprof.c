@@ -0,0 +1,212 @@
+// mm/kmprof.c
+#include "kmprof.h"
+#include "../cpu/timer.h"
+#include "../libc/string.h"
+
+#define EFLAGS_IF 0x200u
+#define HASH_MUL  2654435761u
+
+typedef struct {
+    uint32_t ptr;               // 0 = 빈 칸
+    uint32_t size;
+    uint32_t site;              // sites[] 인덱스
+} kmprof_live_t;
+
+static bool enabled = false;
+static uint32_t start_tick = 0;
+static uint32_t site_count = 0;
+static uint32_t tracked = 0;
+static uint32_t dropped = 0;
+static uint32_t live_bytes = 0;
+static uint32_t peak_live = 0;
+static kmprof_site_t sites[KMPROF_SITES];
+static kmprof_live_t live[KMPROF_TRACKED];
+
+static inline uint32_t irq_save(void) {
+    uint32_t flags = 0;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+static uint32_t size_bucket(size_t size) {
+    if (size <= 32u)
+        return 0;
+    if (size <= 128u)
+        return 1;
+    if (size <= 512u)
+        return 2;
+    if (size <= 4096u)
+        return 3;
+    if (size <= 65536u)
+        return 4;
+    return 5;
+}
+
+// 복귀 주소로 찾고 없으면 새로 등록. 표가 차면 -1
+static int site_slot(uint32_t site) {
+    uint32_t i = (site * HASH_MUL) >> (32u - KMPROF_SITE_BITS);
+    for (uint32_t n = 0; n < KMPROF_SITES; n++, i = (i + 1u) & (KMPROF_SITES - 1u)) {
+        if (sites[i].site == site)
+            return (int)i;
+        if (sites[i].site == 0) {
+            sites[i].site = site;
+            site_count++;
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static inline uint32_t live_home(uint32_t ptr) {
+    return (ptr * HASH_MUL) >> (32u - KMPROF_TRACK_BITS);
+}
+
+static int live_find(uint32_t ptr) {
+    uint32_t i = live_home(ptr);
+    for (uint32_t n = 0; n < KMPROF_TRACKED; n++, i = (i + 1u) & (KMPROF_TRACKED - 1u)) {
+        if (live[i].ptr == ptr)
+            return (int)i;
+        if (live[i].ptr == 0)
+            return -1;
+    }
+    return -1;
+}
+
+// 선형 탐사 표에서 지운 칸 뒤의 항목을 당겨 와서 탐색 사슬이 끊기지 않게 함
+static void live_remove(uint32_t i) {
+    uint32_t j = i;
+    live[i].ptr = 0;
+    for (;;) {
+        j = (j + 1u) & (KMPROF_TRACKED - 1u);
+        if (live[j].ptr == 0)
+            return;
+        uint32_t home = live_home(live[j].ptr);
+        // home이 (i, j] 안에 있으면 그 자리에 두어도 찾을 수 있음
+        bool stay = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+        if (stay)
+            continue;
+        live[i] = live[j];
+        live[j].ptr = 0;
+        i = j;
+    }
+}
+
+void kmprof_enable(bool on) {
+    uint32_t irq = irq_save();
+    if (on && !enabled)
+        start_tick = tick;
+    enabled = on;
+    irq_restore(irq);
+}
+
+void kmprof_reset(void) {
+    uint32_t irq = irq_save();
+    memset(sites, 0, sizeof(sites));
+    memset(live, 0, sizeof(live));
+    site_count = 0;
+    tracked = 0;
+    dropped = 0;
+    live_bytes = 0;
+    peak_live = 0;
+    start_tick = tick;
+    irq_restore(irq);
+}
+
+void kmprof_alloc(uint32_t site, const void* ptr, size_t size) {
+    if (!enabled || !ptr)
+        return;
+
+    uint32_t irq = irq_save();
+    int s = site_slot(site);
+    if (s < 0 || tracked + 1u >= KMPROF_TRACKED) {
+        dropped++;
+        irq_restore(irq);
+        return;
+    }
+    kmprof_site_t* st = &sites[s];
+    st->allocs++;
+    st->bytes += (uint32_t)size;
+    st->hist[size_bucket(size)]++;
+    st->live_bytes += (uint32_t)size;
+    if (st->live_bytes > st->peak_live)
+        st->peak_live = st->live_bytes;
+
+    uint32_t i = live_home((uint32_t)ptr);
+    while (live[i].ptr != 0)
+        i = (i + 1u) & (KMPROF_TRACKED - 1u);
+    live[i].ptr = (uint32_t)ptr;
+    live[i].size = (uint32_t)size;
+    live[i].site = (uint32_t)s;
+    tracked++;
+
+    live_bytes += (uint32_t)size;
+    if (live_bytes > peak_live)
+        peak_live = live_bytes;
+    irq_restore(irq);
+}
+
+void kmprof_free(const void* ptr) {
+    // 끈 뒤에도 이미 추적 중인 할당은 마저 정리
+    if (!ptr || (!enabled && tracked == 0))
+        return;
+
+    uint32_t irq = irq_save();
+    int i = live_find((uint32_t)ptr);
+    if (i >= 0) {
+        kmprof_site_t* st = &sites[live[i].site];
+        st->frees++;
+        st->live_bytes -= live[i].size;
+        live_bytes -= live[i].size;
+        tracked--;
+        live_remove((uint32_t)i);
+    }
+    irq_restore(irq);
+}
+
+int kmprof_top(kmprof_site_t* out, int max) {
+    if (!out || max <= 0)
+        return 0;
+
+    int n = 0;
+    uint32_t irq = irq_save();
+    for (uint32_t i = 0; i < KMPROF_SITES; i++) {
+        if (sites[i].site == 0)
+            continue;
+        // 작은 배열이므로 삽입 정렬
+        int pos = n;
+        while (pos > 0 && out[pos - 1].allocs < sites[i].allocs)
+            pos--;
+        if (pos >= max)
+            continue;
+        int last = (n < max) ? n : max - 1;
+        for (int k = last; k > pos; k--)
+            out[k] = out[k - 1];
+        out[pos] = sites[i];
+        if (n < max)
+            n++;
+    }
+    irq_restore(irq);
+    return n;
+}
+
+void kmprof_summary(kmprof_summary_t* out) {
+    if (!out)
+        return;
+
+    uint32_t irq = irq_save();
+    out->enabled = enabled;
+    out->sites = site_count;
+    out->tracked = tracked;
+    out->dropped = dropped;
+    out->live_bytes = live_bytes;
+    out->peak_live = peak_live;
+    uint32_t hz = timer_frequency();
+    out->seconds = hz ? (tick - start_tick) / hz : 0;
+    irq_restore(irq);
+}
@@ -0,0 +1,43 @@
+// mm/kmprof.h
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// kmalloc/kfree 호출 위치(복귀 주소)별 통계. 켜 둔 동안만 기록하고 기본은 꺼져 있음
+#define KMPROF_SITE_BITS   7
+#define KMPROF_SITES       (1u << KMPROF_SITE_BITS)
+#define KMPROF_TRACK_BITS  12
+#define KMPROF_TRACKED     (1u << KMPROF_TRACK_BITS)   // 동시에 추적하는 살아 있는 할당 수
+#define KMPROF_BUCKETS     6                            // <=32, <=128, <=512, <=4K, <=64K, 그 이상
+
+typedef struct {
+    uint32_t site;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t bytes;             // 누적 요청 바이트
+    uint32_t live_bytes;
+    uint32_t peak_live;
+    uint32_t hist[KMPROF_BUCKETS];
+} kmprof_site_t;
+
+typedef struct {
+    bool enabled;
+    uint32_t sites;
+    uint32_t tracked;           // 지금 추적 중인 할당 수
+    uint32_t dropped;           // 표가 차서 못 남긴 할당 수
+    uint32_t live_bytes;
+    uint32_t peak_live;
+    uint32_t seconds;           // 켠 뒤 지난 시간
+} kmprof_summary_t;
+
+void kmprof_enable(bool on);
+void kmprof_reset(void);
+
+// mem.c의 kmalloc/kmalloc_aligned/kfree가 부름
+void kmprof_alloc(uint32_t site, const void* ptr, size_t size);
+void kmprof_free(const void* ptr);
+
+// 할당 횟수가 많은 순으로 최대 max개. 채운 개수를 돌려줌
+int kmprof_top(kmprof_site_t* out, int max);
+void kmprof_summary(kmprof_summary_t* out);
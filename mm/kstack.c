@@ -0,0 +1,79 @@
+// mm/kstack.c
+#include "kstack.h"
+#include "paging.h"
+#include "pmm.h"
+#include "../drivers/screen.h"
+
+#define EFLAGS_IF 0x200u
+#define KSTACK_STRIDE (KSTACK_GUARD + KSTACK_SIZE)
+
+static uint8_t free_slots[KSTACK_SLOTS];    // 다시 쓸 수 있는 매핑된 슬롯 (스택처럼 꺼냄)
+static uint32_t free_count = 0;
+static uint32_t next_slot = 0;              // 아직 매핑한 적 없는 첫 슬롯
+
+static inline uint32_t irq_save(void) {
+    uint32_t flags = 0;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+static inline uint32_t slot_base(uint32_t slot) {
+    return KSTACK_POOL_START + slot * KSTACK_STRIDE + KSTACK_GUARD;
+}
+
+uint32_t kstack_alloc(void) {
+    uint32_t irq = irq_save();
+    if (free_count) {
+        uint32_t slot = free_slots[--free_count];
+        irq_restore(irq);
+        return slot_base(slot);
+    }
+    if (next_slot >= KSTACK_SLOTS) {
+        irq_restore(irq);
+        kprint("[KSTACK] out of slots\n");
+        return 0;
+    }
+    uint32_t slot = next_slot++;
+    irq_restore(irq);
+
+    uint32_t base = slot_base(slot);
+    if (vmm_map_range_alloc(base, KSTACK_SIZE, PAGE_PRESENT | PAGE_RW) != 0) {
+        // 일부만 매핑된 슬롯도 다음에 다시 채울 수 있게 남겨 둠
+        for (uint32_t off = 0; off < KSTACK_SIZE; off += PAGE_SIZE) {
+            uint32_t phys = 0;
+            if (vmm_virt_to_phys(base + off, &phys) == 0) {
+                vmm_unmap_page(base + off);
+                pmm_free_page((void*)(phys & 0xFFFFF000u));
+            }
+        }
+        irq = irq_save();
+        if (next_slot == slot + 1u)
+            next_slot = slot;
+        irq_restore(irq);
+        kprint("[KSTACK] out of memory\n");
+        return 0;
+    }
+    return base;
+}
+
+void kstack_free(uint32_t base) {
+    if (base < KSTACK_POOL_START + KSTACK_GUARD ||
+        (base - KSTACK_POOL_START - KSTACK_GUARD) % KSTACK_STRIDE != 0) {
+        kprintf("[KSTACK] bad free %08X\n", base);
+        return;
+    }
+    uint32_t slot = (base - KSTACK_POOL_START - KSTACK_GUARD) / KSTACK_STRIDE;
+    if (slot >= next_slot)
+        return;
+
+    uint32_t irq = irq_save();
+    if (free_count < KSTACK_SLOTS)
+        free_slots[free_count++] = (uint8_t)slot;
+    irq_restore(irq);
+}
@@ -0,0 +1,14 @@
+// mm/kstack.h
+#pragma once
+#include <stdint.h>
+
+// 프로세스 커널 스택 전용 창 (커널 이미지 high-mapping과 힙 사이).
+// 슬롯마다 아래쪽에 매핑하지 않은 가드 페이지를 두어 넘치면 바로 페이지 폴트가 남
+#define KSTACK_POOL_START 0xC0C00000u
+#define KSTACK_SIZE       65536u
+#define KSTACK_GUARD      4096u
+#define KSTACK_SLOTS      32
+
+// 스택 맨 아래 주소 (top = base + KSTACK_SIZE). 한 번 매핑한 슬롯은 반납 후에도 매핑을 유지
+uint32_t kstack_alloc(void);
+void kstack_free(uint32_t base);
@@ -1,38 +1,90 @@
 #include "mem.h"
 #include "paging.h"
+#include "pmm.h"
+#include "slab.h"
+#include "kmprof.h"
 #include <stdint.h>
 #include <stddef.h>
 #include "../drivers/screen.h"
+#include "../libc/string.h"
 
-#define ALIGN4(x)         (((x) + 3u) & ~3u)
 #define ALIGN_UP(x, a)    (((x) + ((a) - 1u)) & ~((a) - 1u))
 #define PAGE_ALIGN_UP(x)  ALIGN_UP((x), 0x1000u)
 
 #define KHEAP_DEFAULT_START 0xC1000000u
 #define KHEAP_DEFAULT_SIZE  (64u * 1024u * 1024u) // 64MB (committed on demand)
-
-static uintptr_t heap_base = KHEAP_DEFAULT_START;
-static uintptr_t heap_curr = KHEAP_DEFAULT_START;
-static uintptr_t heap_commit_end = KHEAP_DEFAULT_START;
-static uintptr_t heap_end = KHEAP_DEFAULT_START + KHEAP_DEFAULT_SIZE;
+#define KHEAP_LARGE_MIN_FREE (64u * 1024u * 1024u) // 이만큼 남아 있으면 첫 4MB를 큰 페이지로
+#define KHEAP_HIGH_WATER_DEFAULT (8u * 1024u * 1024u)
+
+#define EFLAGS_IF 0x200u
+
+// 힙 가상 구간 하나. 아레나마다 끝에 epilogue가 있어서 블록이 경계를 넘어 합쳐지지 않음
+typedef struct {
+    uintptr_t base;
+    uintptr_t curr;         // epilogue 바로 뒤
+    uintptr_t commit_end;   // 여기까지 한 번은 매핑함 (안쪽 빈 페이지는 반납됐을 수 있음)
+    uintptr_t end;
+} heap_arena_t;
+
+static heap_arena_t arenas[KHEAP_MAX_ARENAS];
+static uint32_t arena_count = 0;
+static uintptr_t arena_next_base = KHEAP_ARENA_START;  // 다음에 살펴볼 아레나 창
+static uintptr_t heap_resident_end = KHEAP_DEFAULT_START;  // 큰 페이지로 붙인 앞부분은 반납 안 함
+static uint32_t heap_committed = 0;     // 지금 매핑된 힙 바이트
+static uint32_t heap_holes = 0;         // commit_end 아래에서 PMM에 돌려준 페이지 수
+static uint32_t heap_high_water = KHEAP_HIGH_WATER_DEFAULT;
 
 // 필요하면 링커에서 _kernel_end 가져와서 KHEAP_START_LOW 대신 써도 됨
 extern uint8_t _kernel_end;
 
-static int heap_commit_to(uintptr_t need_end);
+static int heap_commit_to(heap_arena_t* a, uintptr_t need_end);
 
+/* ====== 블록 구조 (boundary tag) ======
+   [header 8B][payload ...]
+   - header.size 하위 비트는 플래그 (FREE, PREV_FREE)
+   - 빈 블록은 payload 앞쪽에 free 리스트 링크, 마지막 4바이트에 footer(헤더 주소)
+   - 힙 끝에는 size 0인 epilogue 헤더가 항상 있음
+*/
 typedef struct block_header {
-    size_t size;                 // payload size
-    struct block_header* next;
-    struct block_header* prev;
-    uint32_t free;               // 1=free, 0=used
+    uint32_t size;
+    uint32_t magic;
+    struct block_header* next_free;     // 빈 블록일 때만 유효
+    struct block_header* prev_free;
 } block_header_t;
 
-static block_header_t* heap_head = NULL;
-static block_header_t* heap_tail = NULL;
+#define BLOCK_HDR        8u
+#define BLOCK_ALIGN      8u
+#define BLOCK_FREE       0x1u
+#define BLOCK_PREV_FREE  0x2u
+#define BLOCK_SIZE_MASK  (~(BLOCK_ALIGN - 1u))
+#define BLOCK_MAGIC      0x4B484541u     // "KHEA"
+#define MIN_PAYLOAD      16u
+#define MIN_BLOCK_SIZE   (BLOCK_HDR + MIN_PAYLOAD)
+
+/* ====== TLSF 2단계 분리 free 리스트 ======
+   fl 0: 256B 미만을 16B 간격으로, fl 1~: 2^(fl+7) 구간을 16등분 */
+#define TLSF_SL_LOG2   4u
+#define TLSF_SL_COUNT  (1u << TLSF_SL_LOG2)
+#define TLSF_SMALL     256u
+#define TLSF_FL_SHIFT  7u
+
+static block_header_t* free_lists[KHEAP_CLASSES][TLSF_SL_COUNT];
+static uint32_t fl_bitmap = 0;
+static uint32_t sl_bitmap[KHEAP_CLASSES];
+static uint32_t heap_peak_used = 0;
+static uint32_t heap_used = 0;
+
+static inline uint32_t irq_save(void) {
+    uint32_t flags = 0;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
 
-#define MIN_SPLIT_SIZE 8u
-#define MIN_BLOCK_SIZE (sizeof(block_header_t) + MIN_SPLIT_SIZE)
+static inline void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
 
 static inline uintptr_t align_up(uintptr_t val, size_t align) {
     if (!align)
@@ -49,202 +101,402 @@ static size_t normalize_align(size_t align) {
             p <<= 1u;
         align = p;
     }
-    if (align < 4)
-        align = 4;
+    if (align <= BLOCK_ALIGN)
+        return 0;           // 블록은 원래 8바이트 정렬
     return align;
 }
 
-static inline uintptr_t block_end(block_header_t* block) {
-    return (uintptr_t)block + sizeof(block_header_t) + block->size;
+static inline uint32_t fls32(uint32_t v) {
+    return 31u - (uint32_t)__builtin_clz(v);
 }
 
-static inline int blocks_adjacent(block_header_t* a, block_header_t* b) {
-    return block_end(a) == (uintptr_t)b;
+static inline uint32_t block_size(const block_header_t* b) {
+    return b->size & BLOCK_SIZE_MASK;
 }
 
-static void split_block(block_header_t* block, size_t size) {
-    if (block->size <= size)
-        return;
-
-    size_t remaining = block->size - size;
-    if (remaining < MIN_BLOCK_SIZE)
-        return;
-
-    block_header_t* next = (block_header_t*)((uintptr_t)block + sizeof(block_header_t) + size);
-    next->size = remaining - sizeof(block_header_t);
-    next->free = 1;
-    next->prev = block;
-    next->next = block->next;
-
-    if (block->next)
-        block->next->prev = next;
-    block->next = next;
+static inline block_header_t* block_next(const block_header_t* b) {
+    return (block_header_t*)((uintptr_t)b + BLOCK_HDR + block_size(b));
+}
 
-    if (heap_tail == block)
-        heap_tail = next;
+// 앞 블록이 비어 있을 때만 유효 (앞 블록의 footer)
+static inline block_header_t* block_prev(const block_header_t* b) {
+    return *(block_header_t**)((uintptr_t)b - sizeof(block_header_t*));
+}
 
-    block->size = size;
+static inline void block_set_size(block_header_t* b, uint32_t size) {
+    b->size = size | (b->size & (BLOCK_FREE | BLOCK_PREV_FREE));
 }
 
-static int block_can_fit(block_header_t* block, size_t size, size_t align, uintptr_t* out_header) {
-    uintptr_t start = (uintptr_t)block;
-    uintptr_t payload = start + sizeof(block_header_t);
-    uintptr_t aligned_payload = align ? align_up(payload, align) : payload;
-    uintptr_t aligned_header = aligned_payload - sizeof(block_header_t);
-    uintptr_t end = block_end(block);
+static void block_mark_free(block_header_t* b) {
+    b->size |= BLOCK_FREE;
+    block_header_t* next = block_next(b);
+    next->size |= BLOCK_PREV_FREE;
+    *(block_header_t**)((uintptr_t)next - sizeof(block_header_t*)) = b;
+}
 
-    if (aligned_payload + size > end)
-        return 0;
+static void block_mark_used(block_header_t* b) {
+    b->size &= ~BLOCK_FREE;
+    block_next(b)->size &= ~BLOCK_PREV_FREE;
+}
 
-    size_t leading = aligned_header - start;
-    if (leading != 0 && leading < MIN_BLOCK_SIZE)
-        return 0;
+static void tlsf_mapping(uint32_t size, uint32_t* fl, uint32_t* sl) {
+    if (size < TLSF_SMALL) {
+        *fl = 0;
+        *sl = size / (TLSF_SMALL / TLSF_SL_COUNT);
+    } else {
+        uint32_t f = fls32(size);
+        *sl = (size >> (f - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT;
+        *fl = f - TLSF_FL_SHIFT;
+    }
+}
 
-    if (out_header)
-        *out_header = aligned_header;
-    return 1;
+static void tlsf_insert(block_header_t* b) {
+    uint32_t fl, sl;
+    tlsf_mapping(block_size(b), &fl, &sl);
+    block_header_t* head = free_lists[fl][sl];
+    b->prev_free = NULL;
+    b->next_free = head;
+    if (head)
+        head->prev_free = b;
+    free_lists[fl][sl] = b;
+    fl_bitmap |= 1u << fl;
+    sl_bitmap[fl] |= 1u << sl;
 }
 
-static block_header_t* find_free_block(size_t size, size_t align, uintptr_t* out_header) {
-    for (block_header_t* cur = heap_head; cur; cur = cur->next) {
-        if (!cur->free)
-            continue;
-        if (block_can_fit(cur, size, align, out_header))
-            return cur;
+static void tlsf_remove(block_header_t* b) {
+    uint32_t fl, sl;
+    tlsf_mapping(block_size(b), &fl, &sl);
+    if (b->prev_free)
+        b->prev_free->next_free = b->next_free;
+    else
+        free_lists[fl][sl] = b->next_free;
+    if (b->next_free)
+        b->next_free->prev_free = b->prev_free;
+    if (!free_lists[fl][sl]) {
+        sl_bitmap[fl] &= ~(1u << sl);
+        if (!sl_bitmap[fl])
+            fl_bitmap &= ~(1u << fl);
     }
-    return NULL;
 }
 
-static void* allocate_from_block(block_header_t* block, uintptr_t aligned_header, size_t size) {
-    uintptr_t start = (uintptr_t)block;
-    uintptr_t end = block_end(block);
+// 다음 2단계 구간 경계로 올림: 그 구간의 블록은 모두 size 이상
+static inline uint32_t tlsf_round(uint32_t size) {
+    if (size >= TLSF_SMALL)
+        size += (1u << (fls32(size) - TLSF_SL_LOG2)) - 1u;
+    else
+        size = ALIGN_UP(size, TLSF_SMALL / TLSF_SL_COUNT);
+    return size;
+}
 
-    if (aligned_header != start) {
-        size_t leading = aligned_header - start;
+// size 이상이 보장되는 리스트에서 첫 블록 (good-fit, O(1))
+static block_header_t* tlsf_find(uint32_t size) {
+    size = tlsf_round(size);
 
-        block_header_t* lead = block;
-        lead->size = leading - sizeof(block_header_t);
-        lead->free = 1;
+    uint32_t fl, sl;
+    tlsf_mapping(size, &fl, &sl);
+    if (fl >= KHEAP_CLASSES)
+        return NULL;
 
-        block_header_t* aligned = (block_header_t*)aligned_header;
-        aligned->size = (size_t)(end - (aligned_header + sizeof(block_header_t)));
-        aligned->free = 1;
-        aligned->prev = lead;
-        aligned->next = lead->next;
-        if (lead->next)
-            lead->next->prev = aligned;
-        lead->next = aligned;
-        if (heap_tail == lead)
-            heap_tail = aligned;
+    uint32_t sl_map = sl_bitmap[fl] & (~0u << sl);
+    if (!sl_map) {
+        uint32_t fl_map = (fl + 1u < 32u) ? (fl_bitmap & (~0u << (fl + 1u))) : 0;
+        if (!fl_map)
+            return NULL;
+        fl = (uint32_t)__builtin_ctz(fl_map);
+        sl_map = sl_bitmap[fl];
+    }
+    sl = (uint32_t)__builtin_ctz(sl_map);
+    return free_lists[fl][sl];
+}
 
-        block = aligned;
+// 앞뒤 빈 블록과 합친 뒤 free 리스트에 넣음
+static block_header_t* block_release(block_header_t* b) {
+    block_header_t* next = block_next(b);
+    if (next->size & BLOCK_FREE) {
+        tlsf_remove(next);
+        block_set_size(b, block_size(b) + BLOCK_HDR + block_size(next));
     }
+    if (b->size & BLOCK_PREV_FREE) {
+        block_header_t* prev = block_prev(b);
+        tlsf_remove(prev);
+        block_set_size(prev, block_size(prev) + BLOCK_HDR + block_size(b));
+        b = prev;
+    }
+    block_mark_free(b);
+    tlsf_insert(b);
+    return b;
+}
 
-    split_block(block, size);
-    block->free = 0;
-    return (void*)((uintptr_t)block + sizeof(block_header_t));
+// 사용 중인 블록 b의 뒤쪽 남는 부분을 새 빈 블록으로 떼어냄
+static void block_trim(block_header_t* b, uint32_t size) {
+    uint32_t total = block_size(b);
+    if (total < size + MIN_BLOCK_SIZE)
+        return;
+    block_header_t* rest = (block_header_t*)((uintptr_t)b + BLOCK_HDR + size);
+    block_set_size(b, size);
+    rest->size = (total - size - BLOCK_HDR);
+    rest->magic = BLOCK_MAGIC;
+    block_release(rest);
 }
 
-static void* allocate_new_block(size_t size, size_t align) {
-    uintptr_t start = heap_curr;
-    uintptr_t payload = start + sizeof(block_header_t);
-    uintptr_t aligned_payload = align ? align_up(payload, align) : payload;
-    uintptr_t aligned_header = aligned_payload - sizeof(block_header_t);
-    uintptr_t end = aligned_header + sizeof(block_header_t) + size;
+// 아레나 끝(epilogue 자리)에 최소 payload 크기의 빈 블록을 만들어 붙임
+static bool arena_extend(heap_arena_t* a, uint32_t payload) {
+    block_header_t* b = (block_header_t*)(a->curr - BLOCK_HDR);
+    uintptr_t end = PAGE_ALIGN_UP((uintptr_t)b + BLOCK_HDR + payload + BLOCK_HDR);
+    if (end > a->end || end < (uintptr_t)b)
+        return false;
+    if (heap_commit_to(a, end) != 0)
+        return false;
+
+    block_header_t* epilogue = (block_header_t*)(end - BLOCK_HDR);
+    epilogue->size = 0;
+    epilogue->magic = BLOCK_MAGIC;
+
+    b->size = (uint32_t)((uintptr_t)epilogue - ((uintptr_t)b + BLOCK_HDR)) |
+              (b->size & BLOCK_PREV_FREE);
+    b->magic = BLOCK_MAGIC;
+    a->curr = end;
+    block_release(b);
+    return true;
+}
 
-    if (end > heap_end)
-        return NULL;
+// 빈 아레나 = 첫 페이지의 epilogue 하나 (base, end, commit_end는 불린 쪽에서 채움)
+static int arena_init(heap_arena_t* a) {
+    if (heap_commit_to(a, a->base + 1u) != 0)
+        return -1;
+    block_header_t* epilogue = (block_header_t*)a->base;
+    epilogue->size = 0;
+    epilogue->magic = BLOCK_MAGIC;
+    a->curr = a->base + BLOCK_HDR;
+    return 0;
+}
 
-    if (heap_commit_to(end) != 0)
-        return NULL;
+// 프레임버퍼 같은 다른 매핑이 자리를 차지하고 있지 않은지
+static bool arena_range_free(uintptr_t base, uintptr_t end) {
+    for (uintptr_t addr = base; addr < end; addr += PAGE_SIZE) {
+        uint32_t phys = 0;
+        if (vmm_virt_to_phys((uint32_t)addr, &phys) == 0)
+            return false;
+    }
+    return true;
+}
 
-    if (aligned_header > start) {
-        size_t gap = aligned_header - start;
-        if (gap >= MIN_BLOCK_SIZE) {
-            block_header_t* gap_block = (block_header_t*)start;
-            gap_block->size = gap - sizeof(block_header_t);
-            gap_block->free = 1;
-            gap_block->prev = heap_tail;
-            gap_block->next = NULL;
-            if (heap_tail)
-                heap_tail->next = gap_block;
-            else
-                heap_head = gap_block;
-            heap_tail = gap_block;
-        } else if (gap > 0 && heap_tail && heap_tail->free && blocks_adjacent(heap_tail, (block_header_t*)start)) {
-            heap_tail->size += gap;
+static bool heap_extend(uint32_t payload) {
+    for (uint32_t i = 0; i < arena_count; i++) {
+        if (arena_extend(&arenas[i], payload))
+            return true;
+    }
+    if (arena_count >= KHEAP_MAX_ARENAS)
+        return false;
+
+    heap_arena_t* a = &arenas[arena_count];
+    for (;;) {
+        if (arena_next_base > KHEAP_ARENA_LIMIT - KHEAP_ARENA_SIZE)
+            return false;
+        uintptr_t base = arena_next_base;
+        arena_next_base += KHEAP_ARENA_SIZE;
+        if (arena_range_free(base, base + KHEAP_ARENA_SIZE)) {
+            a->base = base;
+            break;
         }
+        kprintf("[HEAP] arena window %08X already mapped, skipping\n", (uint32_t)base);
+    }
+    a->end = a->base + KHEAP_ARENA_SIZE;
+    a->commit_end = a->base;
+    if (arena_init(a) != 0) {
+        arena_next_base = a->base;  // 메모리가 모자랐던 것뿐이니 다음에 같은 칸을 다시 씀
+        return false;
     }
+    arena_count++;
+    kprintf("[HEAP] arena %u at %08X\n", arena_count - 1u, (uint32_t)a->base);
+    return arena_extend(a, payload);
+}
 
-    block_header_t* block = (block_header_t*)aligned_header;
-    block->size = size;
-    block->free = 0;
-    block->prev = heap_tail;
-    block->next = NULL;
-    if (heap_tail)
-        heap_tail->next = block;
-    else
-        heap_head = block;
-    heap_tail = block;
+static heap_arena_t* heap_arena_of(uintptr_t addr) {
+    for (uint32_t i = 0; i < arena_count; i++) {
+        if (addr >= arenas[i].base + BLOCK_HDR && addr < arenas[i].curr)
+            return &arenas[i];
+    }
+    return NULL;
+}
 
-    heap_curr = end;
-    return (void*)((uintptr_t)block + sizeof(block_header_t));
+// 반납했던 페이지가 [start, end)에 있으면 다시 붙임
+static int heap_commit_range(uintptr_t start, uintptr_t end) {
+    if (heap_holes == 0)
+        return 0;
+    for (uintptr_t addr = start & 0xFFFFF000u; addr < end; addr += PAGE_SIZE) {
+        uint32_t phys = 0;
+        if (vmm_virt_to_phys((uint32_t)addr, &phys) == 0)
+            continue;
+        if (vmm_map_page_alloc((uint32_t)addr, PAGE_PRESENT | PAGE_RW, NULL) != 0)
+            return -1;
+        heap_committed += PAGE_SIZE;
+        heap_holes--;
+    }
+    return 0;
+}
+
+// 빈 블록 m에서 [lo, hi)에 걸친 페이지를 PMM에 돌려줌.
+// 헤더(free 링크 포함)와 footer가 걸린 페이지는 남겨서 블록 구조는 그대로 읽을 수 있음
+static void heap_decommit(const block_header_t* m, uintptr_t lo, uintptr_t hi) {
+    uintptr_t first = PAGE_ALIGN_UP((uintptr_t)m + sizeof(block_header_t));
+    uintptr_t last = ((uintptr_t)block_next(m) - sizeof(block_header_t*)) & 0xFFFFF000u;
+    lo &= 0xFFFFF000u;
+    hi = PAGE_ALIGN_UP(hi);
+    if (lo < first)
+        lo = first;
+    if (hi > last)
+        hi = last;
+    if (lo >= arenas[0].base && lo < heap_resident_end)
+        lo = heap_resident_end;
+
+    for (uintptr_t addr = lo; addr < hi && heap_committed > heap_high_water; addr += PAGE_SIZE) {
+        uint32_t phys = 0;
+        if (vmm_virt_to_phys((uint32_t)addr, &phys) != 0)
+            continue;
+        vmm_unmap_page((uint32_t)addr);
+        pmm_free_page((void*)(phys & 0xFFFFF000u));
+        heap_committed -= PAGE_SIZE;
+        heap_holes++;
+    }
 }
 
 static void* kmalloc_internal(size_t size, size_t align) {
     if (size == 0)
         return NULL;
 
-    size = ALIGN4(size);
+    size = ALIGN_UP(size, BLOCK_ALIGN);
     align = normalize_align(align);
 
-    uintptr_t aligned_header = 0;
-    block_header_t* block = find_free_block(size, align, &aligned_header);
-    if (block)
-        return allocate_from_block(block, aligned_header, size);
+    // 4KB 이하는 크기 클래스 슬랩에서 O(1)로, 안 되면 블록 힙으로
+    void* obj = slab_alloc(size, align);
+    if (obj)
+        return obj;
+
+    if (size < MIN_PAYLOAD)
+        size = MIN_PAYLOAD;
+    if (size > KHEAP_ARENA_SIZE - 2u * BLOCK_HDR)
+        return NULL;
 
-    return allocate_new_block(size, align);
+    // 정렬 요청은 앞쪽을 빈 블록으로 떼어낼 여유까지 포함해서 찾음
+    uint32_t search = (uint32_t)size;
+    if (align)
+        search += (uint32_t)align + MIN_BLOCK_SIZE;
+
+    uint32_t flags = irq_save();
+    block_header_t* b = tlsf_find(search);
+    if (!b) {
+        if (!heap_extend(tlsf_round(search))) {
+            irq_restore(flags);
+            return NULL;
+        }
+        b = tlsf_find(search);
+        if (!b) {
+            irq_restore(flags);
+            return NULL;
+        }
+    }
+    // 블록 안에서 실제로 쓸 앞부분(뒤에 떼어낼 빈 블록 헤더까지)만 다시 매핑
+    uintptr_t need_end = (uintptr_t)b + BLOCK_HDR + search + sizeof(block_header_t);
+    if (need_end > (uintptr_t)block_next(b))
+        need_end = (uintptr_t)block_next(b);
+    if (heap_commit_range((uintptr_t)b, need_end) != 0) {
+        irq_restore(flags);
+        return NULL;
+    }
+    tlsf_remove(b);
+    block_mark_used(b);
+
+    if (align) {
+        uintptr_t payload = (uintptr_t)b + BLOCK_HDR;
+        uintptr_t aligned = align_up(payload, align);
+        if (aligned != payload && aligned - payload < MIN_BLOCK_SIZE)
+            aligned = align_up(payload + MIN_BLOCK_SIZE, align);
+        if (aligned != payload) {
+            uint32_t total = block_size(b);
+            block_header_t* nb = (block_header_t*)(aligned - BLOCK_HDR);
+            uint32_t lead = (uint32_t)((uintptr_t)nb - payload);
+            nb->size = total - lead - BLOCK_HDR;
+            nb->magic = BLOCK_MAGIC;
+            block_set_size(b, lead);
+            block_release(b);       // nb 앞 블록이 비므로 PREV_FREE도 같이 설정됨
+            b = nb;
+        }
+    }
+
+    block_trim(b, (uint32_t)size);
+    heap_used += block_size(b);
+    if (heap_used > heap_peak_used)
+        heap_peak_used = heap_used;
+    irq_restore(flags);
+    return (void*)((uintptr_t)b + BLOCK_HDR);
 }
 
-static int heap_commit_to(uintptr_t need_end) {
+static int heap_commit_to(heap_arena_t* a, uintptr_t need_end) {
     uintptr_t new_commit_end = PAGE_ALIGN_UP(need_end);
-    if (new_commit_end <= heap_commit_end)
+    if (new_commit_end <= a->commit_end)
         return 0;
 
-    for (uintptr_t addr = heap_commit_end; addr < new_commit_end; addr += PAGE_SIZE) {
+    for (uintptr_t addr = a->commit_end; addr < new_commit_end; addr += PAGE_SIZE) {
         if (vmm_map_page_alloc((uint32_t)addr, PAGE_PRESENT | PAGE_RW, NULL) != 0)
             return -1;
+        a->commit_end = addr + PAGE_SIZE;
+        heap_committed += PAGE_SIZE;
     }
-
-    heap_commit_end = new_commit_end;
     return 0;
 }
 
 void kmalloc_init(uint32_t heap_start, uint32_t heap_end_addr) {
+    heap_arena_t* a = &arenas[0];
     if (heap_start) {
-        heap_base = PAGE_ALIGN_UP((uintptr_t)heap_start);
+        a->base = PAGE_ALIGN_UP((uintptr_t)heap_start);
     } else {
-        heap_base = KHEAP_DEFAULT_START;
+        a->base = KHEAP_DEFAULT_START;
     }
 
     if (heap_end_addr) {
-        heap_end = (uintptr_t)heap_end_addr;
+        a->end = (uintptr_t)heap_end_addr;
     } else {
-        heap_end = heap_base + KHEAP_DEFAULT_SIZE;
+        a->end = a->base + KHEAP_DEFAULT_SIZE;
     }
 
-    heap_curr = heap_base;
-    heap_commit_end = heap_base;
-    heap_head = NULL;
-    heap_tail = NULL;
+    a->commit_end = a->base;
+    heap_resident_end = a->base;
+    heap_committed = 0;
+    heap_holes = 0;
+    fl_bitmap = 0;
+    for (uint32_t i = 0; i < KHEAP_CLASSES; i++) {
+        sl_bitmap[i] = 0;
+        for (uint32_t j = 0; j < TLSF_SL_COUNT; j++)
+            free_lists[i][j] = NULL;
+    }
+    heap_used = 0;
+    heap_peak_used = 0;
+
+    // 부팅 때 잡히는 커널 객체가 몰리는 힙 앞부분은 연속 4MB를 큰 페이지 하나로 붙여 둠
+    if (!(a->base & (LARGE_PAGE_SIZE - 1u)) &&
+        pmm_get_free_memory() >= KHEAP_LARGE_MIN_FREE) {
+        void* frames = pmm_alloc_pages(PMM_MAX_ORDER);
+        if (frames) {
+            vmm_map_range((uint32_t)a->base, (uint32_t)frames, LARGE_PAGE_SIZE,
+                          PAGE_PRESENT | PAGE_RW);
+            a->commit_end = a->base + LARGE_PAGE_SIZE;
+            heap_resident_end = a->commit_end;
+            heap_committed = LARGE_PAGE_SIZE;
+        }
+    }
 
-    if (heap_commit_to(heap_base + 1u) != 0) {
+    if (arena_init(a) != 0) {
         kprint("kmalloc init: failed to map initial heap page\n");
         return;
     }
+    arena_count = 1;
 
-    kprintf("kmalloc init: heap virt [%08X - %08X)\n",
-            (uint32_t)heap_base, (uint32_t)heap_end);
+    slab_init();
+
+    kprintf("kmalloc init: heap virt [%08X - %08X), slab [%08X - %08X)\n",
+            (uint32_t)a->base, (uint32_t)a->end,
+            KSLAB_START, KSLAB_START + KSLAB_SIZE);
 }
 
 void* kmalloc(size_t size, int align, uint32_t* phys_addr) {
@@ -252,6 +504,7 @@ void* kmalloc(size_t size, int align, uint32_t* phys_addr) {
     void* res = kmalloc_internal(size, use_align);
     if (!res)
         return NULL;
+    kmprof_alloc((uint32_t)__builtin_return_address(0), res, size);
 
     if (phys_addr) {
         uint32_t phys;
@@ -265,37 +518,92 @@ void* kmalloc(size_t size, int align, uint32_t* phys_addr) {
 }
 
 void* kmalloc_aligned(size_t size, size_t align) {
-    return kmalloc_internal(size, align);
+    void* res = kmalloc_internal(size, align);
+    kmprof_alloc((uint32_t)__builtin_return_address(0), res, size);
+    return res;
 }
 
 void kfree(void* ptr) {
     if (!ptr)
         return;
+    kmprof_free(ptr);
+
+    if (slab_owns(ptr)) {
+        slab_free(ptr);
+        return;
+    }
 
-    block_header_t* block = ((block_header_t*)ptr) - 1;
-    block->free = 1;
-
-    if (block->next && block->next->free && blocks_adjacent(block, block->next)) {
-        block_header_t* next = block->next;
-        block->size += sizeof(block_header_t) + next->size;
-        block->next = next->next;
-        if (next->next)
-            next->next->prev = block;
-        if (heap_tail == next)
-            heap_tail = block;
+    uintptr_t addr = (uintptr_t)ptr;
+    block_header_t* b = (block_header_t*)(addr - BLOCK_HDR);
+    if (!heap_arena_of(addr) || b->magic != BLOCK_MAGIC || (b->size & BLOCK_FREE)) {
+        kprintf("kfree: bad pointer %08X\n", (uint32_t)addr);
+        return;
     }
 
-    if (block->prev && block->prev->free && blocks_adjacent(block->prev, block)) {
-        block_header_t* prev = block->prev;
-        prev->size += sizeof(block_header_t) + block->size;
-        prev->next = block->next;
-        if (block->next)
-            block->next->prev = prev;
-        if (heap_tail == block)
-            heap_tail = prev;
+    uint32_t flags = irq_save();
+    heap_used -= block_size(b);
+    // 합쳐지면 앞 블록 footer와 뒤 블록 헤더 자리도 안쪽이 됨
+    uintptr_t lo = (uintptr_t)b - sizeof(block_header_t*);
+    uintptr_t hi = (uintptr_t)block_next(b) + sizeof(block_header_t);
+    block_header_t* merged = block_release(b);
+    if (heap_committed > heap_high_water)
+        heap_decommit(merged, lo, hi);
+    irq_restore(flags);
+}
+
+void kheap_set_high_water(uint32_t bytes) {
+    uint32_t flags = irq_save();
+    heap_high_water = bytes;
+    irq_restore(flags);
+}
+
+void kheap_get_stats(kheap_stats_t* out) {
+    if (!out)
+        return;
+
+    uint32_t flags = irq_save();
+    out->heap_base = (uint32_t)arenas[0].base;
+    out->heap_end = (uint32_t)arenas[0].end;
+    out->arenas = arena_count;
+    out->committed = heap_committed;
+    out->high_water = heap_high_water;
+    out->used_bytes = 0;
+    out->used_blocks = 0;
+    out->free_bytes = 0;
+    out->free_blocks = 0;
+    out->largest_free = 0;
+    out->peak_used = heap_peak_used;
+    for (uint32_t i = 0; i < KHEAP_CLASSES; i++)
+        out->free_by_class[i] = 0;
+
+    for (uint32_t i = 0; i < arena_count; i++) {
+        block_header_t* b = (block_header_t*)arenas[i].base;
+        while ((uintptr_t)b < arenas[i].curr - BLOCK_HDR) {
+            uint32_t size = block_size(b);
+            if (b->size & BLOCK_FREE) {
+                uint32_t fl, sl;
+                tlsf_mapping(size, &fl, &sl);
+                out->free_bytes += size;
+                out->free_blocks++;
+                out->free_by_class[fl]++;
+                if (size > out->largest_free)
+                    out->largest_free = size;
+            } else {
+                out->used_bytes += size;
+                out->used_blocks++;
+            }
+            b = block_next(b);
+        }
     }
+    irq_restore(flags);
+}
+
+uint32_t kheap_class_min_size(uint32_t cls) {
+    return cls == 0 ? 0 : (1u << (cls + TLSF_FL_SHIFT));
 }
 
-void memory_copy(uint8_t* src, uint8_t* dest, int nbytes) { 
-    for (int i = 0; i < nbytes; i++) dest[i] = src[i];
+void memory_copy(uint8_t* src, uint8_t* dest, int nbytes) {
+    // 화면 스크롤처럼 겹치는 구간에도 쓰임
+    if (nbytes > 0)
+        memmove(dest, src, (size_t)nbytes);
 }
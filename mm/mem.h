@@ -8,6 +8,35 @@ void* kmalloc(size_t size, int align, uint32_t* phys_addr);
 void kfree(void* ptr);
 void* kmalloc_aligned(size_t size, size_t align);
 
+// 첫 힙(기본 0xC1000000부터 64MB)이 차면 이 창에서 아레나를 하나씩 더 붙임
+// (프레임버퍼/MMIO가 이미 매핑된 칸은 건너뜀, LIMIT 위는 TEMP_MAP과 페이지 디렉터리 자리)
+#define KHEAP_ARENA_START 0xD0000000u
+#define KHEAP_ARENA_LIMIT 0xFC000000u
+#define KHEAP_ARENA_SIZE  (64u * 1024u * 1024u)
+#define KHEAP_MAX_ARENAS  5
+
+// 블록 힙 free 리스트 1단계 구간 수 (0: 256B 미만, n: 2^(n+7) 이상)
+#define KHEAP_CLASSES 25
+
+typedef struct {
+    uint32_t heap_base;
+    uint32_t heap_end;
+    uint32_t arenas;
+    uint32_t committed;         // 매핑된 힙 바이트
+    uint32_t high_water;        // 매핑이 이보다 많으면 빈 페이지를 PMM에 돌려줌
+    uint32_t used_bytes;
+    uint32_t used_blocks;
+    uint32_t free_bytes;
+    uint32_t free_blocks;
+    uint32_t largest_free;
+    uint32_t peak_used;
+    uint32_t free_by_class[KHEAP_CLASSES];
+} kheap_stats_t;
+
+void kheap_get_stats(kheap_stats_t* out);
+uint32_t kheap_class_min_size(uint32_t cls);
+void kheap_set_high_water(uint32_t bytes);
+
 void  memory_copy(uint8_t* source, uint8_t* dest, int nbytes);
 
 void  memory_set(uint8_t* dest, uint8_t val, uint32_t len);
\ No newline at end of file
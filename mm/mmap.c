@@ -0,0 +1,293 @@
+// mm/mmap.c
+#include "mmap.h"
+#include "mem.h"
+#include "paging.h"
+#include "vma.h"
+#include "../fs/pagecache.h"
+#include "../fs/fscmd.h"
+#include "../libc/string.h"
+
+#define EFLAGS_IF 0x200u
+
+typedef struct {
+    bool used;
+    uint32_t pid;
+    uint32_t base;
+    uint32_t pages;
+    uint32_t flags;
+    void** slots;   // SHARED: pagecache_page_t*, PRIVATE: kmalloc 페이지
+} mmap_region_t;
+
+// 파일 매핑만 여기에 기록. 익명 매핑은 주소 공간의 VMA 표가 전부라서
+// fork로 넘겨받은 영역도 자식의 VMA 표에서 그대로 찾고 놓을 수 있음
+
+static mmap_region_t mmap_regions[MMAP_MAX_REGIONS];
+
+static inline uint32_t irq_save(void) {
+    uint32_t flags = 0;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+static void mmap_release_slots(mmap_region_t* r) {
+    if (!r->slots) {
+        return;
+    }
+    for (uint32_t i = 0; i < r->pages; i++) {
+        if (!r->slots[i]) {
+            continue;
+        }
+        if (r->flags & MMAP_SHARED) {
+            pagecache_put((pagecache_page_t*)r->slots[i]);
+        } else {
+            kfree(r->slots[i]);
+        }
+    }
+    kfree(r->slots);
+    r->slots = NULL;
+}
+
+static bool mmap_overlaps(uint32_t pid, uint32_t base, uint32_t size, uint32_t* out_end) {
+    for (int i = 0; i < MMAP_MAX_REGIONS; i++) {
+        const mmap_region_t* r = &mmap_regions[i];
+        if (!r->used || r->pid != pid) {
+            continue;
+        }
+        uint32_t r_end = r->base + r->pages * PAGE_SIZE;
+        if (base < r_end && r->base < base + size) {
+            *out_end = r_end;
+            return true;
+        }
+    }
+    return false;
+}
+
+// 현재 주소 공간 기준: 파일 매핑 기록과 VMA(익명 매핑, 합쳐진 brk 포함)를 모두 피함
+static uint32_t mmap_find_gap(uint32_t pid, uint32_t size) {
+    uint32_t base = USER_MMAP_BASE;
+    for (;;) {
+        if (base + size < base || base + size > USER_MMAP_END) {
+            return 0;
+        }
+        uint32_t next = 0;
+        if (!mmap_overlaps(pid, base, size, &next) &&
+            !vma_overlaps(base, base + size, &next)) {
+            return base;
+        }
+        base = (next + PAGE_SIZE - 1u) & ~(PAGE_SIZE - 1u);
+    }
+}
+
+uint32_t mmap_file(uint32_t pid, const char* path, uint32_t offset, uint32_t length,
+                   uint32_t prot, uint32_t flags) {
+    if (!path || length == 0 || (offset & (PAGE_SIZE - 1u)) != 0) {
+        return 0;
+    }
+    if ((flags & (MMAP_SHARED | MMAP_PRIVATE)) == 0 ||
+        (flags & (MMAP_SHARED | MMAP_PRIVATE)) == (MMAP_SHARED | MMAP_PRIVATE)) {
+        return 0;
+    }
+    // 공유 매핑은 write-back 경로가 없으므로 읽기 전용만 허용
+    if ((flags & MMAP_SHARED) && (prot & MMAP_PROT_WRITE)) {
+        return 0;
+    }
+
+    if (length > USER_MMAP_END - USER_MMAP_BASE) {
+        return 0;
+    }
+
+    // 파일 끝을 넘어서는 페이지는 매핑하지 않음 (마지막 페이지 꼬리는 0)
+    uint32_t file_size = fscmd_get_file_size(path);
+    if (offset >= file_size) {
+        return 0;
+    }
+    uint32_t pages = (length + PAGE_SIZE - 1u) / PAGE_SIZE;
+    if (pages > (file_size - offset + PAGE_SIZE - 1u) / PAGE_SIZE) {
+        return 0;
+    }
+
+    mmap_region_t* r = NULL;
+    for (int i = 0; i < MMAP_MAX_REGIONS; i++) {
+        if (!mmap_regions[i].used) {
+            r = &mmap_regions[i];
+            break;
+        }
+    }
+    if (!r) {
+        return 0;
+    }
+
+    uint32_t base = mmap_find_gap(pid, pages * PAGE_SIZE);
+    if (base == 0) {
+        return 0;
+    }
+
+    void** slots = (void**)kmalloc(pages * sizeof(void*), 0, NULL);
+    if (!slots) {
+        return 0;
+    }
+    memset(slots, 0, pages * sizeof(void*));
+
+    r->used = true;
+    r->pid = pid;
+    r->base = base;
+    r->pages = pages;
+    r->flags = flags;
+    r->slots = slots;
+
+    uint32_t first = offset / PAGE_SIZE;
+    for (uint32_t i = 0; i < pages; i++) {
+        pagecache_page_t* page = pagecache_get(path, first + i);
+        if (!page) {
+            goto fail;
+        }
+
+        uint32_t phys = 0;
+        uint32_t pte_flags = PAGE_PRESENT | PAGE_USER;
+        if (flags & MMAP_SHARED) {
+            slots[i] = page;
+            phys = pagecache_page_phys(page);
+        } else {
+            uint8_t* copy = (uint8_t*)kmalloc(PAGE_SIZE, 1, &phys);
+            if (!copy) {
+                pagecache_put(page);
+                goto fail;
+            }
+            memcpy(copy, pagecache_page_data(page), PAGE_SIZE);
+            pagecache_put(page);
+            slots[i] = copy;
+            if (prot & MMAP_PROT_WRITE) {
+                pte_flags |= PAGE_RW;
+            }
+        }
+        vmm_map_page(base + i * PAGE_SIZE, phys, pte_flags);
+    }
+    return base;
+
+fail:
+    for (uint32_t i = 0; i < pages; i++) {
+        if (slots[i]) {
+            vmm_unmap_page(base + i * PAGE_SIZE);
+        }
+    }
+    mmap_release_slots(r);
+    memset(r, 0, sizeof(*r));
+    return 0;
+}
+
+uint32_t mmap_anon(uint32_t pid, uint32_t length, uint32_t prot) {
+    if (length == 0 || length > USER_MMAP_END - USER_MMAP_BASE) {
+        return 0;
+    }
+    uint32_t pages = (length + PAGE_SIZE - 1u) / PAGE_SIZE;
+
+    uint32_t base = mmap_find_gap(pid, pages * PAGE_SIZE);
+    if (base == 0) {
+        return 0;
+    }
+    uint32_t pte_flags = PAGE_PRESENT | PAGE_USER;
+    if (prot & MMAP_PROT_WRITE) {
+        pte_flags |= PAGE_RW;
+    }
+    if (vma_map(base, base + pages * PAGE_SIZE, pte_flags, NULL, NULL) != 0) {
+        return 0;
+    }
+    return base;
+}
+
+uint32_t mmap_brk(uint32_t cur, uint32_t want) {
+    if (want < USER_BRK_BASE || want > USER_BRK_END) {
+        return cur;
+    }
+    uint32_t old_end = (cur + PAGE_SIZE - 1u) & ~(PAGE_SIZE - 1u);
+    uint32_t new_end = (want + PAGE_SIZE - 1u) & ~(PAGE_SIZE - 1u);
+    if (new_end > old_end) {
+        if (vma_map(old_end, new_end, PAGE_PRESENT | PAGE_RW | PAGE_USER, NULL, NULL) != 0) {
+            return cur;
+        }
+    } else if (new_end < old_end) {
+        if (vma_unmap(paging_current_dir_phys(), new_end, old_end) != 0) {
+            return cur;
+        }
+        vmm_unmap_user_range(new_end, old_end);
+    }
+    return want;
+}
+
+int mmap_unmap(uint32_t pid, uint32_t addr, uint32_t length) {
+    for (int i = 0; i < MMAP_MAX_REGIONS; i++) {
+        mmap_region_t* r = &mmap_regions[i];
+        if (!r->used || r->pid != pid || r->base != addr) {
+            continue;
+        }
+        // 부분 해제는 지원하지 않음
+        if (length != 0 && (length + PAGE_SIZE - 1u) / PAGE_SIZE != r->pages) {
+            return -1;
+        }
+        uint32_t flags = irq_save();
+        for (uint32_t p = 0; p < r->pages; p++) {
+            vmm_unmap_page(r->base + p * PAGE_SIZE);
+        }
+        irq_restore(flags);
+        mmap_release_slots(r);
+        memset(r, 0, sizeof(*r));
+        return 0;
+    }
+
+    // 익명 매핑: mmap 구간 안에서 익명 VMA로 덮인 범위만 놓음
+    if ((addr & (PAGE_SIZE - 1u)) != 0 || length == 0 || addr < USER_MMAP_BASE ||
+        length > USER_MMAP_END - addr) {
+        return -1;
+    }
+    uint32_t end = (addr + length + PAGE_SIZE - 1u) & ~(PAGE_SIZE - 1u);
+    if (!vma_covers_anon(addr, end)) {
+        return -1;
+    }
+    // 이웃 익명 영역과 합쳐져 있으면 가운데를 떼야 하므로 실패할 수 있음
+    if (vma_unmap(paging_current_dir_phys(), addr, end) != 0) {
+        return -1;
+    }
+    vmm_unmap_user_range(addr, end);
+    return 0;
+}
+
+// exec 때 현재(= pid의) 주소 공간에서 호출: 파일 매핑과 익명 매핑을 모두 걷어냄
+void mmap_release_current(uint32_t pid) {
+    for (int i = 0; pid != 0 && i < MMAP_MAX_REGIONS; i++) {
+        mmap_region_t* r = &mmap_regions[i];
+        if (!r->used || r->pid != pid) {
+            continue;
+        }
+        uint32_t flags = irq_save();
+        for (uint32_t p = 0; p < r->pages; p++) {
+            vmm_unmap_page(r->base + p * PAGE_SIZE);
+        }
+        irq_restore(flags);
+        mmap_release_slots(r);
+        memset(r, 0, sizeof(*r));
+    }
+    // 익명 영역은 구간 안쪽을 통째로 떼므로 가운데가 잘릴 일은 없음
+    vma_unmap(paging_current_dir_phys(), USER_MMAP_BASE, USER_MMAP_END);
+    vmm_unmap_user_range(USER_MMAP_BASE, USER_MMAP_END);
+}
+
+// 프로세스 종료 시 호출: 페이지 디렉터리는 함께 버려지므로 참조만 정리
+void mmap_release_pid(uint32_t pid) {
+    if (pid == 0) {
+        return;
+    }
+    for (int i = 0; i < MMAP_MAX_REGIONS; i++) {
+        mmap_region_t* r = &mmap_regions[i];
+        if (!r->used || r->pid != pid) {
+            continue;
+        }
+        mmap_release_slots(r);
+        memset(r, 0, sizeof(*r));
+    }
+}
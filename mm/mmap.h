@@ -0,0 +1,30 @@
+// mm/mmap.h
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// 유저 mmap 영역 (USER_STACK_TOP 아래, PIE 이미지 영역 위쪽)
+#define USER_MMAP_BASE 0xA0000000u
+#define USER_MMAP_END  0xBF000000u
+#define MMAP_MAX_REGIONS 64
+
+#define MMAP_PROT_READ  0x1u
+#define MMAP_PROT_WRITE 0x2u
+
+#define MMAP_SHARED  0x1u   // 페이지 캐시 페이지를 읽기 전용으로 공유
+#define MMAP_PRIVATE 0x2u   // 프로세스 전용 사본 (쓰기 가능)
+#define MMAP_ANON    0x4u   // 파일 없이 처음 접근할 때 0으로 채운 페이지
+
+// brk 힙 (ELF 이미지 영역 위, mmap 영역 아래)
+#define USER_BRK_BASE  0x40000000u
+#define USER_BRK_END   USER_MMAP_BASE
+
+uint32_t mmap_file(uint32_t pid, const char* path, uint32_t offset, uint32_t length,
+                   uint32_t prot, uint32_t flags);
+uint32_t mmap_anon(uint32_t pid, uint32_t length, uint32_t prot);
+int mmap_unmap(uint32_t pid, uint32_t addr, uint32_t length);
+// 현재 주소 공간의 brk를 cur에서 want로 옮김. 실패하면 cur를 그대로 돌려줌
+uint32_t mmap_brk(uint32_t cur, uint32_t want);
+// exec 때 현재 주소 공간의 mmap 영역을 모두 놓음
+void mmap_release_current(uint32_t pid);
+void mmap_release_pid(uint32_t pid);
@@ -1,6 +1,7 @@
 #include "paging.h"
 #include "pmm.h"
 #include "mem.h"
+#include "vma.h"
 #include "../drivers/screen.h"
 #include "../libc/string.h"
 #include <stddef.h>
@@ -9,13 +10,37 @@
 #define PAGE_SIZE     4096
 #define RECURSIVE_PT_BASE 0xFFC00000u
 #define RECURSIVE_PD_BASE 0xFFFFF000u
+#define TEMP_MAP_VA       0xFFBFF000u   // PDE 1022 마지막 페이지. 모든 주소 공간이 같은 테이블을 공유
+#define USER_PDE_END      768u          // 0xC0000000 아래가 유저 영역
+#define LOW_IDENTITY_PDES 16u           // 0~64MB 아이덴티티 매핑
+#define LOW_IDENTITY_END  0x04000000u
+#define EFLAGS_IF 0x200u
 #define MSR_IA32_PAT 0x277u
 #define PAT_TYPE_WC 0x01u
 
+#define CPUID_FEAT_EDX_PSE (1u << 3)
 #define CPUID_FEAT_EDX_MSR (1u << 5)
+#define CPUID_FEAT_EDX_PGE (1u << 13)
 #define CPUID_FEAT_EDX_PAT (1u << 16)
+#define CR4_PSE            (1u << 4)
+#define CR4_PGE            (1u << 7)
 
 static bool g_pat_wc_enabled = false;
+static bool g_global_pages = false;
+static bool g_large_pages = false;
+static uint32_t g_user_dirs = 0;        // 살아 있는 유저 디렉터리 수
+
+static inline uint32_t irq_save(void) {
+    uint32_t flags = 0;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
 
 static inline void cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx,
                          uint32_t* ecx, uint32_t* edx) {
@@ -51,6 +76,23 @@ static void paging_init_pat(void) {
     g_pat_wc_enabled = true;
 }
 
+// 커널 영역(PDE 768~1022)은 모든 주소 공간이 같은 페이지 테이블을 쓰므로 Global로 두면
+// 문맥 전환 때 CR3를 다시 올려도 커널 TLB 항목이 남음. 해제는 invlpg가 Global도 비움.
+// PSE가 있으면 크고 연속인 커널 구간은 4MB 페이지 하나로 매핑
+static void paging_detect_features(void) {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    g_global_pages = (edx & CPUID_FEAT_EDX_PGE) != 0;
+    g_large_pages = (edx & CPUID_FEAT_EDX_PSE) != 0;
+}
+
+static void set_cr4(uint32_t bits) {
+    uint32_t cr4;
+    asm volatile("mov %%cr4, %0" : "=r"(cr4));
+    cr4 |= bits;
+    asm volatile("mov %0, %%cr4" :: "r"(cr4) : "memory");
+}
+
 static inline int paging_is_enabled(void) {
     uint32_t cr0;
     asm volatile("mov %%cr0, %0" : "=r"(cr0));
@@ -76,6 +118,11 @@ void dump_mapping(uint32_t addr) {
         kprintf("[MAP] %08x: PDE[%u] not present (%08x)\n", addr, dir_idx, pde);
         return;
     }
+    if (pde & PDE_PS) {
+        kprintf("[MAP] %08x -> %08x (4MB PDE=%08x)\n",
+                addr, (pde & 0xFFC00000u) | (addr & 0x3FFFFFu), pde);
+        return;
+    }
 
     uint32_t* pt = (uint32_t*)(RECURSIVE_PT_BASE + dir_idx * PAGE_SIZE);
     uint32_t pte = pt[table_idx];
@@ -99,21 +146,80 @@ static uint32_t kernel_page_directory_phys = 0;
 static void load_pd(uint32_t* pd){
     asm volatile("mov %0, %%cr3"::"r"(pd));
 }
+// PG + WP: 커널 쓰기도 읽기 전용 유저 페이지에서 폴트가 나야 COW가 동작함
 static void enable_pg(){
     asm volatile(
         "mov %cr0, %eax\n"
-        "or  $0x80000000, %eax\n"
+        "or  $0x80010000, %eax\n"
         "mov %eax, %cr0\n"
     );
 }
 
+static void* temp_map(uint32_t phys);
+static void temp_unmap(void);
+
+// 유저 디렉터리의 0~64MB는 커널의 페이지 테이블(또는 4MB PDE)을 그대로 가리킴
+static bool low_table_shared(const uint32_t* dir, uint32_t dir_idx) {
+    if (dir == kernel_page_directory || dir_idx >= LOW_IDENTITY_PDES)
+        return false;
+    return (dir[dir_idx] & PDE_PS) ||
+           (dir[dir_idx] & 0xFFFFF000u) == (kernel_page_directory[dir_idx] & 0xFFFFF000u);
+}
+
+// dir_idx 구간에 4KB 매핑을 넣기 전에 그 주소 공간 전용 페이지 테이블로 바꿈.
+// 4MB 페이지는 같은 내용의 4KB 항목으로 쪼개고, 공유 중인 커널 테이블은 복사.
+// 커널 영역 PDE는 모든 주소 공간에 복사돼 있고 Global 큰 페이지는 다른 주소 공간의
+// TLB에도 남으므로 쪼개지 않음
+static bool make_private_table(uint32_t* dir, uint32_t dir_idx) {
+    uint32_t pde = dir[dir_idx];
+    bool large = (pde & PDE_PS) != 0;
+    bool paged = paging_is_enabled();
+    if (dir_idx >= LOW_IDENTITY_PDES || (large && (pde & PAGE_GLOBAL)) ||
+        (!large && dir != current_page_directory)) {
+        kprintf("[VMM] cannot make private table at %08x\n", dir_idx << 22);
+        return false;
+    }
+    uint32_t table_phys = (uint32_t)pmm_alloc_page();
+    if (!table_phys) {
+        kprint("[VMM] Out of memory allocating page table\n");
+        return false;
+    }
+
+    uint32_t flags = pde & (PAGE_PRESENT | PAGE_RW | PAGE_USER | PAGE_PWT | PAGE_PCD);
+    if (pde & PDE_PAT)
+        flags |= PAGE_PAT;
+    uint32_t base = pde & 0xFFC00000u;
+
+    uint32_t irq = irq_save();
+    uint32_t* table = paged ? (uint32_t*)temp_map(table_phys) : (uint32_t*)table_phys;
+    if (large) {
+        for (uint32_t i = 0; i < 1024; i++)
+            table[i] = (base + i * PAGE_SIZE) | flags;
+    } else {
+        memcpy(table, (const void*)(RECURSIVE_PT_BASE + dir_idx * PAGE_SIZE), PAGE_SIZE);
+    }
+    if (paged)
+        temp_unmap();
+    dir[dir_idx] = table_phys | (pde & (PAGE_PRESENT | PAGE_RW | PAGE_USER));
+    // 옛 큰 페이지 항목과 재귀 매핑 창의 옛 항목을 같이 비움
+    if (paged && dir == current_page_directory)
+        load_pd((uint32_t*)current_page_directory_phys);
+    irq_restore(irq);
+    return true;
+}
+
 void map_page(uint32_t* dir, uint32_t virt, uint32_t phys, uint32_t flags) {
     uint32_t dir_idx   = virt >> 22;
     uint32_t table_idx = (virt >> 12) & 0x3FF;
 
+    if ((dir[dir_idx] & PAGE_PRESENT) &&
+        ((dir[dir_idx] & PDE_PS) || low_table_shared(dir, dir_idx)) &&
+        !make_private_table(dir, dir_idx))
+        return;
+
     // 이미 PDE가 있으면 그대로 사용
     if (!(dir[dir_idx] & PAGE_PRESENT)) {
-        uint32_t new_table_phys = (uint32_t)pmm_alloc_page();
+        uint32_t new_table_phys = (uint32_t)pmm_alloc_zeroed_page();
         if (!new_table_phys) {
             kprint("[VMM] Out of memory allocating page table\n");
             return;
@@ -121,13 +227,6 @@ void map_page(uint32_t* dir, uint32_t virt, uint32_t phys, uint32_t flags) {
         dir[dir_idx] = (new_table_phys & 0xFFFFF000u) | PAGE_PRESENT | PAGE_RW;
         if (flags & PAGE_USER)
             dir[dir_idx] |= PAGE_USER;
-
-        if (paging_is_enabled()) {
-            uint32_t* table = (uint32_t*)(RECURSIVE_PT_BASE + dir_idx * PAGE_SIZE);
-            memset(table, 0, PAGE_SIZE);
-        } else {
-            memset((void*)new_table_phys, 0, PAGE_SIZE);
-        }
     } else if (flags & PAGE_USER) {
         dir[dir_idx] |= PAGE_USER;
     }
@@ -138,6 +237,8 @@ void map_page(uint32_t* dir, uint32_t virt, uint32_t phys, uint32_t flags) {
     } else {
         table = (uint32_t*)(dir[dir_idx] & 0xFFFFF000u);
     }
+    if (g_global_pages && virt >= KERNEL_SPACE_START && !(flags & PAGE_USER))
+        flags |= PAGE_GLOBAL;
     table[table_idx] = (phys & 0xFFFFF000) | flags;
 }
 
@@ -145,33 +246,45 @@ void paging_init() {
     memset(page_directory,   0, sizeof(page_directory));
     memset(first_page_table, 0, sizeof(first_page_table));
     paging_init_pat();
+    paging_detect_features();
 
-    // ──────────────────────────────
-    // 1) 0 ~ 4MB를 first_page_table로 직접 아이덴티티 매핑
-    // ──────────────────────────────
-    for (uint32_t addr = 0; addr < 0x00400000; addr += PAGE_SIZE) {
-        // PTE index = addr >> 12
-        first_page_table[addr >> 12] =
-            (addr & 0xFFFFF000) | PAGE_PRESENT | PAGE_RW;
-    }
-    // PDE[0] = first_page_table
-    page_directory[0] = ((uint32_t)first_page_table) | PAGE_PRESENT | PAGE_RW;
+    extern uint32_t _kernel_start, _kernel_end;
+    uint32_t kstart = (uint32_t)&_kernel_start;
+    uint32_t kend   = (uint32_t)&_kernel_end;
 
-    // ──────────────────────────────
-    // 2) 4MB ~ 64MB는 기존 map_page + pmm_alloc_page로
-    //    (원하면 이 부분은 나중에 디버그 후 키우자)
-    // ──────────────────────────────
-    for (uint32_t addr = 0x00400000; addr < 0x04000000; addr += PAGE_SIZE) {
-        map_page(page_directory, addr, addr, PAGE_PRESENT | PAGE_RW);
+    if (g_large_pages) {
+        // 0~64MB 아이덴티티는 4MB 페이지 16개. 커널 이미지가 있는 첫 4MB에는 유저 페이지가
+        // 올라오지 않으므로 Global, 나머지는 유저 매핑이 들어오면 그 주소 공간에서 쪼갬
+        for (uint32_t i = 0; i < LOW_IDENTITY_PDES; i++)
+            page_directory[i] = (i * LARGE_PAGE_SIZE) | PAGE_PRESENT | PAGE_RW | PDE_PS;
+        if (g_global_pages && kend <= LARGE_PAGE_SIZE)
+            page_directory[0] |= PAGE_GLOBAL;
+    } else {
+        // ──────────────────────────────
+        // 1) 0 ~ 4MB를 first_page_table로 직접 아이덴티티 매핑
+        // ──────────────────────────────
+        for (uint32_t addr = 0; addr < 0x00400000; addr += PAGE_SIZE) {
+            // PTE index = addr >> 12
+            first_page_table[addr >> 12] =
+                (addr & 0xFFFFF000) | PAGE_PRESENT | PAGE_RW;
+            // 커널 이미지는 PMM이 예약해 유저 페이지가 올라오지 않으므로 Global
+            if (g_global_pages && addr >= (kstart & 0xFFFFF000u) && addr < kend)
+                first_page_table[addr >> 12] |= PAGE_GLOBAL;
+        }
+        // PDE[0] = first_page_table
+        page_directory[0] = ((uint32_t)first_page_table) | PAGE_PRESENT | PAGE_RW;
+
+        // ──────────────────────────────
+        // 2) 4MB ~ 64MB는 기존 map_page + pmm_alloc_page로
+        // ──────────────────────────────
+        for (uint32_t addr = 0x00400000; addr < 0x04000000; addr += PAGE_SIZE) {
+            map_page(page_directory, addr, addr, PAGE_PRESENT | PAGE_RW);
+        }
     }
 
     // ──────────────────────────────
     // 3) 커널 high-mapping (0xC0000000~)는 기존 코드 그대로
     // ──────────────────────────────
-    extern uint32_t _kernel_start, _kernel_end;
-    uint32_t kstart = (uint32_t)&_kernel_start;
-    uint32_t kend   = (uint32_t)&_kernel_end;
-
     for (uint32_t addr = kstart; addr < kend; addr += PAGE_SIZE) {
         uint32_t offset = addr - kstart;
         map_page(page_directory,
@@ -198,8 +311,12 @@ void paging_init() {
         memset((void*)table_phys, 0, PAGE_SIZE);
     }
 
+    if (g_large_pages)
+        set_cr4(CR4_PSE);
     load_pd(page_directory);
     enable_pg();
+    if (g_global_pages)
+        set_cr4(CR4_PGE);
 
     kernel_page_directory = page_directory;
     kernel_page_directory_phys = (uint32_t)page_directory;
@@ -244,6 +361,60 @@ int vmm_map_range_alloc(uint32_t virt, size_t size, uint32_t flags) {
     return 0;
 }
 
+// 커널 영역 PDE는 유저 디렉터리가 만들어질 때 값으로 복사되므로, 큰 페이지로 바꾸는 것은
+// 유저 디렉터리가 하나도 없을 때(부팅 중)만 가능. 원래 있던 빈 페이지 테이블은 반환
+static bool map_large_page(uint32_t virt, uint32_t phys, uint32_t flags) {
+    uint32_t dir_idx = virt >> 22;
+    if (!g_large_pages || g_user_dirs != 0 || !paging_is_enabled() ||
+        current_page_directory != kernel_page_directory ||
+        dir_idx < USER_PDE_END || dir_idx >= (TEMP_MAP_VA >> 22)) {
+        return false;
+    }
+    uint32_t pde = kernel_page_directory[dir_idx];
+    if ((pde & PAGE_PRESENT) && !(pde & PDE_PS)) {
+        uint32_t* pt = (uint32_t*)(RECURSIVE_PT_BASE + dir_idx * PAGE_SIZE);
+        for (uint32_t i = 0; i < 1024; i++) {
+            if (pt[i])
+                return false;
+        }
+    }
+
+    uint32_t large = phys | PDE_PS | (flags & (PAGE_PRESENT | PAGE_RW | PAGE_PWT | PAGE_PCD));
+    if (flags & PAGE_PAT)
+        large |= PDE_PAT;
+    if (g_global_pages)
+        large |= PAGE_GLOBAL;
+
+    kernel_page_directory[dir_idx] = large;
+    invlpg(virt);
+    invlpg(RECURSIVE_PT_BASE + dir_idx * PAGE_SIZE);
+    if ((pde & PAGE_PRESENT) && !(pde & PDE_PS))
+        pmm_free_page((void*)(pde & 0xFFFFF000u));
+    return true;
+}
+
+int vmm_map_range(uint32_t virt, uint32_t phys, uint32_t size, uint32_t flags) {
+    if (size == 0)
+        return 0;
+    uint32_t pages = (size + (virt & 0xFFFu) + 0xFFFu) / PAGE_SIZE;
+    virt &= 0xFFFFF000u;
+    phys &= 0xFFFFF000u;
+
+    uint32_t i = 0;
+    while (i < pages) {
+        uint32_t va = virt + i * PAGE_SIZE;
+        uint32_t pa = phys + i * PAGE_SIZE;
+        if (pages - i >= 1024u && !(va & (LARGE_PAGE_SIZE - 1u)) &&
+            !(pa & (LARGE_PAGE_SIZE - 1u)) && map_large_page(va, pa, flags)) {
+            i += 1024u;
+            continue;
+        }
+        vmm_map_page(va, pa, flags);
+        i++;
+    }
+    return 0;
+}
+
 int vmm_virt_to_phys(uint32_t virt, uint32_t* out_phys) {
     if (!out_phys)
         return -1;
@@ -260,6 +431,10 @@ int vmm_virt_to_phys(uint32_t virt, uint32_t* out_phys) {
     uint32_t pde = pd[dir_idx];
     if (!(pde & PAGE_PRESENT))
         return -1;
+    if (pde & PDE_PS) {
+        *out_phys = (pde & 0xFFC00000u) | (virt & 0x3FFFFFu);
+        return 0;
+    }
 
     uint32_t* pt = (uint32_t*)(RECURSIVE_PT_BASE + dir_idx * PAGE_SIZE);
     uint32_t pte = pt[table_idx];
@@ -270,6 +445,26 @@ int vmm_virt_to_phys(uint32_t virt, uint32_t* out_phys) {
     return 0;
 }
 
+int vmm_unmap_page(uint32_t virt) {
+    if (!paging_is_enabled())
+        return -1;
+
+    uint32_t dir_idx   = virt >> 22;
+    uint32_t table_idx = (virt >> 12) & 0x3FF;
+
+    uint32_t* pd = (uint32_t*)RECURSIVE_PD_BASE;
+    if (!(pd[dir_idx] & PAGE_PRESENT) || (pd[dir_idx] & PDE_PS))
+        return -1;
+
+    uint32_t* pt = (uint32_t*)(RECURSIVE_PT_BASE + dir_idx * PAGE_SIZE);
+    if (!(pt[table_idx] & PAGE_PRESENT))
+        return -1;
+
+    pt[table_idx] = 0;
+    invlpg(virt);
+    return 0;
+}
+
 int vmm_mark_user_range(uint32_t virt, size_t size) {
     if (size == 0)
         return 0;
@@ -311,51 +506,272 @@ void paging_set_current_dir(uint32_t* dir, uint32_t phys) {
     load_pd((uint32_t*)phys);
 }
 
+// 반납된 유저 디렉터리. 유저 영역 PDE는 반납할 때 비워 두므로 꺼내서 커널 쪽만 다시 채움
+#define PGDIR_POOL_MAX 16
+static uint32_t* pgdir_pool[PGDIR_POOL_MAX];
+static uint32_t pgdir_pool_phys[PGDIR_POOL_MAX];
+static uint32_t pgdir_pool_count = 0;
+
 uint32_t* paging_create_user_dir(uint32_t* out_phys) {
     uint32_t phys = 0;
-    uint32_t* dir = (uint32_t*)kmalloc(PAGE_SIZE, PAGE_SIZE, &phys);
+    uint32_t* dir = NULL;
+    uint32_t irq = irq_save();
+    if (pgdir_pool_count) {
+        pgdir_pool_count--;
+        dir = pgdir_pool[pgdir_pool_count];
+        phys = pgdir_pool_phys[pgdir_pool_count];
+    }
+    irq_restore(irq);
     if (!dir) {
+        dir = (uint32_t*)kmalloc(PAGE_SIZE, PAGE_SIZE, &phys);
+        if (!dir) {
+            return NULL;
+        }
+        memset(dir, 0, PAGE_SIZE);
+    }
+
+    // 0~64MB 아이덴티티는 커널 페이지 테이블을 그대로 공유하고, 유저 페이지가 들어올 때만
+    // map_page가 그 주소 공간 전용 사본을 만듦
+    for (uint32_t i = 0; i < LOW_IDENTITY_PDES; i++) {
+        dir[i] = kernel_page_directory[i] & ~PAGE_USER;
+    }
+    for (uint32_t i = 768; i < 1023; i++) {
+        dir[i] = kernel_page_directory[i];
+    }
+    dir[1023] = (phys & 0xFFFFF000u) | PAGE_PRESENT | PAGE_RW;
+    g_user_dirs++;
+
+    if (out_phys) {
+        *out_phys = phys;
+    }
+    return dir;
+}
+
+// 현재 주소 공간의 PTE 위치. 페이지 테이블이 없으면 NULL
+static uint32_t* pte_lookup(uint32_t virt) {
+    uint32_t* pd = (uint32_t*)RECURSIVE_PD_BASE;
+    if (!(pd[virt >> 22] & PAGE_PRESENT) || (pd[virt >> 22] & PDE_PS))
         return NULL;
+    uint32_t* pt = (uint32_t*)(RECURSIVE_PT_BASE + (virt >> 22) * PAGE_SIZE);
+    return &pt[(virt >> 12) & 0x3FF];
+}
+
+// 물리 페이지를 잠깐 커널 주소에 붙임. 인터럽트를 끈 상태에서만 사용
+static void* temp_map(uint32_t phys) {
+    uint32_t* pte = pte_lookup(TEMP_MAP_VA);
+    *pte = (phys & 0xFFFFF000u) | PAGE_PRESENT | PAGE_RW;
+    invlpg(TEMP_MAP_VA);
+    return (void*)TEMP_MAP_VA;
+}
+
+static void temp_unmap(void) {
+    *pte_lookup(TEMP_MAP_VA) = 0;
+    invlpg(TEMP_MAP_VA);
+}
+
+void paging_zero_frame(uint32_t phys) {
+    if (!paging_is_enabled()) {
+        memset((void*)phys, 0, PAGE_SIZE);
+        return;
+    }
+    uint32_t irq = irq_save();
+    memset(temp_map(phys), 0, PAGE_SIZE);
+    temp_unmap();
+    irq_restore(irq);
+}
+
+static void release_user_pte(uint32_t* pte, uint32_t virt) {
+    uint32_t old = *pte;
+    // 0~64MB는 커널 아이덴티티 매핑 사본이므로 원래대로 돌려 둠
+    *pte = virt < LOW_IDENTITY_END ? (virt | PAGE_PRESENT | PAGE_RW) : 0;
+    invlpg(virt);
+    if ((old & PAGE_PRESENT) && (old & PAGE_ANON))
+        pmm_page_unref(old & 0xFFFFF000u);
+}
+
+// 0으로 채워진 새 페이지에 src가 있으면 len 바이트를 복사한 뒤 유저 주소에 붙임.
+// 기존 익명 페이지가 있으면 그 참조를 놓음
+static int map_user_frame(uint32_t virt, uint32_t flags, const void* src, uint32_t len) {
+    uint32_t phys = (uint32_t)pmm_alloc_zeroed_page();
+    if (!phys)
+        return -1;
+    virt &= 0xFFFFF000u;
+
+    uint32_t irq = irq_save();
+    if (src && len) {
+        memcpy(temp_map(phys), src, len);
+        temp_unmap();
+    }
+    uint32_t* pte = pte_lookup(virt);
+    if (pte && (*pte & PAGE_PRESENT) && (*pte & PAGE_ANON))
+        release_user_pte(pte, virt);
+    pmm_page_ref(phys);
+    vmm_map_page(virt, phys, flags | PAGE_ANON);
+    irq_restore(irq);
+    return 0;
+}
+
+int vmm_map_user_page(uint32_t virt, uint32_t flags) {
+    return map_user_frame(virt, flags, NULL, 0);
+}
+
+int vmm_map_user_copy(uint32_t virt, const void* src, uint32_t size, uint32_t flags) {
+    const uint8_t* p = (const uint8_t*)src;
+    for (uint32_t off = 0; off < size; off += PAGE_SIZE) {
+        uint32_t len = size - off < PAGE_SIZE ? size - off : PAGE_SIZE;
+        if (map_user_frame(virt + off, flags, p + off, len) != 0)
+            return -1;
     }
-    memset(dir, 0, PAGE_SIZE);
+    return 0;
+}
+
+void vmm_unmap_user_range(uint32_t start, uint32_t end) {
+    start &= 0xFFFFF000u;
+    if (end > KERNEL_SPACE_START)
+        end = KERNEL_SPACE_START;
+    uint32_t irq = irq_save();
+    for (uint32_t virt = start; virt < end && virt >= start; virt += PAGE_SIZE) {
+        uint32_t* pte = pte_lookup(virt);
+        if (pte && (*pte & PAGE_PRESENT) && (*pte & PAGE_ANON))
+            release_user_pte(pte, virt);
+    }
+    irq_restore(irq);
+}
 
-    uint32_t* prev_dir = paging_current_dir();
-    uint32_t prev_phys = paging_current_dir_phys();
-    uint32_t low_tables[16] = {0};
+// 현재(부모) 주소 공간의 익명 페이지를 dst에 읽기 전용으로 공유.
+// 쓰기 가능하던 페이지는 양쪽 모두 PAGE_COW로 표시해 첫 쓰기 때 복사
+int paging_clone_user_space(uint32_t* dst_dir, uint32_t dst_phys) {
+    // 아직 채워지지 않은 영역은 자식도 처음 접근할 때 따로 채움
+    if (vma_clone(current_page_directory_phys, dst_phys) != 0)
+        return -1;
 
-    paging_set_current_dir(kernel_page_directory, kernel_page_directory_phys);
-    for (uint32_t i = 0; i < 16; i++) {
-        if (!(kernel_page_directory[i] & PAGE_PRESENT)) {
+    uint32_t* pd = (uint32_t*)RECURSIVE_PD_BASE;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < USER_PDE_END; i++) {
+        if (!(pd[i] & PAGE_PRESENT) || (pd[i] & PDE_PS))
             continue;
+        uint32_t* pt = (uint32_t*)(RECURSIVE_PT_BASE + i * PAGE_SIZE);
+        for (uint32_t j = 0; j < 1024; j++) {
+            if ((pt[j] & PAGE_PRESENT) && (pt[j] & PAGE_ANON))
+                count++;
         }
-        uint32_t pt_phys = 0;
-        uint32_t* pt = (uint32_t*)kmalloc(PAGE_SIZE, PAGE_SIZE, &pt_phys);
-        if (!pt) {
-            paging_set_current_dir(prev_dir, prev_phys);
-            for (uint32_t j = 0; j < 16; j++) {
-                if (low_tables[j]) {
-                    kfree((void*)low_tables[j]);
-                }
+    }
+    if (count == 0)
+        return 0;
+
+    uint32_t* shared = (uint32_t*)kmalloc(count * 2u * sizeof(uint32_t), 0, NULL);
+    if (!shared)
+        return -1;
+
+    uint32_t irq = irq_save();
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < USER_PDE_END && n < count; i++) {
+        if (!(pd[i] & PAGE_PRESENT) || (pd[i] & PDE_PS))
+            continue;
+        uint32_t* pt = (uint32_t*)(RECURSIVE_PT_BASE + i * PAGE_SIZE);
+        for (uint32_t j = 0; j < 1024 && n < count; j++) {
+            uint32_t pte = pt[j];
+            if (!(pte & PAGE_PRESENT) || !(pte & PAGE_ANON))
+                continue;
+            uint32_t virt = (i << 22) | (j << 12);
+            if (pte & PAGE_RW) {
+                pte = (pte & ~PAGE_RW) | PAGE_COW;
+                pt[j] = pte;
+                invlpg(virt);
             }
-            kfree(dir);
-            return NULL;
+            pmm_page_ref(pte & 0xFFFFF000u);
+            shared[n * 2] = virt;
+            shared[n * 2 + 1] = pte;
+            n++;
         }
-        uint32_t* src_pt = (uint32_t*)(RECURSIVE_PT_BASE + i * PAGE_SIZE);
-        memcpy(pt, src_pt, PAGE_SIZE);
-        uint32_t flags = kernel_page_directory[i] & 0xFFFu;
-        flags &= ~PAGE_USER;
-        dir[i] = (pt_phys & 0xFFFFF000u) | flags;
-        low_tables[i] = (uint32_t)pt;
+    }
+
+    uint32_t* prev_dir = current_page_directory;
+    uint32_t prev_phys = current_page_directory_phys;
+    paging_set_current_dir(dst_dir, dst_phys);
+    for (uint32_t k = 0; k < n; k++) {
+        uint32_t pte = shared[k * 2 + 1];
+        map_page(dst_dir, shared[k * 2], pte & 0xFFFFF000u, pte & 0xFFFu);
     }
     paging_set_current_dir(prev_dir, prev_phys);
+    irq_restore(irq);
 
-    for (uint32_t i = 768; i < 1023; i++) {
-        dir[i] = kernel_page_directory[i];
+    kfree(shared);
+    return 0;
+}
+
+bool paging_handle_page_fault(uint32_t addr, uint32_t err) {
+    // 존재하는 페이지에 대한 쓰기만 COW 대상
+    if ((err & 0x3u) != 0x3u || addr >= KERNEL_SPACE_START)
+        return false;
+    uint32_t* pte = pte_lookup(addr);
+    if (!pte || !(*pte & PAGE_PRESENT) || !(*pte & PAGE_COW))
+        return false;
+
+    uint32_t page = addr & 0xFFFFF000u;
+    uint32_t phys = *pte & 0xFFFFF000u;
+    uint32_t flags = ((*pte & 0xFFFu) & ~PAGE_COW) | PAGE_RW;
+
+    // 마지막 남은 참조면 복사 없이 쓰기 권한만 돌려줌
+    if (pmm_page_refcount(phys) <= 1) {
+        *pte = phys | flags;
+        invlpg(page);
+        return true;
     }
-    dir[1023] = (phys & 0xFFFFF000u) | PAGE_PRESENT | PAGE_RW;
 
-    if (out_phys) {
-        *out_phys = phys;
+    uint32_t copy = (uint32_t)pmm_alloc_page();
+    if (!copy)
+        return false;
+    memcpy(temp_map(copy), (const void*)page, PAGE_SIZE);
+    temp_unmap();
+    pmm_page_ref(copy);
+    *pte = copy | flags;
+    invlpg(page);
+    pmm_page_unref(phys);
+    return true;
+}
+
+void paging_free_user_dir(uint32_t* dir, uint32_t phys) {
+    if (!dir || dir == kernel_page_directory) {
+        return;
     }
-    return dir;
+    vma_release(phys);
+    uint32_t irq = irq_save();
+    uint32_t* prev_dir = current_page_directory;
+    uint32_t prev_phys = current_page_directory_phys;
+    if (prev_dir == dir) {
+        prev_dir = kernel_page_directory;
+        prev_phys = kernel_page_directory_phys;
+    }
+
+    paging_set_current_dir(dir, phys);
+    for (uint32_t i = 0; i < USER_PDE_END; i++) {
+        if (!(dir[i] & PAGE_PRESENT) || (dir[i] & PDE_PS))
+            continue;
+        uint32_t* pt = (uint32_t*)(RECURSIVE_PT_BASE + i * PAGE_SIZE);
+        for (uint32_t j = 0; j < 1024; j++) {
+            if ((pt[j] & PAGE_PRESENT) && (pt[j] & PAGE_ANON))
+                pmm_page_unref(pt[j] & 0xFFFFF000u);
+        }
+    }
+    paging_set_current_dir(prev_dir, prev_phys);
+
+    // 유저 영역 페이지 테이블은 map_page가 PMM에서 받은 것 (공유 중인 커널 테이블은 제외)
+    for (uint32_t i = 0; i < USER_PDE_END; i++) {
+        if (!(dir[i] & PAGE_PRESENT))
+            continue;
+        if (!(dir[i] & PDE_PS) && !low_table_shared(dir, i))
+            pmm_free_page((void*)(dir[i] & 0xFFFFF000u));
+        dir[i] = 0;
+    }
+    g_user_dirs--;
+    if (pgdir_pool_count < PGDIR_POOL_MAX) {
+        pgdir_pool[pgdir_pool_count] = dir;
+        pgdir_pool_phys[pgdir_pool_count] = phys;
+        pgdir_pool_count++;
+        dir = NULL;
+    }
+    irq_restore(irq);
+    if (dir)
+        kfree(dir);
 }
@@ -11,6 +11,13 @@
 #define PAGE_PWT     (1u << 3)
 #define PAGE_PCD     (1u << 4)
 #define PAGE_PAT     (1u << 7)
+#define PAGE_GLOBAL  (1u << 8)      // CR4.PGE: CR3를 바꿔도 TLB에서 비우지 않음
+#define PAGE_COW     (1u << 9)      // 쓰기 시 복사 (PTE available 비트)
+#define PAGE_ANON    (1u << 10)     // PMM 참조 카운트로 소유하는 유저 페이지
+#define PDE_PS       (1u << 7)      // 4MB 페이지 (PTE에서는 PAT 자리)
+#define PDE_PAT      (1u << 12)     // 4MB 페이지의 PAT 비트
+#define LARGE_PAGE_SIZE 0x00400000u
+#define KERNEL_SPACE_START 0xC0000000u
 #define PAGE_DIRECTORY_ADDR 0x80000
 #define PAGE_TABLE0_ADDR    0x81000
 #define PAGE_SIZE 4096
@@ -31,6 +38,19 @@ uint32_t* paging_create_user_dir(uint32_t* out_phys);
 int vmm_map_page(uint32_t virt, uint32_t phys, uint32_t flags);
 int vmm_map_page_alloc(uint32_t virt, uint32_t flags, uint32_t* out_phys);
 int vmm_map_range_alloc(uint32_t virt, size_t size, uint32_t flags);
+// 물리적으로 연속인 구간. 커널 영역에서 4MB 정렬이 맞는 부분은 PSE 큰 페이지로 매핑
+int vmm_map_range(uint32_t virt, uint32_t phys, uint32_t size, uint32_t flags);
 int vmm_virt_to_phys(uint32_t virt, uint32_t* out_phys);
+int vmm_unmap_page(uint32_t virt);
 int vmm_mark_user_range(uint32_t virt, size_t size);
+// 물리 페이지 하나를 0으로 채움 (매핑되지 않은 페이지도 가능)
+void paging_zero_frame(uint32_t phys);
 bool paging_pat_wc_enabled(void);
+
+// 유저 주소 공간 (현재 디렉터리 기준). 페이지는 PAGE_ANON + PMM 참조 카운트로 소유
+int vmm_map_user_page(uint32_t virt, uint32_t flags);      // 0으로 채운 새 페이지
+int vmm_map_user_copy(uint32_t virt, const void* src, uint32_t size, uint32_t flags);
+void vmm_unmap_user_range(uint32_t start, uint32_t end);
+int paging_clone_user_space(uint32_t* dst_dir, uint32_t dst_phys);
+bool paging_handle_page_fault(uint32_t addr, uint32_t err);
+void paging_free_user_dir(uint32_t* dir, uint32_t phys);
@@ -1,5 +1,6 @@
 // mm/pmm.c
 #include "pmm.h"
+#include "paging.h"
 #include "../drivers/screen.h"
 #include "../kernel/multiboot.h"
 #include "../libc/string.h"
@@ -7,26 +8,97 @@
 #define PAGE_SIZE 4096
 #define MAX_PAGES (1024*1024)   // 4GB / 4KB = 1,048,576 pages
 
-static uint8_t pmm_bitmap[MAX_PAGES/8];
+#define BITMAP_WORDS (MAX_PAGES/32)
+#define EFLAGS_IF 0x200u
+
+// 1 = used. 32비트 워드 단위로 훑어서 꽉 찬 워드는 한 번에 건너뜀
+static uint32_t pmm_bitmap[BITMAP_WORDS];
 
 static uint64_t total_memory = 0;
 static uint64_t free_memory  = 0;
 static uint64_t max_physical_page = 0;
+static uint32_t search_hint = 0;    // 이 워드 앞쪽에는 빈 페이지가 없음
+
+// 유휴 시간에 0으로 채워 둔 페이지 (PMM 입장에서는 사용 중)
+static void* zero_pool[PMM_ZERO_POOL];
+static uint32_t zero_count = 0;
+
+// 유저 주소 공간에 매핑된 횟수 (COW 공유). pmm_init에서 물리 메모리 크기만큼 잡음
+// 포화(PMM_REF_SATURATED)된 카운트는 더 올리지도 내리지도 않음 = 그 프레임은 반환하지 않음
+#define PMM_REF_SATURATED 0xFFFFu
+static uint16_t* page_refs = NULL;
+
+#define BIT_SET(a,i)   (a[(i)/32] |=  (1u<<((i)%32)))
+#define BIT_CLEAR(a,i) (a[(i)/32] &= ~(1u<<((i)%32)))
+#define BIT_TEST(a,i)  (a[(i)/32] &   (1u<<((i)%32)))
 
-#define BIT_SET(a,i)   (a[(i)/8] |=  (1<<((i)%8)))
-#define BIT_CLEAR(a,i) (a[(i)/8] &= ~(1<<((i)%8)))
-#define BIT_TEST(a,i)  (a[(i)/8] &   (1<<((i)%8)))
+static inline uint32_t irq_save(void) {
+    uint32_t flags = 0;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
 
 static inline void mark_used(uint64_t p){
     if(p < max_physical_page) BIT_SET(pmm_bitmap,p);
 }
 static inline void mark_free(uint64_t p){
-    if(p < max_physical_page) BIT_CLEAR(pmm_bitmap,p);
+    if(p < max_physical_page){
+        BIT_CLEAR(pmm_bitmap,p);
+        if(p/32 < search_hint) search_hint = (uint32_t)(p/32);
+    }
+}
+
+static inline uint32_t bitmap_words(){
+    return (uint32_t)((max_physical_page + 31) / 32);
 }
 
 static int find_free_page(){
-    for(uint64_t i=0;i<max_physical_page;i++){
-        if(!BIT_TEST(pmm_bitmap,i)) return i;
+    uint32_t words = bitmap_words();
+    for(uint32_t w=search_hint; w<words; w++){
+        uint32_t word = pmm_bitmap[w];
+        if(word == 0xFFFFFFFFu) continue;
+        search_hint = w;
+        uint32_t idx = w*32 + (uint32_t)__builtin_ctz(~word);
+        if(idx >= max_physical_page) return -1;
+        return (int)idx;
+    }
+    search_hint = words;
+    return -1;
+}
+
+// 2^order 페이지 정렬된 연속 빈 구간
+static int find_free_run(uint32_t order){
+    uint32_t n = 1u << order;
+    uint32_t words = bitmap_words();
+
+    if(n < 32){
+        uint32_t mask = (1u << n) - 1u;
+        for(uint32_t w=search_hint; w<words; w++){
+            uint32_t word = pmm_bitmap[w];
+            if(word == 0xFFFFFFFFu) continue;
+            for(uint32_t shift=0; shift<32; shift+=n){
+                if((word & (mask << shift)) == 0){
+                    uint32_t idx = w*32 + shift;
+                    if(idx + n > max_physical_page) return -1;
+                    return (int)idx;
+                }
+            }
+        }
+        return -1;
+    }
+
+    uint32_t span = n / 32;
+    uint32_t start = (search_hint + span - 1) / span * span;
+    for(uint32_t w=start; w + span <= words; w += span){
+        uint32_t k = 0;
+        while(k < span && pmm_bitmap[w+k] == 0) k++;
+        if(k == span) return (int)(w*32);
     }
     return -1;
 }
@@ -50,6 +122,7 @@ void pmm_init(uint32_t mb_info_addr){
     total_memory=0;
     free_memory =0;
     max_physical_page =0;
+    search_hint = 0;
 
     multiboot_info_t* mbi = (multiboot_info_t*)mb_info_addr;
 
@@ -108,6 +181,17 @@ void pmm_init(uint32_t mb_info_addr){
         }
     }
 
+    // ----- 페이지 참조 카운트 (페이지당 2바이트, 아이덴티티 매핑 영역에 들어감) -----
+    uint32_t ref_pages = (uint32_t)((max_physical_page * sizeof(uint16_t) + PAGE_SIZE - 1) / PAGE_SIZE);
+    uint32_t ref_order = 0;
+    while((1u << ref_order) < ref_pages) ref_order++;
+    page_refs = (uint16_t*)pmm_alloc_pages(ref_order);
+    if(page_refs){
+        memset(page_refs, 0, (size_t)PAGE_SIZE << ref_order);
+    } else {
+        kprint("[PMM] page refcount table alloc failed\n");
+    }
+
     kprintf("[PMM] Total=%dMB Free=%dMB\n",
             total_memory/1024/1024,
             free_memory /1024/1024);
@@ -115,22 +199,160 @@ void pmm_init(uint32_t mb_info_addr){
 }
 
 void* pmm_alloc_page(){
+    uint32_t flags = irq_save();
     int idx = find_free_page();
     if(idx < 0){
-        kprint("[PMM] Out of memory!\n");
-        return NULL;
+        // 마지막으로 0 풀에 남은 페이지라도 내줌
+        void* page = zero_count ? zero_pool[--zero_count] : NULL;
+        irq_restore(flags);
+        if(!page) kprint("[PMM] Out of memory!\n");
+        return page;
     }
     mark_used(idx);
     free_memory -= PAGE_SIZE;
-    return (void*)(idx * PAGE_SIZE);
+    irq_restore(flags);
+    return (void*)((uint32_t)idx * PAGE_SIZE);
+}
+
+void* pmm_alloc_zeroed_page(void){
+    uint32_t flags = irq_save();
+    void* page = zero_count ? zero_pool[--zero_count] : NULL;
+    irq_restore(flags);
+    if(page) return page;
+
+    page = pmm_alloc_page();
+    if(page) paging_zero_frame((uint32_t)page);
+    return page;
+}
+
+void pmm_zero_pool_refill(uint32_t max_pages){
+    for(uint32_t i = 0; i < max_pages && zero_count < PMM_ZERO_POOL; i++){
+        void* page = pmm_alloc_page();
+        if(!page) return;
+        paging_zero_frame((uint32_t)page);
+
+        uint32_t flags = irq_save();
+        bool kept = zero_count < PMM_ZERO_POOL;
+        if(kept) zero_pool[zero_count++] = page;
+        irq_restore(flags);
+        if(!kept) pmm_free_page(page);
+    }
+}
+
+uint32_t pmm_zero_pool_count(void){
+    return zero_count;
+}
+
+void* pmm_alloc_pages(uint32_t order){
+    if(order > PMM_MAX_ORDER) return NULL;
+    if(order == 0) return pmm_alloc_page();
+
+    uint32_t n = 1u << order;
+    uint32_t flags = irq_save();
+    int idx = find_free_run(order);
+    if(idx < 0){
+        irq_restore(flags);
+        return NULL;
+    }
+    for(uint32_t i=0; i<n; i++){
+        mark_used((uint32_t)idx + i);
+    }
+    free_memory -= (uint64_t)n * PAGE_SIZE;
+    irq_restore(flags);
+    return (void*)((uint32_t)idx * PAGE_SIZE);
 }
 
 void pmm_free_page(void* addr){
     uint64_t idx = (uint32_t)addr / PAGE_SIZE;
     if(idx >= max_physical_page) return;
 
+    uint32_t flags = irq_save();
+    if(page_refs) page_refs[idx] = 0;
     if(BIT_TEST(pmm_bitmap, idx)){
         mark_free(idx);
         free_memory += PAGE_SIZE;
     }
+    irq_restore(flags);
+}
+
+void pmm_free_pages(void* addr, uint32_t order){
+    if(order > PMM_MAX_ORDER) return;
+    uint32_t base = (uint32_t)addr;
+    for(uint32_t i=0; i < (1u << order); i++){
+        pmm_free_page((void*)(base + i*PAGE_SIZE));
+    }
+}
+
+void pmm_page_ref(uint32_t phys){
+    uint32_t idx = phys / PAGE_SIZE;
+    if(!page_refs || idx >= max_physical_page) return;
+    uint32_t flags = irq_save();
+    if(page_refs[idx] < PMM_REF_SATURATED){
+        page_refs[idx]++;
+        if(page_refs[idx] == PMM_REF_SATURATED)
+            kprintf("[PMM] refcount saturated: frame %x is pinned\n", phys & ~(PAGE_SIZE - 1u));
+    }
+    irq_restore(flags);
+}
+
+// 0이 되면 페이지를 반환. 남은 참조 수를 돌려줌
+uint32_t pmm_page_unref(uint32_t phys){
+    uint32_t idx = phys / PAGE_SIZE;
+    if(!page_refs || idx >= max_physical_page) return 0;
+    uint32_t flags = irq_save();
+    uint32_t left = page_refs[idx];
+    if(left == PMM_REF_SATURATED){
+        // 실제 참조 수를 잃었으므로 아직 매핑된 프레임을 반환하지 않도록 고정
+        irq_restore(flags);
+        return left;
+    }
+    if(left > 0) left--;
+    page_refs[idx] = (uint16_t)left;
+    irq_restore(flags);
+    if(left == 0) pmm_free_page((void*)(phys & ~(PAGE_SIZE - 1u)));
+    return left;
+}
+
+uint32_t pmm_page_refcount(uint32_t phys){
+    uint32_t idx = phys / PAGE_SIZE;
+    if(!page_refs || idx >= max_physical_page) return 0;
+    return page_refs[idx];
+}
+
+// order별로 지금 바로 내줄 수 있는 정렬된 연속 블록 수 (통계용, 전체 스캔)
+void pmm_count_free_blocks(uint32_t* counts){
+    if(!counts) return;
+    uint32_t flags = irq_save();
+    uint32_t words = bitmap_words();
+    for(uint32_t order=0; order<=PMM_MAX_ORDER; order++){
+        uint32_t n = 1u << order;
+        uint32_t count = 0;
+        if(n < 32){
+            uint32_t mask = (1u << n) - 1u;
+            for(uint32_t w=0; w<words; w++){
+                uint32_t word = pmm_bitmap[w];
+                if(word == 0xFFFFFFFFu) continue;
+                for(uint32_t shift=0; shift<32; shift+=n){
+                    if((word & (mask << shift)) == 0) count++;
+                }
+            }
+        } else {
+            uint32_t span = n / 32;
+            for(uint32_t w=0; w + span <= words; w += span){
+                uint32_t k = 0;
+                while(k < span && pmm_bitmap[w+k] == 0) k++;
+                if(k == span) count++;
+            }
+        }
+        counts[order] = count;
+    }
+    irq_restore(flags);
+}
+
+uint64_t pmm_get_total_memory(){
+    return total_memory;
+}
+
+uint64_t pmm_get_free_memory(){
+    return free_memory;
 }
@@ -6,10 +6,25 @@
 // 4KB 페이지 크기
 #define PAGE_SIZE 4096
 
+#define PMM_MAX_ORDER 10       // 최대 2^10 페이지 = 4MB 연속
+
 // PMM API
 void pmm_init(uint32_t mb_info_addr);     // Multiboot2 E820 맵을 기반으로 초기화
 void* pmm_alloc_page();                   // 4KB 페이지 하나 할당
 void  pmm_free_page(void* addr);          // 페이지 반환
+void* pmm_alloc_pages(uint32_t order);    // 2^order 페이지, 물리적으로 연속 + 크기만큼 정렬
+void  pmm_free_pages(void* addr, uint32_t order);
+void  pmm_count_free_blocks(uint32_t* counts); // counts[PMM_MAX_ORDER + 1]
+void  pmm_page_ref(uint32_t phys);       // 유저 매핑 참조 +1, 0xFFFF에서 포화(고정)
+uint32_t pmm_page_unref(uint32_t phys);   // -1, 0이 되면 반환. 남은 수
+uint32_t pmm_page_refcount(uint32_t phys);
 void  pmm_reserve_region(uint32_t start, uint32_t end); // 주어진 물리 영역을 PMM에서 제외
 uint64_t pmm_get_total_memory();          // 전체 물리 메모리 용량
 uint64_t pmm_get_free_memory();           // 남은 메모리 용량
+
+// 미리 0으로 채워 둔 페이지. 풀이 비면 그 자리에서 채움
+#define PMM_ZERO_POOL        64
+#define PMM_ZERO_REFILL      8   // 유휴 루프가 한 번 깰 때 채우는 페이지 수
+void* pmm_alloc_zeroed_page(void);
+void  pmm_zero_pool_refill(uint32_t max_pages);
+uint32_t pmm_zero_pool_count(void);
@@ -0,0 +1,311 @@
+// mm/slab.c
+#include "slab.h"
+#include "paging.h"
+#include "pmm.h"
+#include "../drivers/screen.h"
+#include "../libc/string.h"
+
+#define EFLAGS_IF 0x200u
+
+#define SLAB_PAGES      (KSLAB_SIZE / PAGE_SIZE)
+#define SLAB_NONE       (-1)
+#define SLAB_NO_CACHE   0xFFu
+#define SLAB_CLASSES    9           // 16, 32, ... 4096
+
+struct kmem_cache {
+    bool used;
+    char name[SLAB_NAME_MAX];
+    uint32_t obj_size;      // 정렬까지 반영한 객체 간격
+    uint32_t per_slab;
+    int16_t partial;        // 빈 자리가 있는 슬랩 목록 (페이지 인덱스)
+    int16_t empty;          // 통째로 빈 슬랩 하나는 바로 반납하지 않고 보관
+    uint32_t active;
+    uint32_t slabs;
+    uint32_t allocs;
+};
+
+// 페이지별 슬랩 정보. 객체 안에 헤더를 두지 않으므로 2의 거듭제곱 크기는
+// 자기 크기로 자연 정렬됨
+typedef struct {
+    uint8_t cache;
+    uint16_t inuse;
+    int16_t next;
+    int16_t prev;
+    void* free;             // 객체 첫 4바이트로 이어지는 free 리스트
+} slab_page_t;
+
+static struct kmem_cache caches[SLAB_MAX_CACHES];
+static slab_page_t pages[SLAB_PAGES];
+static int16_t free_vpages = SLAB_NONE;     // 매핑을 풀어 둔 가상 페이지
+static uint32_t next_vpage = 0;
+static bool slab_ready = false;
+
+static inline uint32_t irq_save(void) {
+    uint32_t flags = 0;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+static inline uintptr_t slab_page_addr(int16_t idx) {
+    return KSLAB_START + (uintptr_t)idx * PAGE_SIZE;
+}
+
+static void slab_list_remove(struct kmem_cache* c, int16_t idx) {
+    slab_page_t* p = &pages[idx];
+    if (p->prev != SLAB_NONE)
+        pages[p->prev].next = p->next;
+    else
+        c->partial = p->next;
+    if (p->next != SLAB_NONE)
+        pages[p->next].prev = p->prev;
+    p->next = SLAB_NONE;
+    p->prev = SLAB_NONE;
+}
+
+static void slab_list_push(struct kmem_cache* c, int16_t idx) {
+    slab_page_t* p = &pages[idx];
+    p->prev = SLAB_NONE;
+    p->next = c->partial;
+    if (c->partial != SLAB_NONE)
+        pages[c->partial].prev = idx;
+    c->partial = idx;
+}
+
+static void slab_fill_freelist(struct kmem_cache* c, int16_t idx) {
+    uintptr_t base = slab_page_addr(idx);
+    void* head = NULL;
+    for (uint32_t i = c->per_slab; i > 0; i--) {
+        void** obj = (void**)(base + (i - 1u) * c->obj_size);
+        *obj = head;
+        head = obj;
+    }
+    pages[idx].free = head;
+    pages[idx].inuse = 0;
+}
+
+static int16_t slab_grow(struct kmem_cache* c) {
+    int16_t idx;
+    if (free_vpages != SLAB_NONE) {
+        idx = free_vpages;
+        free_vpages = pages[idx].next;
+    } else if (next_vpage < SLAB_PAGES) {
+        idx = (int16_t)next_vpage++;
+    } else {
+        return SLAB_NONE;
+    }
+
+    if (vmm_map_page_alloc((uint32_t)slab_page_addr(idx), PAGE_PRESENT | PAGE_RW, NULL) != 0) {
+        pages[idx].next = free_vpages;
+        free_vpages = idx;
+        return SLAB_NONE;
+    }
+
+    pages[idx].cache = (uint8_t)(c - caches);
+    pages[idx].next = SLAB_NONE;
+    pages[idx].prev = SLAB_NONE;
+    slab_fill_freelist(c, idx);
+    c->slabs++;
+    return idx;
+}
+
+static void slab_release(struct kmem_cache* c, int16_t idx) {
+    uint32_t virt = (uint32_t)slab_page_addr(idx);
+    uint32_t phys = 0;
+    if (vmm_virt_to_phys(virt, &phys) == 0) {
+        vmm_unmap_page(virt);
+        pmm_free_page((void*)(phys & 0xFFFFF000u));
+    }
+    pages[idx].cache = SLAB_NO_CACHE;
+    pages[idx].free = NULL;
+    pages[idx].prev = SLAB_NONE;
+    pages[idx].next = free_vpages;
+    free_vpages = idx;
+    c->slabs--;
+}
+
+static struct kmem_cache* slab_setup_cache(const char* name, size_t size, size_t align) {
+    if (size == 0 || size > SLAB_MAX_OBJ)
+        return NULL;
+    if (align < sizeof(void*))
+        align = sizeof(void*);
+    if ((align & (align - 1u)) != 0 || align > PAGE_SIZE)
+        return NULL;
+
+    size_t stride = size < SLAB_MIN_OBJ ? SLAB_MIN_OBJ : size;
+    stride = (stride + align - 1u) & ~(align - 1u);
+    if (stride > SLAB_MAX_OBJ)
+        return NULL;
+
+    for (int i = 0; i < SLAB_MAX_CACHES; i++) {
+        struct kmem_cache* c = &caches[i];
+        if (c->used)
+            continue;
+        memset(c, 0, sizeof(*c));
+        c->used = true;
+        strncpy(c->name, name, SLAB_NAME_MAX - 1);
+        c->obj_size = (uint32_t)stride;
+        c->per_slab = PAGE_SIZE / (uint32_t)stride;
+        c->partial = SLAB_NONE;
+        c->empty = SLAB_NONE;
+        return c;
+    }
+    return NULL;
+}
+
+void slab_init(void) {
+    memset(caches, 0, sizeof(caches));
+    for (uint32_t i = 0; i < SLAB_PAGES; i++) {
+        pages[i].cache = SLAB_NO_CACHE;
+        pages[i].next = SLAB_NONE;
+        pages[i].prev = SLAB_NONE;
+    }
+    free_vpages = SLAB_NONE;
+    next_vpage = 0;
+
+    // caches[0..SLAB_CLASSES) = 크기 클래스
+    char name[SLAB_NAME_MAX];
+    for (uint32_t i = 0; i < SLAB_CLASSES; i++) {
+        uint32_t size = SLAB_MIN_OBJ << i;
+        snprintf(name, sizeof(name), "size-%d", (int)size);
+        slab_setup_cache(name, size, size);
+    }
+    slab_ready = true;
+}
+
+kmem_cache_t* kmem_cache_create(const char* name, size_t size, size_t align) {
+    if (!slab_ready || !name)
+        return NULL;
+    uint32_t flags = irq_save();
+    for (int i = SLAB_CLASSES; i < SLAB_MAX_CACHES; i++) {
+        if (caches[i].used && strcmp(caches[i].name, name) == 0) {
+            irq_restore(flags);
+            return &caches[i];
+        }
+    }
+    struct kmem_cache* c = slab_setup_cache(name, size, align);
+    irq_restore(flags);
+    if (!c)
+        kprintf("[slab] cannot create cache %s\n", name);
+    return c;
+}
+
+void* kmem_cache_alloc(kmem_cache_t* c) {
+    if (!c)
+        return NULL;
+    uint32_t flags = irq_save();
+    int16_t idx = c->partial;
+    if (idx == SLAB_NONE) {
+        if (c->empty != SLAB_NONE) {
+            idx = c->empty;
+            c->empty = SLAB_NONE;
+        } else {
+            idx = slab_grow(c);
+        }
+        if (idx == SLAB_NONE) {
+            irq_restore(flags);
+            return NULL;
+        }
+        slab_list_push(c, idx);
+    }
+
+    slab_page_t* p = &pages[idx];
+    void** obj = (void**)p->free;
+    p->free = *obj;
+    p->inuse++;
+    if (!p->free)
+        slab_list_remove(c, idx);
+    c->active++;
+    c->allocs++;
+    irq_restore(flags);
+    return obj;
+}
+
+void kmem_cache_free(kmem_cache_t* c, void* ptr) {
+    if (!ptr)
+        return;
+    if (c && slab_owns(ptr) &&
+        pages[((uintptr_t)ptr - KSLAB_START) / PAGE_SIZE].cache != (uint8_t)(c - caches)) {
+        kprintf("[slab] %08X freed to wrong cache %s\n", (uint32_t)ptr, c->name);
+        return;
+    }
+    slab_free(ptr);
+}
+
+// 크기와 정렬을 함께 만족하는 가장 작은 클래스
+void* slab_alloc(size_t size, size_t align) {
+    if (!slab_ready || size == 0)
+        return NULL;
+    size_t need = size > align ? size : align;
+    if (need > SLAB_MAX_OBJ)
+        return NULL;
+    uint32_t cls = 0;
+    while ((SLAB_MIN_OBJ << cls) < need)
+        cls++;
+    return kmem_cache_alloc(&caches[cls]);
+}
+
+bool slab_owns(const void* ptr) {
+    uintptr_t addr = (uintptr_t)ptr;
+    return addr >= KSLAB_START && addr < KSLAB_START + KSLAB_SIZE;
+}
+
+void slab_free(void* ptr) {
+    int16_t idx = (int16_t)(((uintptr_t)ptr - KSLAB_START) / PAGE_SIZE);
+    uint32_t flags = irq_save();
+    slab_page_t* p = &pages[idx];
+    if (p->cache == SLAB_NO_CACHE || p->inuse == 0) {
+        irq_restore(flags);
+        kprintf("[slab] bad free %08X\n", (uint32_t)ptr);
+        return;
+    }
+    struct kmem_cache* c = &caches[p->cache];
+    if (((uintptr_t)ptr - slab_page_addr(idx)) % c->obj_size != 0) {
+        irq_restore(flags);
+        kprintf("[slab] misaligned free %08X (%s)\n", (uint32_t)ptr, c->name);
+        return;
+    }
+
+    bool was_full = (p->free == NULL);
+    *(void**)ptr = p->free;
+    p->free = ptr;
+    p->inuse--;
+    c->active--;
+    if (was_full)
+        slab_list_push(c, idx);
+    if (p->inuse == 0) {
+        slab_list_remove(c, idx);
+        if (c->empty == SLAB_NONE) {
+            c->empty = idx;
+        } else {
+            slab_release(c, idx);
+        }
+    }
+    irq_restore(flags);
+}
+
+int slab_get_stats(kmem_cache_stats_t* out, int max) {
+    if (!out || max <= 0)
+        return 0;
+    int n = 0;
+    uint32_t flags = irq_save();
+    for (int i = 0; i < SLAB_MAX_CACHES && n < max; i++) {
+        const struct kmem_cache* c = &caches[i];
+        if (!c->used)
+            continue;
+        memcpy(out[n].name, c->name, SLAB_NAME_MAX);
+        out[n].obj_size = c->obj_size;
+        out[n].per_slab = c->per_slab;
+        out[n].active = c->active;
+        out[n].slabs = c->slabs;
+        out[n].allocs = c->allocs;
+        n++;
+    }
+    irq_restore(flags);
+    return n;
+}
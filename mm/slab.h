@@ -0,0 +1,39 @@
+// mm/slab.h
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// 슬랩 전용 가상 영역 (힙 바로 위, 램디스크 매핑 아래)
+#define KSLAB_START     0xC5000000u
+#define KSLAB_SIZE      (32u * 1024u * 1024u)
+
+#define SLAB_MIN_OBJ    16u
+#define SLAB_MAX_OBJ    4096u       // 슬랩 하나 = 4KB 페이지 하나
+#define SLAB_MAX_CACHES 24
+#define SLAB_NAME_MAX   16
+
+typedef struct kmem_cache kmem_cache_t;
+
+typedef struct {
+    char name[SLAB_NAME_MAX];
+    uint32_t obj_size;
+    uint32_t per_slab;
+    uint32_t active;        // 사용 중인 객체 수
+    uint32_t slabs;         // 매핑된 슬랩 페이지 수
+    uint32_t allocs;        // 누적 할당 횟수
+} kmem_cache_stats_t;
+
+void slab_init(void);
+
+// 자주 쓰는 커널 객체용 전용 캐시. 같은 이름이면 기존 캐시를 돌려줌
+kmem_cache_t* kmem_cache_create(const char* name, size_t size, size_t align);
+void* kmem_cache_alloc(kmem_cache_t* cache);
+void kmem_cache_free(kmem_cache_t* cache, void* ptr);
+
+// kmalloc/kfree 경로 (16B~4KB 크기 클래스). 처리할 수 없으면 NULL
+void* slab_alloc(size_t size, size_t align);
+bool slab_owns(const void* ptr);
+void slab_free(void* ptr);
+
+int slab_get_stats(kmem_cache_stats_t* out, int max);
@@ -0,0 +1,342 @@
+// mm/vma.c
+#include "vma.h"
+#include "paging.h"
+#include "../kernel/proc/proc.h"
+#include "../drivers/screen.h"
+#include "../libc/string.h"
+
+#define EFLAGS_IF 0x200u
+
+// 프로세스마다 하나 + fork/exec 중 잠깐 겹치는 몫
+#define VMA_MAX_SPACES (MAX_PROCS + 2)
+
+struct vma {
+    bool used;
+    uint32_t start;
+    uint32_t end;
+    uint32_t flags;         // 채운 페이지에 줄 PTE 속성
+    const vma_ops_t* ops;
+    void* ctx;
+};
+
+// 주소 공간마다 자기 영역 표를 가짐. count가 0인 칸은 비어 있음
+struct vma_space {
+    uint32_t space;         // 페이지 디렉터리 물리 주소
+    uint32_t count;
+    struct vma areas[VMA_MAX_AREAS];
+};
+
+static struct vma_space spaces[VMA_MAX_SPACES];
+
+static inline uint32_t irq_save(void) {
+    uint32_t flags = 0;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+static void vma_get(const struct vma* a) {
+    if (a->ops && a->ops->get)
+        a->ops->get(a->ctx);
+}
+
+static void vma_put(const struct vma* a) {
+    if (a->ops && a->ops->put)
+        a->ops->put(a->ctx);
+}
+
+static struct vma_space* vma_space_find(uint32_t space, bool create) {
+    for (int i = 0; i < VMA_MAX_SPACES; i++) {
+        if (spaces[i].count && spaces[i].space == space)
+            return &spaces[i];
+    }
+    if (!create)
+        return NULL;
+    for (int i = 0; i < VMA_MAX_SPACES; i++) {
+        if (!spaces[i].count) {
+            spaces[i].space = space;
+            return &spaces[i];
+        }
+    }
+    kprint("[VMA] out of address spaces\n");
+    return NULL;
+}
+
+static struct vma* vma_find(uint32_t space, uint32_t addr) {
+    struct vma_space* s = vma_space_find(space, false);
+    if (!s)
+        return NULL;
+    for (int i = 0; i < VMA_MAX_AREAS; i++) {
+        struct vma* a = &s->areas[i];
+        if (a->used && addr >= a->start && addr < a->end)
+            return a;
+    }
+    return NULL;
+}
+
+static struct vma* vma_slot(struct vma_space* s) {
+    for (int i = 0; i < VMA_MAX_AREAS; i++) {
+        if (!s->areas[i].used)
+            return &s->areas[i];
+    }
+    return NULL;
+}
+
+static void vma_drop(struct vma_space* s, struct vma* a) {
+    vma_put(a);
+    memset(a, 0, sizeof(*a));
+    s->count--;
+}
+
+int vma_map(uint32_t start, uint32_t end, uint32_t flags, const vma_ops_t* ops, void* ctx) {
+    if ((start & 0xFFFu) || (end & 0xFFFu) || start >= end || end > KERNEL_SPACE_START)
+        return -1;
+    uint32_t space = paging_current_dir_phys();
+
+    uint32_t irq = irq_save();
+    struct vma_space* s = vma_space_find(space, true);
+    if (!s) {
+        irq_restore(irq);
+        return -1;
+    }
+    for (int i = 0; i < VMA_MAX_AREAS; i++) {
+        const struct vma* a = &s->areas[i];
+        if (a->used && start < a->end && a->start < end) {
+            irq_restore(irq);
+            return -1;
+        }
+    }
+    // brk처럼 바로 뒤에 이어 붙는 익명 영역은 기존 영역을 늘림
+    if (!ops && !ctx) {
+        for (int i = 0; i < VMA_MAX_AREAS; i++) {
+            struct vma* prev = &s->areas[i];
+            if (prev->used && prev->end == start &&
+                prev->flags == flags && !prev->ops && !prev->ctx) {
+                prev->end = end;
+                irq_restore(irq);
+                return 0;
+            }
+        }
+    }
+    struct vma* a = vma_slot(s);
+    if (!a) {
+        irq_restore(irq);
+        kprint("[VMA] out of areas\n");
+        return -1;
+    }
+    a->used = true;
+    a->start = start;
+    a->end = end;
+    a->flags = flags;
+    a->ops = ops;
+    a->ctx = ctx;
+    s->count++;
+    irq_restore(irq);
+    return 0;
+}
+
+int vma_unmap(uint32_t space, uint32_t start, uint32_t end) {
+    start &= 0xFFFFF000u;
+    end = (end + 0xFFFu) & 0xFFFFF000u;
+    if (start >= end)
+        return 0;
+
+    uint32_t irq = irq_save();
+    struct vma_space* s = vma_space_find(space, false);
+    if (!s) {
+        irq_restore(irq);
+        return 0;
+    }
+    // 영역끼리 겹치지 않으므로 가운데가 잘리는 영역은 많아야 하나. 먼저 자리를 확인
+    struct vma* split = NULL;
+    for (int i = 0; i < VMA_MAX_AREAS; i++) {
+        struct vma* a = &s->areas[i];
+        if (a->used && a->start < start && end < a->end) {
+            split = a;
+            break;
+        }
+    }
+    struct vma* tail = split ? vma_slot(s) : NULL;
+    if (split && !tail) {
+        irq_restore(irq);
+        kprint("[VMA] out of areas\n");
+        return -1;
+    }
+    if (split) {
+        *tail = *split;
+        tail->start = end;
+        vma_get(tail);
+        s->count++;
+        split->end = start;
+    }
+
+    for (int i = 0; i < VMA_MAX_AREAS; i++) {
+        struct vma* a = &s->areas[i];
+        if (!a->used || end <= a->start || a->end <= start)
+            continue;
+        if (start <= a->start && a->end <= end) {
+            vma_drop(s, a);
+        } else if (start <= a->start) {
+            a->start = end;
+        } else {
+            a->end = start;
+        }
+    }
+    irq_restore(irq);
+    return 0;
+}
+
+int vma_clone(uint32_t src_space, uint32_t dst_space) {
+    uint32_t irq = irq_save();
+    struct vma_space* src = vma_space_find(src_space, false);
+    if (!src) {
+        irq_restore(irq);
+        return 0;
+    }
+    struct vma_space* dst = vma_space_find(dst_space, true);
+    for (int i = 0; dst && i < VMA_MAX_AREAS; i++) {
+        if (!src->areas[i].used)
+            continue;
+        struct vma* copy = vma_slot(dst);
+        if (!copy) {
+            kprint("[VMA] out of areas\n");
+            dst = NULL;
+            break;
+        }
+        *copy = src->areas[i];
+        vma_get(copy);
+        dst->count++;
+    }
+    irq_restore(irq);
+    if (!dst) {
+        vma_release(dst_space);
+        return -1;
+    }
+    return 0;
+}
+
+void vma_release(uint32_t space) {
+    uint32_t irq = irq_save();
+    struct vma_space* s = vma_space_find(space, false);
+    for (int i = 0; s && i < VMA_MAX_AREAS; i++) {
+        struct vma* a = &s->areas[i];
+        if (a->used)
+            vma_drop(s, a);
+    }
+    irq_restore(irq);
+}
+
+bool vma_contains(uint32_t addr) {
+    uint32_t irq = irq_save();
+    bool found = vma_find(paging_current_dir_phys(), addr) != NULL;
+    irq_restore(irq);
+    return found;
+}
+
+bool vma_overlaps(uint32_t start, uint32_t end, uint32_t* out_end) {
+    uint32_t irq = irq_save();
+    struct vma_space* s = vma_space_find(paging_current_dir_phys(), false);
+    for (int i = 0; s && i < VMA_MAX_AREAS; i++) {
+        const struct vma* a = &s->areas[i];
+        if (a->used && start < a->end && a->start < end) {
+            *out_end = a->end;
+            irq_restore(irq);
+            return true;
+        }
+    }
+    irq_restore(irq);
+    return false;
+}
+
+bool vma_covers_anon(uint32_t start, uint32_t end) {
+    if (start >= end)
+        return false;
+    uint32_t irq = irq_save();
+    uint32_t space = paging_current_dir_phys();
+    // 이웃과 합쳐졌을 수 있으므로 영역 끝을 따라가며 확인
+    while (start < end) {
+        const struct vma* a = vma_find(space, start);
+        if (!a || a->ops || a->ctx)
+            break;
+        start = a->end;
+    }
+    irq_restore(irq);
+    return start >= end;
+}
+
+bool vma_handle_fault(uint32_t addr, uint32_t err, bool irq_ok) {
+    // 없는 페이지 접근만 처리 (보호 위반은 COW 쪽에서)
+    if ((err & 0x1u) || addr >= KERNEL_SPACE_START)
+        return false;
+    uint32_t page = addr & 0xFFFFF000u;
+
+    uint32_t irq = irq_save();
+    struct vma* a = vma_find(paging_current_dir_phys(), page);
+    if (!a) {
+        irq_restore(irq);
+        return false;
+    }
+    struct vma area = *a;
+    vma_get(&area);
+    irq_restore(irq);
+
+    // 커널이 채워 넣어야 하므로 우선 쓰기 가능으로 붙임
+    if (vmm_map_user_page(page, area.flags | PAGE_RW) != 0) {
+        vma_put(&area);
+        kprintf("[VMA] out of memory at %08x\n", addr);
+        return false;
+    }
+
+    bool ok = true;
+    if (area.ops && area.ops->fill) {
+        // 파일을 읽을 수 있으므로 폴트 난 곳이 허용하던 때는 인터럽트를 켬
+        if (irq_ok)
+            __asm__ volatile("sti" ::: "memory");
+        ok = area.ops->fill(area.ctx, page, (uint8_t*)page);
+        __asm__ volatile("cli" ::: "memory");
+    }
+    vma_put(&area);
+
+    if (!ok) {
+        vmm_unmap_user_range(page, page + PAGE_SIZE);
+        kprintf("[VMA] fill failed at %08x\n", addr);
+        return false;
+    }
+    if (!(area.flags & PAGE_RW)) {
+        uint32_t phys = 0;
+        if (vmm_virt_to_phys(page, &phys) == 0)
+            vmm_map_page(page, phys & 0xFFFFF000u, area.flags | PAGE_ANON);
+    }
+    return true;
+}
+
+int vma_fault_in(uint32_t addr, uint32_t size) {
+    if (size == 0)
+        return 0;
+    uint32_t end = addr + size - 1u;
+    if (end < addr || end >= KERNEL_SPACE_START)
+        return -1;
+
+    uint32_t eflags = 0;
+    __asm__ volatile("pushf; pop %0" : "=r"(eflags));
+    uint32_t page = addr & 0xFFFFF000u;
+    for (;;) {
+        uint32_t phys = 0;
+        if (vmm_virt_to_phys(page, &phys) != 0) {
+            uint32_t irq = irq_save();
+            bool ok = vma_handle_fault(page, 0, (eflags & EFLAGS_IF) != 0);
+            irq_restore(irq);
+            if (!ok)
+                return -1;
+        }
+        if (page == (end & 0xFFFFF000u))
+            break;
+        page += PAGE_SIZE;
+    }
+    return 0;
+}
@@ -0,0 +1,34 @@
+// mm/vma.h
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// 유저 주소 공간(페이지 디렉터리 물리 주소)별 가상 메모리 영역.
+// 영역 안의 페이지는 처음 접근할 때 페이지 폴트에서 만들어 채움
+#define VMA_MAX_AREAS 128       // 주소 공간 하나가 가질 수 있는 영역 수
+
+typedef struct {
+    // dst는 0으로 채워진 page_vaddr 페이지 (유저 주소 그대로). 인터럽트가 켜진 채 불릴 수 있음
+    bool (*fill)(void* ctx, uint32_t page_vaddr, uint8_t* dst);
+    void (*get)(void* ctx);
+    void (*put)(void* ctx);
+} vma_ops_t;
+
+// 현재 주소 공간에 [start, end) 영역 추가. ops가 NULL이면 0으로 채운 익명 페이지.
+// 성공하면 ctx 참조 하나를 영역이 가져감. 겹치는 기존 영역이 있으면 실패
+int vma_map(uint32_t start, uint32_t end, uint32_t flags, const vma_ops_t* ops, void* ctx);
+// 영역에서 [start, end)를 떼어냄 (페이지 자체는 vmm_unmap_user_range가 놓음).
+// 가운데를 떼어 둘로 나눌 자리가 없으면 아무것도 바꾸지 않고 -1
+int vma_unmap(uint32_t space, uint32_t start, uint32_t end);
+int vma_clone(uint32_t src_space, uint32_t dst_space);
+void vma_release(uint32_t space);
+
+// 현재 주소 공간 기준
+bool vma_contains(uint32_t addr);
+// [start, end)와 겹치는 영역이 있으면 그 영역 끝을 out_end에 넣고 true
+bool vma_overlaps(uint32_t start, uint32_t end, uint32_t* out_end);
+// [start, end)가 빈틈 없이 익명 영역(ops 없음)으로만 덮여 있는지
+bool vma_covers_anon(uint32_t start, uint32_t end);
+bool vma_handle_fault(uint32_t addr, uint32_t err, bool irq_ok);
+// 커널이 유저 버퍼를 만지기 전에 아직 없는 페이지를 미리 채움. 채울 수 없으면 -1
+int vma_fault_in(uint32_t addr, uint32_t size);
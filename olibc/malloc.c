@@ -0,0 +1,200 @@
+#include "malloc.h"
+#include "syscall.h"
+#include "string.h"
+#include <stdint.h>
+
+#define HDR_SIZE      8u
+#define MALLOC_MAGIC  0x4D4C4F43u       // "MLOC", 해제된 블록은 0
+#define SMALL_BINS    8u                // 헤더 포함 16B ~ 2KB
+#define SMALL_MAX     (16u << (SMALL_BINS - 1u))
+#define HUGE_MIN      (256u * 1024u)    // 이 이상은 따로 익명 mmap
+#define BRK_GROW      (64u * 1024u)
+#define BLOCK_HUGE    0x1u              // size 하위 비트 (블록 크기는 8의 배수)
+#define PAGE_BYTES    4096u
+
+typedef struct {
+    uint32_t size;      // 헤더 포함 바이트 | BLOCK_HUGE
+    uint32_t magic;
+} block_t;
+
+typedef struct free_block {
+    block_t hdr;
+    struct free_block* next;
+} free_block_t;
+
+static free_block_t* bins[SMALL_BINS];
+static free_block_t* free_list;         // 중간 크기, 주소 순
+static uint8_t* arena_cur;              // brk로 받아 아직 나눠 주지 않은 부분
+static uint8_t* arena_end;
+
+static uint32_t bin_index(uint32_t total) {
+    uint32_t k = 0;
+    while ((16u << k) < total)
+        k++;
+    return k;
+}
+
+static void* payload_of(block_t* b, uint32_t size) {
+    b->size = size;
+    b->magic = MALLOC_MAGIC;
+    return (uint8_t*)b + HDR_SIZE;
+}
+
+// brk를 BRK_GROW 단위로 늘려서 bytes만큼 잘라 줌
+static block_t* heap_take(uint32_t bytes) {
+    if (!arena_end) {
+        arena_cur = arena_end = (uint8_t*)sys_brk(0);
+        if (arena_end == (uint8_t*)-1)
+            return NULL;
+    }
+    uint32_t left = (uint32_t)(arena_end - arena_cur);
+    if (left < bytes) {
+        uint32_t grow = (bytes - left + BRK_GROW - 1u) & ~(BRK_GROW - 1u);
+        uint32_t want = (uint32_t)arena_end + grow;
+        if (want < (uint32_t)arena_end || sys_brk(want) != want)
+            return NULL;
+        arena_end += grow;
+    }
+    block_t* b = (block_t*)arena_cur;
+    arena_cur += bytes;
+    return b;
+}
+
+static void free_list_insert(block_t* b) {
+    free_block_t* f = (free_block_t*)b;
+    f->hdr.magic = 0;
+
+    free_block_t* prev = NULL;
+    free_block_t* next = free_list;
+    while (next && next < f) {
+        prev = next;
+        next = next->next;
+    }
+    // 뒤 블록과 바로 붙어 있으면 합침
+    if (next && (uint8_t*)f + f->hdr.size == (uint8_t*)next) {
+        f->hdr.size += next->hdr.size;
+        next = next->next;
+    }
+    f->next = next;
+    if (prev && (uint8_t*)prev + prev->hdr.size == (uint8_t*)f) {
+        prev->hdr.size += f->hdr.size;
+        prev->next = next;
+    } else if (prev) {
+        prev->next = f;
+    } else {
+        free_list = f;
+    }
+}
+
+static block_t* free_list_take(uint32_t total) {
+    free_block_t* prev = NULL;
+    for (free_block_t* f = free_list; f; prev = f, f = f->next) {
+        if (f->hdr.size < total)
+            continue;
+        free_block_t* rest = f->next;
+        // 남는 부분이 free 블록 하나를 담을 수 있으면 떼어서 제자리에 둠
+        if (f->hdr.size - total >= 16u) {
+            free_block_t* tail = (free_block_t*)((uint8_t*)f + total);
+            tail->hdr.size = f->hdr.size - total;
+            tail->hdr.magic = 0;
+            tail->next = rest;
+            rest = tail;
+            f->hdr.size = total;
+        }
+        if (prev)
+            prev->next = rest;
+        else
+            free_list = rest;
+        return &f->hdr;
+    }
+    return NULL;
+}
+
+void* malloc(size_t size) {
+    if (size == 0 || size > 0x7FFFFFF0u)
+        return NULL;
+    uint32_t total = ((uint32_t)size + HDR_SIZE + 7u) & ~7u;
+
+    if (total <= SMALL_MAX) {
+        uint32_t bin = bin_index(total);
+        free_block_t* f = bins[bin];
+        if (f) {
+            bins[bin] = f->next;
+            return payload_of(&f->hdr, 16u << bin);
+        }
+        block_t* b = heap_take(16u << bin);
+        return b ? payload_of(b, 16u << bin) : NULL;
+    }
+
+    if (total >= HUGE_MIN) {
+        uint32_t len = (total + PAGE_BYTES - 1u) & ~(PAGE_BYTES - 1u);
+        void* p = sys_mmap(-1, 0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS);
+        if (p == MAP_FAILED)
+            return NULL;
+        return payload_of((block_t*)p, len | BLOCK_HUGE);
+    }
+
+    block_t* b = free_list_take(total);
+    if (!b) {
+        b = heap_take(total);
+        if (!b)
+            return NULL;
+        b->size = total;
+    }
+    return payload_of(b, b->size);
+}
+
+void free(void* ptr) {
+    if (!ptr)
+        return;
+    block_t* b = (block_t*)((uint8_t*)ptr - HDR_SIZE);
+    if (b->magic != MALLOC_MAGIC)
+        return;     // 이중 해제나 malloc이 준 것이 아닌 포인터
+
+    if (b->size & BLOCK_HUGE) {
+        b->magic = 0;
+        sys_munmap(b, b->size & ~BLOCK_HUGE);
+        return;
+    }
+    if (b->size <= SMALL_MAX) {
+        free_block_t* f = (free_block_t*)b;
+        uint32_t bin = bin_index(b->size);
+        f->hdr.magic = 0;
+        f->next = bins[bin];
+        bins[bin] = f;
+        return;
+    }
+    free_list_insert(b);
+}
+
+void* calloc(size_t count, size_t size) {
+    if (size && count > 0x7FFFFFF0u / size)
+        return NULL;
+    uint32_t bytes = (uint32_t)(count * size);
+    void* p = malloc(bytes);
+    if (p)
+        memset(p, 0, bytes);
+    return p;
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (!ptr)
+        return malloc(size);
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+    block_t* b = (block_t*)((uint8_t*)ptr - HDR_SIZE);
+    if (b->magic != MALLOC_MAGIC)
+        return NULL;
+
+    uint32_t avail = (b->size & ~BLOCK_HUGE) - HDR_SIZE;
+    if (size <= avail)
+        return ptr;
+    void* p = malloc(size);
+    if (!p)
+        return NULL;
+    memcpy(p, ptr, avail);
+    free(ptr);
+    return p;
+}
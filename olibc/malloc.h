@@ -0,0 +1,13 @@
+#ifndef OLIBC_MALLOC_H
+#define OLIBC_MALLOC_H
+
+#include <stddef.h>
+
+// brk 힙 위의 할당기. 작은 크기는 2의 거듭제곱 클래스별 free 리스트,
+// 중간 크기는 주소 순 free 리스트(이웃과 합침), 아주 큰 것은 익명 mmap
+void* malloc(size_t size);
+void free(void* ptr);
+void* calloc(size_t count, size_t size);
+void* realloc(void* ptr, size_t size);
+
+#endif
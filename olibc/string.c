@@ -182,12 +182,23 @@ void *memmove(void *dest, const void *src, size_t n) {
     unsigned char *d = (unsigned char*)dest;
     const unsigned char *s = (const unsigned char*)src;
 
-    if (d < s) {
-        for (size_t i = 0; i < n; i++)
-            d[i] = s[i];
-    } else if (d > s) {
-        for (size_t i = n; i > 0; i--)
-            d[i-1] = s[i-1];
+    if (d == s || n == 0)
+        return dest;
+    // 앞으로 복사해도 안 덮이면 memcpy 경로
+    if (d < s || d >= s + n)
+        return memcpy(dest, src, n);
+
+    // 뒤에서부터: 남는 바이트를 먼저 옮기고 나머지는 dword를 거꾸로
+    d += n;
+    s += n;
+    for (size_t tail = n & 3u; tail > 0; tail--)
+        *--d = *--s;
+    size_t dwords = n >> 2;
+    if (dwords) {
+        d -= 4;
+        s -= 4;
+        __asm__ volatile("std; rep movsl; cld"
+                         : "+D"(d), "+S"(s), "+c"(dwords) :: "memory");
     }
     return dest;
 }
@@ -466,6 +477,18 @@ int sprintf(char *out, const char *fmt, ...) {
 
 void* memset(void* dest, int val, size_t len) {
     uint8_t* ptr = (uint8_t*)dest;
+    if (len >= 16) {
+        // 목적지를 4바이트 경계에 맞춘 뒤 rep stosd
+        size_t head = (size_t)(-(uintptr_t)ptr) & 3u;
+        len -= head;
+        while (head--)
+            *ptr++ = (uint8_t)val;
+        uint32_t word = (uint8_t)val * 0x01010101u;
+        size_t dwords = len >> 2;
+        __asm__ volatile("rep stosl"
+                         : "+D"(ptr), "+c"(dwords) : "a"(word) : "memory");
+        len &= 3u;
+    }
     while (len--)
         *ptr++ = (uint8_t)val;
     return dest;
@@ -474,6 +497,16 @@ void* memset(void* dest, int val, size_t len) {
 void* memcpy(void* dest, const void* src, size_t n) {
     uint8_t* d = (uint8_t*)dest;
     const uint8_t* s = (const uint8_t*)src;
+    if (n >= 16) {
+        size_t head = (size_t)(-(uintptr_t)d) & 3u;
+        n -= head;
+        while (head--)
+            *d++ = *s++;
+        size_t dwords = n >> 2;
+        __asm__ volatile("rep movsl"
+                         : "+D"(d), "+S"(s), "+c"(dwords) :: "memory");
+        n &= 3u;
+    }
     while (n--)
         *d++ = *s++;
     return dest;
@@ -47,6 +47,20 @@ uint32_t sys_call3(uint32_t num, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3)
     return ret;
 }
 
+uint32_t sys_call4(uint32_t num, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t arg4) {
+    uint32_t ret;
+    register uintptr_t b asm("ebx") = arg1;
+    register uintptr_t c asm("ecx") = arg2;
+    register uintptr_t d asm("edx") = arg3;
+    register uintptr_t S asm("esi") = arg4;
+    asm volatile(
+        "int $0xA5\n"
+        : "=a"(ret), "+b"(b), "+c"(c), "+d"(d), "+S"(S)
+        : "0"(num)
+        : "memory", "cc", "edi");
+    return ret;
+}
+
 void sys_start_shell(void) {
     (void)sys_call0(SYS_START_SHELL);
 }
@@ -112,6 +126,38 @@ int sys_write(int fd, const void* buf, uint32_t len) {
     return (int)sys_call3(SYS_WRITE, (uintptr_t)fd, (uintptr_t)len, (uintptr_t)buf);
 }
 
+int sys_pread(int fd, void* buf, uint32_t len, uint32_t offset) {
+    return (int)sys_call4(SYS_PREAD, (uintptr_t)fd, (uintptr_t)len, (uintptr_t)buf, (uintptr_t)offset);
+}
+
+int sys_pwrite(int fd, const void* buf, uint32_t len, uint32_t offset) {
+    return (int)sys_call4(SYS_PWRITE, (uintptr_t)fd, (uintptr_t)len, (uintptr_t)buf, (uintptr_t)offset);
+}
+
+int sys_readv(int fd, const sys_iovec_t* iov, uint32_t iovcnt) {
+    return (int)sys_call3(SYS_READV, (uintptr_t)fd, (uintptr_t)iovcnt, (uintptr_t)iov);
+}
+
+int sys_writev(int fd, const sys_iovec_t* iov, uint32_t iovcnt) {
+    return (int)sys_call3(SYS_WRITEV, (uintptr_t)fd, (uintptr_t)iovcnt, (uintptr_t)iov);
+}
+
+int sys_lseek(int fd, int32_t offset, int whence) {
+    return (int)sys_call3(SYS_LSEEK, (uintptr_t)fd, (uintptr_t)offset, (uintptr_t)whence);
+}
+
+int sys_fsync(int fd) {
+    return (int)sys_call1(SYS_FSYNC, (uintptr_t)fd);
+}
+
+int sys_sync(void) {
+    return (int)sys_call0(SYS_SYNC);
+}
+
+int sys_copy_file(const sys_copy_file_t* req) {
+    return (int)sys_call1(SYS_COPY_FILE, (uintptr_t)req);
+}
+
 int sys_close(int fd) {
     return (int)sys_call1(SYS_CLOSE, (uintptr_t)fd);
 }
@@ -187,6 +233,36 @@ int sys_dir_list(sys_dir_list_t* req) {
     return (int)sys_call1(SYS_DIR_LIST, (uintptr_t)req);
 }
 
+int sys_getdents(sys_getdents_t* req) {
+    return (int)sys_call1(SYS_GETDENTS, (uintptr_t)req);
+}
+
+void* sys_mmap(int fd, uint32_t offset, uint32_t length, uint32_t prot, uint32_t flags) {
+    sys_mmap_req_t req;
+    req.fd = (uint32_t)fd;
+    req.offset = offset;
+    req.length = length;
+    req.prot = prot;
+    req.flags = flags;
+    return (void*)sys_call1(SYS_MMAP, (uintptr_t)&req);
+}
+
+int sys_munmap(void* addr, uint32_t length) {
+    return (int)sys_call2(SYS_MUNMAP, (uintptr_t)addr, (uintptr_t)length);
+}
+
+uint32_t sys_brk(uint32_t addr) {
+    return sys_call1(SYS_BRK, (uintptr_t)addr);
+}
+
+int sys_ring_setup(sys_ring_t* ring) {
+    return (int)sys_call1(SYS_RING_SETUP, (uintptr_t)ring);
+}
+
+int sys_ring_enter(uint32_t to_submit) {
+    return (int)sys_call1(SYS_RING_ENTER, (uintptr_t)to_submit);
+}
+
 int gui_create(int x, int y, int w, int h, const char* title) {
     sys_gui_msg_t msg;
     memset(&msg, 0, sizeof(msg));
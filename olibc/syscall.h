@@ -42,6 +42,41 @@
 #define SYS_GUI_SEND       38
 #define SYS_GUI_RECV       39
 #define SYS_DIR_LIST       40
+#define SYS_MMAP           41
+#define SYS_MUNMAP         42
+#define SYS_RING_SETUP     43
+#define SYS_RING_ENTER     44
+#define SYS_GETDENTS       45
+#define SYS_PREAD          46
+#define SYS_PWRITE         47
+#define SYS_READV          48
+#define SYS_WRITEV         49
+#define SYS_LSEEK          50
+#define SYS_COPY_FILE      51
+#define SYS_FSYNC          52
+#define SYS_SYNC           53
+#define SYS_BRK            54
+
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
+#define IOV_MAX  64
+#define COPY_OFFSET_CURRENT 0xFFFFFFFFu
+
+#define PROT_READ   0x1u
+#define PROT_WRITE  0x2u
+#define MAP_SHARED  0x1u
+#define MAP_PRIVATE 0x2u
+#define MAP_ANONYMOUS 0x4u   // fd/offset 무시, 처음 접근할 때 0으로 채운 페이지
+#define MAP_FAILED  ((void*)-1)
+
+#define RING_OP_NOP   0
+#define RING_OP_OPEN  1   // addr=path -> fd
+#define RING_OP_READ  2   // fd, addr=buf, len, offset (RING_OFFSET_CURRENT = fd 위치)
+#define RING_OP_WRITE 3   // fd, addr=buf, len (write와 같이 파일 전체 덮어쓰기)
+#define RING_OP_CLOSE 4   // fd
+#define RING_OP_STAT  5   // addr=path -> file size
+#define RING_OFFSET_CURRENT 0xFFFFFFFFu
 
 #define SYS_FB_TEXT_TRANSPARENT 0x1u
 #define GUI_MSG_TEXT_MAX 256
@@ -69,11 +104,17 @@
 #define SYS_WAIT_RUNNING  (-1)
 #define SYS_WAIT_NO_SUCH  (-2)
 
-/* ABI: eax=num, ebx/ecx/edx=args, return in eax (getkey uses ecx). */
+typedef struct {
+    void* base;
+    uint32_t len;
+} sys_iovec_t;
+
+/* ABI: eax=num, ebx/ecx/edx/esi=args, return in eax (getkey uses ecx). */
 uint32_t sys_call0(uint32_t num);
 uint32_t sys_call1(uint32_t num, uintptr_t arg1);
 uint32_t sys_call2(uint32_t num, uintptr_t arg1, uintptr_t arg2);
 uint32_t sys_call3(uint32_t num, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3);
+uint32_t sys_call4(uint32_t num, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t arg4);
 void sys_start_shell(void);
 void sys_kprint(const char* s);
 void sys_clear_screen(void);
@@ -88,6 +129,13 @@ uint32_t sys_get_boot_flags(void);
 int sys_open(const char* path);
 int sys_read(int fd, void* buf, uint32_t len);
 int sys_write(int fd, const void* buf, uint32_t len);
+int sys_pread(int fd, void* buf, uint32_t len, uint32_t offset);
+int sys_pwrite(int fd, const void* buf, uint32_t len, uint32_t offset);
+int sys_readv(int fd, const sys_iovec_t* iov, uint32_t iovcnt);
+int sys_writev(int fd, const sys_iovec_t* iov, uint32_t iovcnt);
+int sys_lseek(int fd, int32_t offset, int whence);
+int sys_fsync(int fd);
+int sys_sync(void);
 int sys_close(int fd);
 int sys_ls(const char* path);
 int sys_cat(const char* path);
@@ -152,6 +200,78 @@ typedef struct {
     uint32_t name_len;
 } sys_dir_list_t;
 
+#define DIRENT_ATTR_READONLY 0x01
+#define DIRENT_ATTR_HIDDEN   0x02
+#define DIRENT_ATTR_SYSTEM   0x04
+#define DIRENT_ATTR_DIR      0x10
+#define DIRENT_ATTR_ARCHIVE  0x20
+
+// sys_getdents가 채우는 가변 길이 레코드 (다음 레코드는 reclen 뒤)
+typedef struct __attribute__((packed)) {
+    uint16_t reclen;
+    uint16_t namelen;
+    uint32_t cookie;
+    uint32_t size;
+    uint32_t ino;
+    uint16_t wrt_time;
+    uint16_t wrt_date;
+    uint16_t crt_time;
+    uint16_t crt_date;
+    uint8_t attr;
+    uint8_t reserved[3];
+    char name[];
+} sys_dirent_t;
+
+typedef struct {
+    const char* path;
+    void* buf;
+    uint32_t buf_len;
+    uint32_t cookie;        // in/out: 0이면 처음부터
+} sys_getdents_t;
+
+// 두 fd 사이 복사 (커널 안에서만). 오프셋이 COPY_OFFSET_CURRENT 이면 fd 위치 사용/전진
+typedef struct {
+    uint32_t src_fd;
+    uint32_t src_offset;
+    uint32_t dst_fd;
+    uint32_t dst_offset;
+    uint32_t len;           // 0 이면 원본 끝까지
+} sys_copy_file_t;
+
+typedef struct {
+    uint32_t fd;
+    uint32_t offset;
+    uint32_t length;
+    uint32_t prot;
+    uint32_t flags;
+} sys_mmap_req_t;
+
+// Submission/completion ring: 유저가 sq_tail/cq_head, 커널이 sq_head/cq_tail을 전진.
+// entries는 2의 거듭제곱 (최대 256), sqes/cqes 배열은 entries 개.
+typedef struct {
+    uint32_t opcode;
+    int32_t fd;
+    uint32_t addr;
+    uint32_t len;
+    uint32_t offset;
+    uint32_t user_data;
+} sys_ring_sqe_t;
+
+typedef struct {
+    uint32_t user_data;
+    int32_t res;
+} sys_ring_cqe_t;
+
+typedef struct {
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    uint32_t entries;
+    sys_ring_sqe_t* sqes;
+    sys_ring_cqe_t* cqes;
+} sys_ring_t;
+
 int sys_fb_info(sys_fb_info_t* out);
 int sys_fb_fill_rect(const sys_fb_rect_t* rect);
 int sys_fb_draw_text(const sys_fb_text_t* text);
@@ -162,6 +282,14 @@ int sys_gui_bind(void);
 int sys_gui_send(const sys_gui_msg_t* msg);
 int sys_gui_recv(sys_gui_msg_t* msg);
 int sys_dir_list(sys_dir_list_t* req);
+int sys_getdents(sys_getdents_t* req);
+int sys_copy_file(const sys_copy_file_t* req);
+void* sys_mmap(int fd, uint32_t offset, uint32_t length, uint32_t prot, uint32_t flags);
+int sys_munmap(void* addr, uint32_t length);
+// 0이면 현재 brk. 실패하면 이전 brk를 그대로 돌려줌
+uint32_t sys_brk(uint32_t addr);
+int sys_ring_setup(sys_ring_t* ring);
+int sys_ring_enter(uint32_t to_submit);
 int gui_create(int x, int y, int w, int h, const char* title);
 int gui_set_text(const char* text);
 